@@ -418,6 +418,7 @@ int printStats(int argc, char** argv, ostream& os)
 	os << "Transactions: " << gTransactionTable.size() << endl;
 	// 3122 timer current value (the number of seconds an MS should hold off the next RACH)
 	os << "T3122: " << gBTS.T3122() << " ms" << endl;
+	gBTS.scheduler().stats(os);
 	return SUCCESS;
 }
 
@@ -772,6 +773,8 @@ int crashme(int argc, char** argv, ostream& os)
 
 int stats(int argc, char** argv, ostream& os)
 {
+	// The counters are written periodically; bring the table up to date first.
+	gReports.flush();
 
 	char cmd[200];
 	if (argc==2)
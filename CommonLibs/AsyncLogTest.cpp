@@ -0,0 +1,125 @@
+/*
+* Copyright 2012 Free Software Foundation, Inc.
+*
+* This software is distributed under the terms of the GNU Affero Public License.
+* See the COPYING file in the main directory for details.
+*
+* This use of this software may be subject to additional restrictions.
+* See the LEGAL file in the main directory for details.
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU Affero General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU Affero General Public License for more details.
+
+	You should have received a copy of the GNU Affero General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+/*
+	Logs numbered lines from several threads with Log.Async=1 and a file sink,
+	in a child process that exits without waiting for the writer thread,
+	and checks that every line reaches the file in per-thread order.
+*/
+
+#include "Logger.h"
+#include "Threads.h"
+#include "Configuration.h"
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+ConfigurationTable gConfig;
+
+static const unsigned gNumThreads = 4;
+// Together less than the ring, so nothing is dropped however slow the writer is.
+static const unsigned gNumLines = 1000;
+
+
+void *testLogger(void *arg)
+{
+	unsigned thread = (unsigned)(size_t)arg;
+	for (unsigned i=0; i<gNumLines; i++) {
+		LOG(NOTICE) << "AsyncLogTest " << thread << " " << i;
+	}
+	return NULL;
+}
+
+
+/** Log from the threads and exit, leaving the last records to the exit flush. */
+static void runLoggers(const char* path)
+{
+	gConfig.set("Log.Async",1);
+	gConfig.set("Log.Sink",std::string("file:")+path);
+	gLogInit("AsyncLogTest","NOTICE");
+
+	Thread threads[gNumThreads];
+	for (unsigned t=0; t<gNumThreads; t++) threads[t].start(testLogger,(void*)(size_t)t);
+	for (unsigned t=0; t<gNumThreads; t++) threads[t].join();
+	exit(0);
+}
+
+
+/** Read the sink back and check the count and order of each thread's lines. */
+static bool checkLog(const char* path)
+{
+	FILE *fp = fopen(path,"r");
+	if (!fp) {
+		COUT("cannot open " << path);
+		return false;
+	}
+	unsigned next[gNumThreads];
+	memset(next,0,sizeof(next));
+	bool pass = true;
+	char line[1024];
+	while (fgets(line,sizeof(line),fp)) {
+		const char *rp = strstr(line,"AsyncLogTest ");
+		unsigned thread, i;
+		if (!rp || (sscanf(rp,"AsyncLogTest %u %u",&thread,&i)!=2)) continue;
+		if ((thread>=gNumThreads) || (i!=next[thread])) {
+			COUT("thread " << thread << " line " << i << " out of order");
+			pass = false;
+			continue;
+		}
+		next[thread]++;
+	}
+	fclose(fp);
+	for (unsigned t=0; t<gNumThreads; t++) {
+		if (next[t]==gNumLines) continue;
+		COUT("thread " << t << ": " << next[t] << " of " << gNumLines << " lines");
+		pass = false;
+	}
+	return pass;
+}
+
+
+int main(int argc, char *argv[])
+{
+	char path[64];
+	sprintf(path,"/tmp/AsyncLogTest.%d",getpid());
+	unlink(path);
+
+	pid_t pid = fork();
+	if (pid<0) return 1;
+	if (pid==0) runLoggers(path);
+	int status;
+	if ((waitpid(pid,&status,0)!=pid) || !WIFEXITED(status) || WEXITSTATUS(status)) {
+		COUT("logging process failed");
+		return 1;
+	}
+
+	bool pass = checkLog(path);
+	COUT("async log: " << (pass ? "passed" : "FAILED"));
+	unlink(path);
+	return pass ? 0 : 1;
+}
+
+// vim: ts=4 sw=4
@@ -29,6 +29,10 @@
 #include "BitVector.h"
 #include <iostream>
 #include <stdio.h>
+#include <string.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 using namespace std;
 
@@ -198,21 +202,78 @@ void BitVector::LSB8MSB()
 
 
 
+void Generator::computeTable()
+{
+	const uint64_t coeff = mCoeff << (64-mLen);
+	for (unsigned i=0; i<256; i++) {
+		uint64_t reg = (uint64_t)i << 56;
+		for (unsigned j=0; j<8; j++) {
+			const uint64_t fb = reg>>63;
+			reg <<= 1;
+			if (fb) reg ^= coeff;
+		}
+		mTable[i] = reg;
+	}
+}
+
+
+/** Pack 8 bits, one per char, into a byte, first bit in the MSB. */
+static inline unsigned packByte(const char *bits)
+{
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+	uint64_t word;
+	memcpy(&word,bits,8);
+	return ((word & 0x0101010101010101ULL) * 0x8040201008040201ULL) >> 56;
+#else
+	unsigned byte = 0;
+	for (unsigned i=0; i<8; i++) byte = (byte<<1) | (bits[i] & 0x01);
+	return byte;
+#endif
+}
+
+
+uint64_t Generator::encoderBlock(const char *bits, size_t len)
+{
+	const size_t bytes = len/8;
+	uint64_t reg = 0;
+	for (size_t i=0; i<bytes; i++) {
+		const unsigned char byte = packByte(bits+8*i);
+		reg = encoderBytes(reg,&byte,1);
+	}
+
+	// the last few bits one at a time
+	for (size_t i=8*bytes; i<len; i++) reg = encoderBits(reg,bits[i],1);
+	mState = reg >> (64-mLen);
+	return state();
+}
+
+
+uint64_t Generator::syndromeBlock(const char *bits, size_t len)
+{
+	// The syndrome is the remainder of the whole block, which is the
+	// parity of all but the last mLen bits plus those bits as they are.
+	if (len<=mLen) {
+		clear();
+		for (size_t i=0; i<len; i++) syndromeShift(bits[i]);
+		return state();
+	}
+	const size_t head = len-mLen;
+	uint64_t tail = 0;
+	for (size_t i=head; i<len; i++) tail = (tail<<1) | (bits[i] & 0x01);
+	mState = encoderBlock(bits,head) ^ tail;
+	return state();
+}
+
+
 uint64_t BitVector::syndrome(Generator& gen) const
 {
-	gen.clear();
-	const char *dp = mStart;
-	while (dp<mEnd) gen.syndromeShift(*dp++);
-	return gen.state();
+	return gen.syndromeBlock(mStart,size());
 }
 
 
 uint64_t BitVector::parity(Generator& gen) const
 {
-	gen.clear();
-	const char *dp = mStart;
-	while (dp<mEnd) gen.encoderShift(*dp++);
-	return gen.state();
+	return gen.encoderBlock(mStart,size());
 }
 
 
@@ -297,6 +358,7 @@ ViterbiR2O4::ViterbiR2O4()
 	computeStateTables(0);
 	computeStateTables(1);
 	computeGeneratorTable();
+	computeBranchMasks();
 }
 
 
@@ -335,6 +397,22 @@ void ViterbiR2O4::computeGeneratorTable()
 
 
 
+void ViterbiR2O4::computeBranchMasks()
+{
+	for (unsigned j=0; j<mIStates/2; j++) {
+		const uint32_t out = mGeneratorTable[j<<1];
+		mBranchMask[0][j] = (out & 0x02) ? -1 : 0;
+		mBranchMask[1][j] = (out & 0x01) ? -1 : 0;
+		// Both generators tap the newest and oldest bits, so the other
+		// three branches of the butterfly have the complementary output.
+		assert(mGeneratorTable[(j<<1)|0x01] == (out ^ mOMask));
+		assert(mGeneratorTable[(j+mIStates/2)<<1] == (out ^ mOMask));
+	}
+}
+
+
+
+
 void ViterbiR2O4::branchCandidates()
 {
 	// Branch to generate new input states.
@@ -404,6 +482,141 @@ const ViterbiR2O4::vCand& ViterbiR2O4::step(uint32_t inSample, const float *prob
 }
 
 
+/** Fixed point scale of the path metrics. */
+#define VITERBI_METRIC_SCALE 64.0F
+
+/*
+	State s is the last mOrder input bits, newest in bit 0, and is reached
+	from the lower state s>>1 or the upper state (s>>1)+mIStates/2. As in
+	pruneCandidates(), the lower path survives only if it is strictly cheaper.
+*/
+#ifdef __SSE2__
+unsigned ViterbiR2O4::addCompareSelect(const int16_t *hard, const int16_t *weight, uint16_t &decisions)
+{
+	const __m128i w0 = _mm_set1_epi16(weight[0]);
+	const __m128i w1 = _mm_set1_epi16(weight[1]);
+	const __m128i mask0 = _mm_xor_si128(_mm_load_si128((const __m128i*)mBranchMask[0]), _mm_set1_epi16(hard[0]));
+	const __m128i mask1 = _mm_xor_si128(_mm_load_si128((const __m128i*)mBranchMask[1]), _mm_set1_epi16(hard[1]));
+
+	// branch costs for a 0 input from the lower states, and the complement
+	const __m128i bm = _mm_add_epi16(_mm_and_si128(mask0,w0), _mm_and_si128(mask1,w1));
+	const __m128i bmc = _mm_sub_epi16(_mm_add_epi16(w0,w1), bm);
+
+	const __m128i lower = _mm_load_si128((const __m128i*)mMetrics);
+	const __m128i upper = _mm_load_si128((const __m128i*)(mMetrics+mIStates/2));
+
+	// even and odd successors of each butterfly
+	const __m128i lowerEven = _mm_adds_epi16(lower,bm);
+	const __m128i upperEven = _mm_adds_epi16(upper,bmc);
+	const __m128i lowerOdd = _mm_adds_epi16(lower,bmc);
+	const __m128i upperOdd = _mm_adds_epi16(upper,bm);
+	const __m128i even = _mm_min_epi16(lowerEven,upperEven);
+	const __m128i odd = _mm_min_epi16(lowerOdd,upperOdd);
+	const __m128i keepEven = _mm_cmplt_epi16(lowerEven,upperEven);
+	const __m128i keepOdd = _mm_cmplt_epi16(lowerOdd,upperOdd);
+
+	// back into state order
+	__m128i next0 = _mm_unpacklo_epi16(even,odd);
+	__m128i next1 = _mm_unpackhi_epi16(even,odd);
+	const __m128i keep = _mm_packs_epi16(_mm_unpacklo_epi16(keepEven,keepOdd),
+					     _mm_unpackhi_epi16(keepEven,keepOdd));
+	decisions = ~_mm_movemask_epi8(keep) & 0xffff;
+
+	// find the best metric and renormalize to it
+	__m128i best = _mm_min_epi16(next0,next1);
+	best = _mm_min_epi16(best, _mm_shuffle_epi32(best, _MM_SHUFFLE(1,0,3,2)));
+	best = _mm_min_epi16(best, _mm_shuffle_epi32(best, _MM_SHUFFLE(2,3,0,1)));
+	best = _mm_min_epi16(best, _mm_shufflehi_epi16(_mm_shufflelo_epi16(best, _MM_SHUFFLE(2,3,0,1)), _MM_SHUFFLE(2,3,0,1)));
+	const unsigned isBest = _mm_movemask_epi8(_mm_cmpeq_epi16(next0,best))
+		| (_mm_movemask_epi8(_mm_cmpeq_epi16(next1,best)) << 16);
+	next0 = _mm_sub_epi16(next0,best);
+	next1 = _mm_sub_epi16(next1,best);
+	_mm_store_si128((__m128i*)mMetrics, next0);
+	_mm_store_si128((__m128i*)(mMetrics+mIStates/2), next1);
+
+	return __builtin_ctz(isBest)/2;
+}
+#else
+unsigned ViterbiR2O4::addCompareSelect(const int16_t *hard, const int16_t *weight, uint16_t &decisions)
+{
+	int next[mIStates];
+	decisions = 0;
+	for (unsigned j=0; j<mIStates/2; j++) {
+		const int bm = ((mBranchMask[0][j]^hard[0]) & weight[0]) + ((mBranchMask[1][j]^hard[1]) & weight[1]);
+		const int bmc = weight[0] + weight[1] - bm;
+		const int lower = mMetrics[j];
+		const int upper = mMetrics[j+mIStates/2];
+		for (unsigned b=0; b<2; b++) {
+			const int fromLower = lower + (b ? bmc : bm);
+			const int fromUpper = upper + (b ? bm : bmc);
+			const unsigned s = (j<<1) | b;
+			if (fromLower < fromUpper) next[s] = fromLower;
+			else {
+				next[s] = fromUpper;
+				decisions |= 0x01 << s;
+			}
+		}
+	}
+
+	unsigned bestState = 0;
+	for (unsigned s=1; s<mIStates; s++) {
+		if (next[s] < next[bestState]) bestState = s;
+	}
+	const int best = next[bestState];
+	for (unsigned s=0; s<mIStates; s++) mMetrics[s] = next[s] - best;
+
+	return bestState;
+}
+#endif
+
+
+void ViterbiR2O4::decode(const float *soft, size_t sz, char *out, size_t outLen)
+{
+	assert(sz <= mIRate*outLen);
+
+	// Start in the zero state, which is where the float decoder's
+	// survivors effectively start, their history being all zeros.
+	// The bias outweighs any path cost over mOrder steps.
+	mMetrics[0] = 0;
+	for (unsigned s=1; s<mIStates; s++) mMetrics[s] = 0x4000;
+
+	const size_t steps = outLen + mDeferral;
+	for (size_t t=0; t<steps; t++) {
+		// Same cost function as the float decoder, less the cost of
+		// agreeing with the received bit, which is common to all paths.
+		// The symbols after the end are unknowns and cost nothing.
+		int16_t hard[mIRate];
+		int16_t weight[mIRate];
+		for (unsigned k=0; k<mIRate; k++) {
+			const size_t i = t*mIRate + k;
+			hard[k] = 0;
+			weight[k] = 0;
+			if (i>=sz) continue;
+			float pVal = soft[i];
+			if (pVal>0.5F) {
+				hard[k] = -1;
+				pVal = 1.0F-pVal;
+			}
+			float ipVal = 1.0F-pVal;
+			if (pVal<0.01F) pVal = 0.01;
+			if (ipVal<0.01F) ipVal = 0.01;
+			weight[k] = (int16_t)((0.25F/pVal - 0.25F/ipVal)*VITERBI_METRIC_SCALE + 0.5F);
+		}
+
+		uint16_t &decisions = mDecisions[t%mHistory];
+		unsigned state = addCompareSelect(hard,weight,decisions);
+		if (t<mDeferral) continue;
+
+		// trace back from the best state to the input of step t-mDeferral
+		for (unsigned u=0; u<mDeferral; u++) {
+			const unsigned upper = (mDecisions[(t-u)%mHistory] >> state) & 0x01;
+			state = (state>>1) | (upper<<(mOrder-1));
+		}
+		out[t-mDeferral] = state & 0x01;
+	}
+}
+
+
 uint64_t Parity::syndrome(const BitVector& receivedCodeword)
 {
 	return receivedCodeword.syndrome(*this);
@@ -450,79 +663,21 @@ BitVector SoftVector::sliced() const
 
 void SoftVector::decode(ViterbiR2O4 &decoder, BitVector& target) const
 {
-	const size_t sz = size();
-	const unsigned deferral = decoder.deferral();
-	const size_t ctsz = sz + deferral*decoder.iRate();
-	assert(sz <= decoder.iRate()*target.size());
+	decoder.decode(mStart,size(),target.begin(),target.size());
+}
 
-	// Build a "history" array where each element contains the full history.
-	uint32_t history[ctsz];
-	{
-		BitVector bits = sliced();
-		uint32_t accum = 0;
-		for (size_t i=0; i<sz; i++) {
-			accum = (accum<<1) | bits.bit(i);
-			history[i] = accum;
-		}
-		// Repeat last bit at the end.
-		for (size_t i=sz; i<ctsz; i++) {
-			accum = (accum<<1) | (accum & 0x01);
-			history[i] = accum;
-		}
-	}
 
-	// Precompute metric tables.
-	float matchCostTable[ctsz];
-	float mismatchCostTable[ctsz];
-	{
-		const float *dp = mStart;
-		for (size_t i=0; i<sz; i++) {
-			// pVal is the probability that a bit is correct.
-			// ipVal is the probability that a bit is incorrect.
-			float pVal = dp[i];
-			if (pVal>0.5F) pVal = 1.0F-pVal;
-			float ipVal = 1.0F-pVal;
-			// This is a cheap approximation to an ideal cost function.
-			if (pVal<0.01F) pVal = 0.01;
-			if (ipVal<0.01F) ipVal = 0.01;
-			matchCostTable[i] = 0.25F/ipVal;
-			mismatchCostTable[i] = 0.25F/pVal;
-		}
-	
-		// pad end of table with unknowns
-		for (size_t i=sz; i<ctsz; i++) {
-			matchCostTable[i] = 0.5F;
-			mismatchCostTable[i] = 0.5F;
-		}
-	}
+void SoftVector::map(const unsigned *map, size_t mapSize, SoftVector& dest) const
+{
+	float *dp = dest.mStart;
+	for (size_t i=0; i<mapSize; i++) dp[i] = mStart[map[i]];
+}
 
-	{
-		decoder.initializeStates();
-		// Each sample of history[] carries its history.
-		// So we only have to process every iRate-th sample.
-		const unsigned step = decoder.iRate();
-		// input pointer
-		const uint32_t *ip = history + step - 1;
-		// output pointers
-		char *op = target.begin();
-		const char *const opt = target.end();
-		// table pointers
-		const float* match = matchCostTable;
-		const float* mismatch = mismatchCostTable;
-		size_t oCount = 0;
-		while (op<opt) {
-			// Viterbi algorithm
-			assert(match-matchCostTable<sizeof(matchCostTable)/sizeof(matchCostTable[0])-1);
-			assert(mismatch-mismatchCostTable<sizeof(mismatchCostTable)/sizeof(mismatchCostTable[0])-1);
-			const ViterbiR2O4::vCand &minCost = decoder.step(*ip, match, mismatch);
-			ip += step;
-			match += step;
-			mismatch += step;
-			// output
-			if (oCount>=deferral) *op++ = (minCost.iState >> deferral)&0x01;
-			oCount++;
-		}
-	}
+
+void SoftVector::unmap(const unsigned *map, size_t mapSize, SoftVector& dest) const
+{
+	float *dp = dest.mStart;
+	for (size_t i=0; i<mapSize; i++) dp[map[i]] = mStart[i];
 }
 
 
@@ -600,4 +755,364 @@ bool BitVector::unhex(const char* src)
 	return true;
 }
 
+
+
+
+
+PackedBitVector::PackedBitVector(const PackedBitVector& other1, const PackedBitVector& other2)
+	:mData(NULL)
+{
+	resize(other1.size()+other2.size());
+	other1.copyToSegment(*this,0);
+	other2.copyToSegment(*this,other1.size());
+}
+
+
+PackedBitVector::PackedBitVector(const BitVector& source)
+	:mData(NULL)
+{
+	resize(source.size());
+	copyFrom(source);
+}
+
+
+PackedBitVector::PackedBitVector(const char *valString)
+	:mData(NULL)
+{
+	resize(strlen(valString));
+	for (size_t i=0; i<size(); i++) {
+		if (valString[i]=='1') setBit(i,true);
+	}
+}
+
+
+void PackedBitVector::resize(size_t newSize)
+{
+	if (mData!=NULL) delete[] mData;
+	const size_t words = (newSize+63)/64;
+	if (words==0) mData=NULL;
+	else {
+		mData = new uint64_t[words];
+		memset(mData,0,words*sizeof(uint64_t));
+	}
+	mWords = mData;
+	mOffset = 0;
+	mSize = newSize;
+}
+
+
+void PackedBitVector::clone(const PackedBitVector& other)
+{
+	resize(other.size());
+	other.copyTo(*this);
+}
+
+
+void PackedBitVector::operator=(PackedBitVector& other)
+{
+	clear();
+	mData = other.mData;
+	mWords = other.mWords;
+	mOffset = other.mOffset;
+	mSize = other.mSize;
+	other.mData = NULL;
+}
+
+
+uint64_t PackedBitVector::peekField(size_t readIndex, unsigned length) const
+{
+	assert(length<=64);
+	assert(readIndex+length<=mSize);
+	if (length==0) return 0;
+	const size_t pos = mOffset + readIndex;
+	const uint64_t *wp = mWords + (pos>>6);
+	const unsigned shift = pos & 63;
+	uint64_t accum = wp[0] << shift;
+	if (shift+length>64) accum |= wp[1] >> (64-shift);
+	return accum >> (64-length);
+}
+
+
+void PackedBitVector::fillField(size_t writeIndex, uint64_t value, unsigned length)
+{
+	assert(length<=64);
+	assert(writeIndex+length<=mSize);
+	if (length==0) return;
+	const size_t pos = mOffset + writeIndex;
+	uint64_t *wp = mWords + (pos>>6);
+	const unsigned shift = pos & 63;
+	// the field and its mask, top-aligned
+	const uint64_t mask = ~0ULL << (64-length);
+	value <<= (64-length);
+	wp[0] = (wp[0] & ~(mask>>shift)) | ((value & mask)>>shift);
+	if (shift+length>64) {
+		wp[1] = (wp[1] & ~(mask<<(64-shift))) | ((value & mask)<<(64-shift));
+	}
+}
+
+
+/** Reverse the low length bits of a word. */
+static uint64_t reverseBits(uint64_t value, unsigned length)
+{
+	if (length==0) return 0;
+	value = ((value>>1) & 0x5555555555555555ULL) | ((value & 0x5555555555555555ULL)<<1);
+	value = ((value>>2) & 0x3333333333333333ULL) | ((value & 0x3333333333333333ULL)<<2);
+	value = ((value>>4) & 0x0f0f0f0f0f0f0f0fULL) | ((value & 0x0f0f0f0f0f0f0f0fULL)<<4);
+	value = __builtin_bswap64(value);
+	return value >> (64-length);
+}
+
+
+uint64_t PackedBitVector::peekFieldReversed(size_t readIndex, unsigned length) const
+{
+	return reverseBits(peekField(readIndex,length),length);
+}
+
+
+void PackedBitVector::fillFieldReversed(size_t writeIndex, uint64_t value, unsigned length)
+{
+	fillField(writeIndex,reverseBits(value,length),length);
+}
+
+
+uint64_t PackedBitVector::readField(size_t& readIndex, unsigned length) const
+{
+	const uint64_t retVal = peekField(readIndex,length);
+	readIndex += length;
+	return retVal;
+}
+
+
+uint64_t PackedBitVector::readFieldReversed(size_t& readIndex, unsigned length) const
+{
+	const uint64_t retVal = peekFieldReversed(readIndex,length);
+	readIndex += length;
+	return retVal;
+}
+
+
+void PackedBitVector::writeField(size_t& writeIndex, uint64_t value, unsigned length)
+{
+	fillField(writeIndex,value,length);
+	writeIndex += length;
+}
+
+
+void PackedBitVector::writeFieldReversed(size_t& writeIndex, uint64_t value, unsigned length)
+{
+	fillFieldReversed(writeIndex,value,length);
+	writeIndex += length;
+}
+
+
+void PackedBitVector::copyToSegment(PackedBitVector& other, size_t start, size_t span) const
+{
+	assert(span<=mSize);
+	assert(start+span<=other.mSize);
+	for (size_t i=0; i<span; i+=64) {
+		const unsigned len = (span-i<64) ? span-i : 64;
+		other.fillField(start+i,peekField(i,len),len);
+	}
+}
+
+
+void PackedBitVector::copyTo(BitVector& other) const
+{
+	assert(other.size()==mSize);
+	char *dp = other.begin();
+	for (size_t i=0; i<mSize; i+=64) {
+		const unsigned len = (mSize-i<64) ? mSize-i : 64;
+		const uint64_t word = peekField(i,len);
+		for (int j=len-1; j>=0; j--) *dp++ = (word>>j) & 0x01;
+	}
+}
+
+
+void PackedBitVector::copyFrom(const BitVector& other)
+{
+	assert(other.size()==mSize);
+	const char *sp = other.begin();
+	size_t i=0;
+	for (; i+64<=mSize; i+=64) {
+		uint64_t word = 0;
+		for (unsigned j=0; j<8; j++) word = (word<<8) | packByte(sp+i+8*j);
+		fillField(i,word,64);
+	}
+	for (; i<mSize; i++) setBit(i,sp[i] & 0x01);
+}
+
+
+void PackedBitVector::fill(bool value)
+{
+	const uint64_t word = value ? ~0ULL : 0;
+	for (size_t i=0; i<mSize; i+=64) {
+		const unsigned len = (mSize-i<64) ? mSize-i : 64;
+		fillField(i,word,len);
+	}
+}
+
+
+uint64_t PackedBitVector::parity(const Generator& gen) const
+{
+	uint64_t reg = 0;
+	size_t i=0;
+	for (; i+8<=mSize; i+=8) {
+		const unsigned char byte = peekField(i,8);
+		reg = gen.encoderBytes(reg,&byte,1);
+	}
+	reg = gen.encoderBits(reg,peekField(i,mSize-i),mSize-i);
+	return reg >> (64-gen.size());
+}
+
+
+uint64_t PackedBitVector::syndrome(const Generator& gen) const
+{
+	// the remainder of the whole vector, as in Generator::syndromeBlock()
+	if (mSize<=gen.size()) return peekField(0,mSize);
+	const size_t head = mSize - gen.size();
+	return segment(0,head).parity(gen) ^ peekField(head,gen.size());
+}
+
+
+void PackedBitVector::invert()
+{
+	for (size_t i=0; i<mSize; i+=64) {
+		const unsigned len = (mSize-i<64) ? mSize-i : 64;
+		fillField(i,~peekField(i,len),len);
+	}
+}
+
+
+void PackedBitVector::reverse8()
+{
+	assert(mSize>=8);
+	fillFieldReversed(0,peekField(0,8),8);
+}
+
+
+void PackedBitVector::LSB8MSB()
+{
+	const size_t size8 = 8*(mSize/8);
+	for (size_t i=0; i<size8; i+=64) {
+		const unsigned len = (size8-i<64) ? size8-i : 64;
+		// reverse the bits within each byte, keeping the bytes in place
+		uint64_t word = peekField(i,len);
+		word = ((word>>1) & 0x5555555555555555ULL) | ((word & 0x5555555555555555ULL)<<1);
+		word = ((word>>2) & 0x3333333333333333ULL) | ((word & 0x3333333333333333ULL)<<2);
+		word = ((word>>4) & 0x0f0f0f0f0f0f0f0fULL) | ((word & 0x0f0f0f0f0f0f0f0fULL)<<4);
+		fillField(i,word,len);
+	}
+}
+
+
+unsigned PackedBitVector::sum() const
+{
+	unsigned sum = 0;
+	for (size_t i=0; i<mSize; i+=64) {
+		const unsigned len = (mSize-i<64) ? mSize-i : 64;
+		sum += __builtin_popcountll(peekField(i,len));
+	}
+	return sum;
+}
+
+
+void PackedBitVector::map(const unsigned *map, size_t mapSize, PackedBitVector& dest) const
+{
+	// gather a word of output at a time
+	for (size_t i=0; i<mapSize; i+=64) {
+		const unsigned len = (mapSize-i<64) ? mapSize-i : 64;
+		uint64_t word = 0;
+		for (unsigned j=0; j<len; j++) word = (word<<1) | bit(map[i+j]);
+		dest.fillField(i,word,len);
+	}
+}
+
+
+void PackedBitVector::unmap(const unsigned *map, size_t mapSize, PackedBitVector& dest) const
+{
+	for (size_t i=0; i<mapSize; i+=64) {
+		const unsigned len = (mapSize-i<64) ? mapSize-i : 64;
+		const uint64_t word = peekField(i,len);
+		for (unsigned j=0; j<len; j++) dest.setBit(map[i+j],(word>>(len-1-j)) & 0x01);
+	}
+}
+
+
+void PackedBitVector::pack(unsigned char* targ) const
+{
+	// Assumes MSB-first packing.
+	const size_t bytes = mSize/8;
+	size_t i=0;
+	for (; i+8<=bytes; i+=8) {
+		const uint64_t word = peekField(8*i,64);
+		for (unsigned j=0; j<8; j++) targ[i+j] = word >> (56-8*j);
+	}
+	for (; i<bytes; i++) targ[i] = peekField(8*i,8);
+	const unsigned rem = mSize - 8*bytes;
+	if (rem==0) return;
+	targ[bytes] = peekField(8*bytes,rem) << (8-rem);
+}
+
+
+void PackedBitVector::unpack(const unsigned char* src)
+{
+	// Assumes MSB-first packing.
+	const size_t bytes = mSize/8;
+	size_t i=0;
+	for (; i+8<=bytes; i+=8) {
+		uint64_t word = 0;
+		for (unsigned j=0; j<8; j++) word = (word<<8) | src[i+j];
+		fillField(8*i,word,64);
+	}
+	for (; i<bytes; i++) fillField(8*i,src[i],8);
+	const unsigned rem = mSize - 8*bytes;
+	if (rem==0) return;
+	fillField(8*bytes,src[bytes] >> (8-rem),rem);
+}
+
+
+void PackedBitVector::hex(ostream& os) const
+{
+	os << std::hex;
+	unsigned digits = size()/4;
+	size_t wp=0;
+	for (unsigned i=0; i<digits; i++) {
+		os << readField(wp,4);
+	}
+	os << std::dec;
+}
+
+
+bool PackedBitVector::unhex(const char* src)
+{
+	// Assumes MSB-first packing.
+	unsigned int val;
+	unsigned digits = size()/4;
+	for (unsigned i=0; i<digits; i++) {
+		if (sscanf(src+i, "%1x", &val) < 1) {
+			return false;
+		}
+		fillField(i*4,val,4);
+	}
+	unsigned whole = digits*4;
+	unsigned rem = size() - whole;
+	if (rem>0) {
+		if (sscanf(src+digits, "%1x", &val) < 1) {
+			return false;
+		}
+		fillField(whole,val,rem);
+	}
+	return true;
+}
+
+
+ostream& operator<<(ostream& os, const PackedBitVector& hv)
+{
+	for (size_t i=0; i<hv.size(); i++) {
+		if (hv.bit(i)) os << '1';
+		else os << '0';
+	}
+	return os;
+}
+
 // vim: ts=4 sw=4
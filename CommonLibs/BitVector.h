@@ -31,11 +31,17 @@
 
 
 class BitVector;
+class PackedBitVector;
 class SoftVector;
 
 
 
-/** Shift-register (LFSR) generator. */
+/**
+	Shift-register (LFSR) generator.
+	Whole blocks are run a byte at a time through a table built from
+	the polynomial, on a copy of the register shifted up to the top of
+	a 64-bit word so that any register length works the same way.
+*/
 class Generator {
 
 	private:
@@ -45,6 +51,7 @@ class Generator {
 	uint64_t mMask;		///< mask for reading state
 	unsigned mLen;		///< number of bits used in shift register
 	unsigned mLen_1;	///< mLen - 1
+	uint64_t mTable[256];	///< top-aligned register update for each leading byte
 
 	public:
 
@@ -52,7 +59,7 @@ class Generator {
 		:mCoeff(wCoeff),mState(0),
 		mMask((1ULL<<wLen)-1),
 		mLen(wLen),mLen_1(wLen-1)
-	{ assert(wLen<64); }
+	{ assert(wLen<64); computeTable(); }
 
 	void clear() { mState=0; }
 
@@ -84,6 +91,53 @@ class Generator {
 		if (fb) mState ^= mCoeff;
 	}
 
+	/**
+		Clear the state and run encoderShift() over a block.
+		@param bits The block, one bit per char.
+		@param len The number of bits.
+		@return The resulting state.
+	*/
+	uint64_t encoderBlock(const char *bits, size_t len);
+
+	/**
+		Clear the state and run syndromeShift() over a block.
+		@param bits The block, one bit per char.
+		@param len The number of bits.
+		@return The resulting state.
+	*/
+	uint64_t syndromeBlock(const char *bits, size_t len);
+
+	/**
+		Run encoderShift() over packed bytes, MSB first, starting from
+		and returning a top-aligned register, state<<(64-size()).
+	*/
+	uint64_t encoderBytes(uint64_t reg, const unsigned char *bytes, size_t len) const
+	{
+		for (size_t i=0; i<len; i++)
+			reg = (reg<<8) ^ mTable[(reg>>56) ^ bytes[i]];
+		return reg;
+	}
+
+	/**
+		Run encoderShift() over the low len bits of value, MSB first,
+		on a top-aligned register.
+	*/
+	uint64_t encoderBits(uint64_t reg, uint64_t value, unsigned len) const
+	{
+		const uint64_t coeff = mCoeff << (64-mLen);
+		for (int i=len-1; i>=0; i--) {
+			const uint64_t fb = (reg>>63) ^ ((value>>i) & 0x01);
+			reg <<= 1;
+			if (fb) reg ^= coeff;
+		}
+		return reg;
+	}
+
+	private:
+
+	/** Precompute the byte table from the coefficients. */
+	void computeTable();
+
 
 };
 
@@ -136,6 +190,7 @@ class ViterbiR2O4 {
 		static const uint32_t mOMask = (0x01<<mIRate)-1;	///< ouput mask, all iRate low bits set
 		static const unsigned mNumCands = mIStates*2;		///< number of candidates to generate during branching
 		static const unsigned mDeferral = 6*mOrder;			///< deferral to be used
+		static const unsigned mHistory = 32;				///< traceback memory depth, a power of two > mDeferral
 		//@}
 		//@}
 
@@ -144,6 +199,7 @@ class ViterbiR2O4 {
 		uint32_t mCoeffs[mIRate];					///< polynomial for each generator
 		uint32_t mStateTable[mIRate][2*mIStates];	///< precomputed generator output tables
 		uint32_t mGeneratorTable[2*mIStates];		///< precomputed coder output table
+		int16_t mBranchMask[mIRate][mIStates/2] __attribute__((aligned(16)));	///< generator outputs for a 0 input from the lower states, as lane masks
 		//@}
 	
 	public:
@@ -175,6 +231,12 @@ class ViterbiR2O4 {
 		vCand mCandidates[2*mIStates];		///< current candidate pool
 		//@}
 
+		/**@name Traceback decoder state. */
+		//@{
+		int16_t mMetrics[mIStates] __attribute__((aligned(16)));	///< path metric of each state, best at 0
+		uint16_t mDecisions[mHistory];		///< per step, bit s set if state s came from the upper predecessor
+		//@}
+
 	public:
 
 		unsigned iRate() const { return mIRate; }
@@ -194,6 +256,18 @@ class ViterbiR2O4 {
 		*/
 		const vCand& step(uint32_t inSample, const float *probs, const float *iprobs);
 
+		/**
+			Decode a block of soft symbols with 16-bit path metrics and a
+			traceback memory, vectorized where SSE2 is available.
+			Each output is traced back deferral() steps from the best state,
+			giving the same bits as running step() over the block.
+			@param soft The soft symbols, probability of a 1.
+			@param sz The number of soft symbols, at most iRate()*outLen.
+			@param out The decoded bits.
+			@param outLen The number of bits to decode.
+		*/
+		void decode(const float *soft, size_t sz, char *out, size_t outLen);
+
 	private:
 
 		/** Branch survivors into new candidates. */
@@ -220,6 +294,18 @@ class ViterbiR2O4 {
 		*/
 		void computeGeneratorTable();
 
+		/** Precompute the branch masks from the generator table. */
+		void computeBranchMasks();
+
+		/**
+			One add-compare-select step over all states.
+			@param hard Per coded bit, all ones if the received bit is a 1.
+			@param weight Per coded bit, the cost of disagreeing with the received bit.
+			@param decisions Receives the survivor decisions of the step.
+			@return The first state with the lowest metric.
+		*/
+		unsigned addCompareSelect(const int16_t *hard, const int16_t *weight, uint16_t &decisions);
+
 };
 
 
@@ -347,6 +433,197 @@ std::ostream& operator<<(std::ostream&, const BitVector&);
 
 
 
+/**
+	A bit vector packed into 64-bit words, first bit in the MSB.
+	Segments alias the parent storage at any bit offset, with the same
+	ownership rules as Vector. Fields, copies and reorderings move up
+	to 64 bits at a time. Convert from and to BitVector with the
+	constructor, copyFrom() and copyTo().
+*/
+class PackedBitVector {
+
+	protected:
+
+	uint64_t* mData;	///< allocated words, if any
+	uint64_t* mWords;	///< word holding the first bit
+	unsigned mOffset;	///< position of the first bit in *mWords, counted from the MSB
+	size_t mSize;		///< number of bits
+
+	public:
+
+	/**@name Constructors. */
+	//@{
+
+	/** Build a zeroed vector of a given size. */
+	PackedBitVector(size_t len=0):mData(NULL) { resize(len); }
+
+	/** Build an alias with explicit values. */
+	PackedBitVector(uint64_t* wData, uint64_t* wWords, unsigned wOffset, size_t wSize)
+		:mData(wData),mWords(wWords),mOffset(wOffset),mSize(wSize)
+	{ }
+
+	/** Build a vector by shifting the data block. */
+	PackedBitVector(PackedBitVector& other)
+		:mData(other.mData),mWords(other.mWords),mOffset(other.mOffset),mSize(other.mSize)
+	{ other.mData=NULL; }
+
+	/** Build a vector by copying another. */
+	PackedBitVector(const PackedBitVector& other):mData(NULL) { clone(other); }
+
+	/** Build a vector by concatenation. */
+	PackedBitVector(const PackedBitVector& other1, const PackedBitVector& other2);
+
+	/** Build a vector by packing a BitVector. */
+	PackedBitVector(const BitVector& source);
+
+	/** Construct from a string of "0" and "1". */
+	PackedBitVector(const char* valString);
+
+	//@}
+
+	/** Destroy a vector, deleting held memory. */
+	~PackedBitVector() { clear(); }
+
+	/** Change the size, zeroing the content. */
+	void resize(size_t newSize);
+
+	/** Release memory and clear pointers. */
+	void clear() { resize(0); }
+
+	/** Copy data from another vector. */
+	void clone(const PackedBitVector& other);
+
+	/** Assign from another vector, shifting ownership. */
+	void operator=(PackedBitVector& other);
+
+	/** Assign from another vector, copying. */
+	void operator=(const PackedBitVector& other) { clone(other); }
+
+	size_t size() const { return mSize; }
+
+	/** Index a single bit. */
+	bool bit(size_t index) const
+	{
+		assert(index<mSize);
+		const size_t pos = mOffset + index;
+		return (mWords[pos>>6] >> (63-(pos&63))) & 0x01;
+	}
+
+	/** Set a single bit. */
+	void setBit(size_t index, bool value)
+	{
+		assert(index<mSize);
+		const size_t pos = mOffset + index;
+		const uint64_t mask = 1ULL << (63-(pos&63));
+		if (value) mWords[pos>>6] |= mask;
+		else mWords[pos>>6] &= ~mask;
+	}
+
+	/**@name Aliases. */
+	//@{
+	PackedBitVector segment(size_t start, size_t span)
+	{
+		assert(start+span<=mSize);
+		const size_t pos = mOffset + start;
+		return PackedBitVector(NULL,mWords+(pos>>6),pos&63,span);
+	}
+
+	const PackedBitVector segment(size_t start, size_t span) const
+	{
+		assert(start+span<=mSize);
+		const size_t pos = mOffset + start;
+		return PackedBitVector(NULL,mWords+(pos>>6),pos&63,span);
+	}
+
+	PackedBitVector alias() { return segment(0,size()); }
+
+	PackedBitVector head(size_t span) { return segment(0,span); }
+	const PackedBitVector head(size_t span) const { return segment(0,span); }
+	PackedBitVector tail(size_t start) { return segment(start,size()-start); }
+	const PackedBitVector tail(size_t start) const { return segment(start,size()-start); }
+	//@}
+
+	/**@name Copies. */
+	//@{
+	/** Copy span bits of this vector to a segment of another. */
+	void copyToSegment(PackedBitVector& other, size_t start, size_t span) const;
+	/** Copy all of this vector to a segment of another. */
+	void copyToSegment(PackedBitVector& other, size_t start=0) const { copyToSegment(other,start,size()); }
+	void copyTo(PackedBitVector& other) const { copyToSegment(other,0,size()); }
+	/** Copy a segment of this vector to the start of another. */
+	void segmentCopyTo(PackedBitVector& other, size_t start, size_t span) const
+		{ segment(start,span).copyToSegment(other,0,span); }
+	/** Unpack all of this vector into a BitVector of the same size. */
+	void copyTo(BitVector& other) const;
+	/** Pack a BitVector of the same size into this vector. */
+	void copyFrom(const BitVector& other);
+	//@}
+
+	void fill(bool value);
+	void zero() { fill(false); }
+
+	/**@name FEC operations. */
+	//@{
+	/** Calculate the syndrome of the vector with the given Generator. */
+	uint64_t syndrome(const Generator& gen) const;
+	/** Calculate the parity word for the vector with the given Generator. */
+	uint64_t parity(const Generator& gen) const;
+	//@}
+
+	/** Invert 0<->1. */
+	void invert();
+
+	/**@name Byte-wise operations. */
+	//@{
+	/** Reverse an 8-bit vector. */
+	void reverse8();
+	/** Reverse groups of 8 within the vector (byte reversal). */
+	void LSB8MSB();
+	//@}
+
+	/**@name Serialization and deserialization. */
+	//@{
+	uint64_t peekField(size_t readIndex, unsigned length) const;
+	uint64_t peekFieldReversed(size_t readIndex, unsigned length) const;
+	uint64_t readField(size_t& readIndex, unsigned length) const;
+	uint64_t readFieldReversed(size_t& readIndex, unsigned length) const;
+	void fillField(size_t writeIndex, uint64_t value, unsigned length);
+	void fillFieldReversed(size_t writeIndex, uint64_t value, unsigned length);
+	void writeField(size_t& writeIndex, uint64_t value, unsigned length);
+	void writeFieldReversed(size_t& writeIndex, uint64_t value, unsigned length);
+	//@}
+
+	/** Sum of bits. */
+	unsigned sum() const;
+
+	/** Reorder bits, dest[i] = this[map[i]]. */
+	void map(const unsigned *map, size_t mapSize, PackedBitVector& dest) const;
+
+	/** Reorder bits, dest[map[i]] = this[i]. */
+	void unmap(const unsigned *map, size_t mapSize, PackedBitVector& dest) const;
+
+	/** Pack into a char array. */
+	void pack(unsigned char*) const;
+
+	/** Unpack from a char array. */
+	void unpack(const unsigned char*);
+
+	/** Make a hexdump string. */
+	void hex(std::ostream&) const;
+
+	/** Unpack from a hexdump string.
+	*  @returns true on success, false on error. */
+	bool unhex(const char*);
+
+};
+
+
+
+std::ostream& operator<<(std::ostream&, const PackedBitVector&);
+
+
+
+
 
 
 /**
@@ -415,6 +692,12 @@ class SoftVector: public Vector<float> {
 	/** Fill with "unknown" values. */
 	void unknown() { fill(0.5F); }
 
+	/** Reorder soft bits, dest[i] = this[map[i]]. */
+	void map(const unsigned *map, size_t mapSize, SoftVector& dest) const;
+
+	/** Reorder soft bits, dest[map[i]] = this[i]. */
+	void unmap(const unsigned *map, size_t mapSize, SoftVector& dest) const;
+
 	/** Return a hard bit value from a given index by slicing. */
 	bool bit(size_t index) const
 	{
@@ -82,6 +82,14 @@ ConfigurationTable::ConfigurationTable(const char* filename, const char *wCmdNam
 
 
 
+/** True for the keys that set logging levels. */
+static bool isLogLevel(const string& key)
+{
+	return key.compare(0,9,"Log.Level")==0;
+}
+
+
+
 bool ConfigurationTable::defines(const string& key)
 {
 	assert(mDB);
@@ -321,8 +329,10 @@ bool ConfigurationTable::unset(const string& key)
 	ConfigurationMap::iterator where = mCache.find(key);
 	if (where!=mCache.end()) mCache.erase(where);
 	// Don't delete it; just set VALUESTRING to NULL.
-	string cmd = "UPDATE CONFIG SET VALUESTRING=NULL WHERE KEYSTRING=='"+key+"'";
-	return sqlite3_command(mDB,cmd.c_str());
+	const char* params[] = { key.c_str() };
+	bool success = sqlite3_command(mDB,"UPDATE CONFIG SET VALUESTRING=NULL WHERE KEYSTRING==?",1,params);
+	if (isLogLevel(key)) gLogLevelsChanged();
+	return success;
 }
 
 bool ConfigurationTable::remove(const string& key)
@@ -335,8 +345,10 @@ bool ConfigurationTable::remove(const string& key)
 	ConfigurationMap::iterator where = mCache.find(key);
 	if (where!=mCache.end()) mCache.erase(where);
 	// Really remove it.
-	string cmd = "DELETE FROM CONFIG WHERE KEYSTRING=='"+key+"'";
-	return sqlite3_command(mDB,cmd.c_str());
+	const char* params[] = { key.c_str() };
+	bool success = sqlite3_command(mDB,"DELETE FROM CONFIG WHERE KEYSTRING==?",1,params);
+	if (isLogLevel(key)) gLogLevelsChanged();
+	return success;
 }
 
 
@@ -344,9 +356,11 @@ bool ConfigurationTable::remove(const string& key)
 void ConfigurationTable::find(const string& pat, ostream& os) const
 {
 	// Prepare the statement.
-	string cmd = "SELECT KEYSTRING,VALUESTRING FROM CONFIG WHERE KEYSTRING LIKE \"%" + pat + "%\"";
-	sqlite3_stmt *stmt;
-	if (sqlite3_prepare_statement(mDB,&stmt,cmd.c_str())) return;
+	static const char* query = "SELECT KEYSTRING,VALUESTRING FROM CONFIG WHERE KEYSTRING LIKE ?";
+	sqlite3_stmt *stmt = sqlite3_cached_statement(mDB,query);
+	if (!stmt) return;
+	string like = "%" + pat + "%";
+	sqlite3_bind_text(stmt,1,like.c_str(),-1,SQLITE_TRANSIENT);
 	// Read the result.
 	int src = sqlite3_run_query(mDB,stmt);
 	while (src==SQLITE_ROW) {
@@ -356,7 +370,7 @@ void ConfigurationTable::find(const string& pat, ostream& os) const
 		else os << "(null)" << endl;
 		src = sqlite3_run_query(mDB,stmt);
 	}
-	sqlite3_finalize(stmt);
+	sqlite3_release_statement(mDB,query,stmt);
 }
 
 
@@ -364,10 +378,11 @@ bool ConfigurationTable::set(const string& key, const string& value)
 {
 	assert(mDB);
 	ScopedLock lock(mLock);
-	string cmd = "INSERT OR REPLACE INTO CONFIG (KEYSTRING,VALUESTRING,OPTIONAL) VALUES (\"" + key + "\",\"" + value + "\",1)";
-	bool success = sqlite3_command(mDB,cmd.c_str());
+	const char* params[] = { key.c_str(), value.c_str() };
+	bool success = sqlite3_command(mDB,"INSERT OR REPLACE INTO CONFIG (KEYSTRING,VALUESTRING,OPTIONAL) VALUES (?,?,1)",2,params);
 	// Cache the result.
 	if (success) mCache[key] = ConfigurationRecord(value);
+	if (isLogLevel(key)) gLogLevelsChanged();
 	return success;
 }
 
@@ -383,9 +398,10 @@ bool ConfigurationTable::set(const string& key)
 {
 	assert(mDB);
 	ScopedLock lock(mLock);
-	string cmd = "INSERT OR REPLACE INTO CONFIG (KEYSTRING,VALUESTRING,OPTIONAL) VALUES (\"" + key + "\",NULL,1)";
-	bool success = sqlite3_command(mDB,cmd.c_str());
+	const char* params[] = { key.c_str() };
+	bool success = sqlite3_command(mDB,"INSERT OR REPLACE INTO CONFIG (KEYSTRING,VALUESTRING,OPTIONAL) VALUES (?,NULL,1)",1,params);
 	if (success) mCache[key] = ConfigurationRecord(true);
+	if (isLogLevel(key)) gLogLevelsChanged();
 	return success;
 }
 
@@ -406,6 +422,8 @@ void ConfigurationTable::checkCacheAge()
 		mp++;
 		mCache.erase(prev);
 	}
+	// Another process may have changed the logging levels.
+	gLogLevelsChanged();
 }
 
 
@@ -418,6 +436,7 @@ void ConfigurationTable::purge()
 		mp++;
 		mCache.erase(prev);
 	}
+	gLogLevelsChanged();
 }
 
 
@@ -29,6 +29,12 @@
 #include <fstream>
 #include <string>
 #include <stdarg.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+#include <sys/un.h>
 
 #include "Configuration.h"
 #include "Logger.h"
@@ -83,14 +89,34 @@ int getLoggingLevel(const char* filename)
 
 
 
+// Starts at 1, so no generation matches a zero LogLevelCache.
+uint32_t gLogGeneration = 1;
+
+
+void gLogLevelsChanged()
+{
+	__atomic_add_fetch(&gLogGeneration,1,__ATOMIC_RELEASE);
+}
+
+
+uint32_t LogLevelCache::refresh(const char* filename)
+{
+	// Read the generation first, so a change during the lookup
+	// leaves this entry stale rather than wrong.
+	uint32_t generation = __atomic_load_n(&gLogGeneration,__ATOMIC_ACQUIRE) & 0x0ffffff;
+	uint32_t state = (generation<<8) | gGetLoggingLevel(filename);
+	__atomic_store_n(&mState,state,__ATOMIC_RELAXED);
+	return state;
+}
+
+
 int gGetLoggingLevel(const char* filename)
 {
-	// This is called a lot and needs to be efficient.
+	// Call sites cache their levels, so this is only called when the levels change.
 
 	static Mutex sLogCacheLock;
 	static map<uint64_t,int>  sLogCache;
-	static unsigned sCacheCount;
-	static const unsigned sCacheRefreshCount = 1000;
+	static uint32_t sCacheGeneration;
 
 	if (filename==NULL) return gGetLoggingLevel("");
 
@@ -98,14 +124,14 @@ int gGetLoggingLevel(const char* filename)
 	uint64_t key = hs.hash();
 
 	sLogCacheLock.lock();
-	// Time for a cache flush?
-	if (sCacheCount>sCacheRefreshCount) {
+	// Have the levels changed since the cache was filled?
+	uint32_t generation = __atomic_load_n(&gLogGeneration,__ATOMIC_ACQUIRE);
+	if (sCacheGeneration!=generation) {
 		sLogCache.clear();
-		sCacheCount=0;
+		sCacheGeneration=generation;
 	}
 	// Is it cached already?
 	map<uint64_t,int>::const_iterator where = sLogCache.find(key);
-	sCacheCount++;
 	if (where!=sLogCache.end()) {
 		int retVal = where->second;
 		sLogCacheLock.unlock();
@@ -125,6 +151,164 @@ int gGetLoggingLevel(const char* filename)
 
 
 
+/**@name The asynchronous log sink. */
+//@{
+
+/** A formatted record waiting for the writer thread. */
+struct LogRecord {
+	uint32_t sequence;		///< ring position at which this slot is next free (==pos) or full (==pos+1)
+	int priority;
+	struct timeval time;	///< when the record was made
+	char *text;				///< malloc'd by the logging thread, freed by the writer
+};
+
+/** Where the writer thread puts records. */
+enum LogSink { SyslogSink, FileSink, SocketSink };
+
+static const unsigned sLogRingSize = 4096;		///< a power of 2
+static LogRecord sLogRing[sLogRingSize];		///< bounded multiple producer queue of records
+static uint32_t sLogEnqueue;					///< next position to fill, claimed by producers
+static uint32_t sLogDequeue;					///< next position to drain, under sLogDrainLock
+static uint32_t sLogDropped;					///< records dropped because the ring was full
+static bool sLogAsync = false;					///< set once the writer thread runs
+static Mutex sLogDrainLock;						///< one drainer at a time, the writer or exit
+static LogSink sLogSink = SyslogSink;
+static FILE *sLogFile = NULL;					///< for FileSink
+static int sLogSocket = -1;						///< for SocketSink
+static struct sockaddr_un sLogSocketAddress;	///< for SocketSink
+
+
+/** Queue a record for the writer, without blocking.  Return false if the ring is full. */
+static bool enqueueLog(int priority, const string& text)
+{
+	uint32_t pos = __atomic_load_n(&sLogEnqueue,__ATOMIC_RELAXED);
+	LogRecord *slot;
+	while (true) {
+		slot = &sLogRing[pos & (sLogRingSize-1)];
+		int32_t diff = (int32_t)(__atomic_load_n(&slot->sequence,__ATOMIC_ACQUIRE) - pos);
+		if (diff==0) {
+			// The slot is free; claim the position.
+			if (__atomic_compare_exchange_n(&sLogEnqueue,&pos,pos+1,true,__ATOMIC_RELAXED,__ATOMIC_RELAXED)) break;
+		} else if (diff<0) {
+			// The writer has not freed this slot yet; the ring is full.
+			__atomic_add_fetch(&sLogDropped,1,__ATOMIC_RELAXED);
+			return false;
+		} else {
+			pos = __atomic_load_n(&sLogEnqueue,__ATOMIC_RELAXED);
+		}
+	}
+	slot->priority = priority;
+	gettimeofday(&slot->time,NULL);
+	slot->text = strdup(text.c_str());
+	__atomic_store_n(&slot->sequence,pos+1,__ATOMIC_RELEASE);
+	return true;
+}
+
+
+/** Write one record to the sink, from the writer side. */
+static void writeLog(int priority, const struct timeval& time, const char *text)
+{
+	switch (sLogSink) {
+		case SyslogSink:
+			syslog(priority, "%s", text);
+			break;
+		case FileSink: {
+			struct tm tm;
+			localtime_r(&time.tv_sec,&tm);
+			char stamp[32];
+			strftime(stamp,sizeof(stamp),"%Y-%m-%d %H:%M:%S",&tm);
+			fprintf(sLogFile,"%s.%06ld %s\n",stamp,(long)time.tv_usec,text);
+			break;
+		}
+		case SocketSink:
+			sendto(sLogSocket,text,strlen(text),0,(struct sockaddr*)&sLogSocketAddress,sizeof(sLogSocketAddress));
+			break;
+	}
+}
+
+
+/** Write out every queued record.  Return the number written. */
+static unsigned drainLog()
+{
+	ScopedLock lock(sLogDrainLock);
+	unsigned count = 0;
+	while (true) {
+		LogRecord *slot = &sLogRing[sLogDequeue & (sLogRingSize-1)];
+		if (__atomic_load_n(&slot->sequence,__ATOMIC_ACQUIRE)!=sLogDequeue+1) break;
+		if (slot->text) writeLog(slot->priority,slot->time,slot->text);
+		free(slot->text);
+		// Free the slot for the producers one lap ahead.
+		__atomic_store_n(&slot->sequence,sLogDequeue+sLogRingSize,__ATOMIC_RELEASE);
+		sLogDequeue++;
+		count++;
+	}
+	uint32_t dropped = __atomic_exchange_n(&sLogDropped,0,__ATOMIC_RELAXED);
+	if (dropped) {
+		char report[80];
+		sprintf(report,"WARNING log overload, %u records dropped",dropped);
+		struct timeval now;
+		gettimeofday(&now,NULL);
+		writeLog(LOG_WARNING,now,report);
+	}
+	if (sLogFile) fflush(sLogFile);
+	return count;
+}
+
+
+/** The writer thread. */
+static void* LogWriterLoop(void*)
+{
+	while (true) {
+		if (!drainLog()) usleep(10000);
+	}
+	return NULL;
+}
+
+
+/** Write out what is left at exit. */
+static void flushLogAtExit()
+{
+	drainLog();
+}
+
+
+/**
+	Start the writer thread, if the configuration asks for it.
+	Log.Sink is "syslog", "file:<path>" or "socket:<path>", the last a local datagram socket.
+*/
+static void startAsyncLog()
+{
+	if (sLogAsync) return;
+	if (!gConfig.getNum("Log.Async",0)) return;
+
+	string sink = gConfig.getStr("Log.Sink","syslog");
+	if (sink.compare(0,5,"file:")==0) {
+		sLogFile = fopen(sink.c_str()+5,"a");
+		if (!sLogFile) {
+			syslog(LOG_ERR,"cannot open log file %s, logging to syslog",sink.c_str()+5);
+		} else sLogSink = FileSink;
+	} else if (sink.compare(0,7,"socket:")==0) {
+		sLogSocket = socket(AF_UNIX,SOCK_DGRAM,0);
+		memset(&sLogSocketAddress,0,sizeof(sLogSocketAddress));
+		sLogSocketAddress.sun_family = AF_UNIX;
+		strncpy(sLogSocketAddress.sun_path,sink.c_str()+7,sizeof(sLogSocketAddress.sun_path)-1);
+		if (sLogSocket<0) {
+			syslog(LOG_ERR,"cannot open log socket, logging to syslog");
+		} else sLogSink = SocketSink;
+	}
+
+	for (unsigned i=0; i<sLogRingSize; i++) sLogRing[i].sequence = i;
+	atexit(flushLogAtExit);
+	Thread *writer = new Thread;
+	writer->start(LogWriterLoop,NULL);
+	__atomic_store_n(&sLogAsync,true,__ATOMIC_RELEASE);
+}
+
+//@}
+
+
+
+
 // copies the alarm list and returns it. list supposed to be small.
 list<string> gGetLoggerAlarms()
 {
@@ -159,7 +343,12 @@ Log::~Log()
 		cerr << mStream.str() << endl;
 	}
 	// Current logging level was already checked by the macro.
-	// So just log.
+	// So just log, leaving the writing to the writer thread if there is one.
+	// Under overload the record is dropped and counted rather than wait.
+	if (__atomic_load_n(&sLogAsync,__ATOMIC_ACQUIRE)) {
+		enqueueLog(mPriority,mStream.str());
+		return;
+	}
 	syslog(mPriority, "%s", mStream.str().c_str());
 }
 
@@ -198,6 +387,9 @@ void gLogInit(const char* name, const char* level, int facility)
 
 	// Open the log connection.
 	openlog(name,0,facility);
+
+	// Optionally write the records from a background thread.
+	startAsyncLog();
 }
 
 
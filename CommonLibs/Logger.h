@@ -41,12 +41,16 @@
 	Log(LOG_##level).get() << pthread_self() \
 	<< " " __FILE__  ":"  << __LINE__ << ":" << __FUNCTION__ << ": "
 
+/** True if the level is logged at this call site, using a level cached here. */
+#define LOG_ENABLED(wLevel) \
+	({ static LogLevelCache sLogLevelCache; sLogLevelCache.enabled(LOG_##wLevel,__FILE__); })
+
 #ifdef NDEBUG
 #define LOG(wLevel) \
-	if (LOG_##wLevel!=LOG_DEBUG && gGetLoggingLevel(__FILE__)>=LOG_##wLevel) _LOG(wLevel)
+	if (LOG_##wLevel!=LOG_DEBUG && LOG_ENABLED(wLevel)) _LOG(wLevel)
 #else
 #define LOG(wLevel) \
-	if (gGetLoggingLevel(__FILE__)>=LOG_##wLevel) _LOG(wLevel)
+	if (LOG_ENABLED(wLevel)) _LOG(wLevel)
 #endif
 
 
@@ -59,6 +63,32 @@
 #define DEFAULT_MAX_ALARMS 10
 
 
+/** Moves on whenever the logging levels may have changed; see gLogLevelsChanged(). */
+extern uint32_t gLogGeneration;
+
+/**
+	The logging level of one LOG() call site.
+	The level is looked up once and kept with the generation it was read in,
+	so a check costs two relaxed loads and a compare until the levels change.
+	Only ever a zero-initialized static, so it needs no constructor.
+*/
+struct LogLevelCache {
+
+	uint32_t mState;		///< generation<<8 | level, 0 until the first lookup
+
+	bool enabled(int level, const char* filename)
+	{
+		uint32_t state = __atomic_load_n(&mState,__ATOMIC_RELAXED);
+		uint32_t generation = __atomic_load_n(&gLogGeneration,__ATOMIC_RELAXED);
+		if ((state>>8)!=(generation&0x0ffffff)) state = refresh(filename);
+		return level <= (int)(state&0x0ff);
+	}
+
+	/** Look the level up again, returning the new state. */
+	uint32_t refresh(const char* filename);
+};
+
+
 /**
 	A C++ stream-based thread-safe logger.
 	Derived from Dr. Dobb's Sept. 2007 issue.
@@ -102,6 +132,8 @@ std::list<std::string> gGetLoggerAlarms();		///< Get a copy of the recent alarm
 void gLogInit(const char* name, const char* level=NULL, int facility=LOG_USER);
 /** Get the logging level associated with a given file. */
 int gGetLoggingLevel(const char *filename=NULL);
+/** Make every LOG() call site look its level up again. */
+void gLogLevelsChanged();
 /** Allow early logging when still in constructors */
 void gLogEarly(int level, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
 //@}
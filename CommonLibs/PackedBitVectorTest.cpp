@@ -0,0 +1,165 @@
+/*
+* Copyright 2008, 2009 Free Software Foundation, Inc.
+*
+*
+* This software is distributed under the terms of the GNU Affero Public License.
+* See the COPYING file in the main directory for details.
+*
+* This use of this software may be subject to additional restrictions.
+* See the LEGAL file in the main directory for details.
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU Affero General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU Affero General Public License for more details.
+
+	You should have received a copy of the GNU Affero General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+/*
+	Runs the same operations on BitVector and PackedBitVector, on whole
+	vectors and on segments at odd bit offsets, and compares the results.
+*/
+
+
+#include "BitVector.h"
+#include <iostream>
+#include <cstdlib>
+
+using namespace std;
+
+
+unsigned numTests = 0;
+unsigned numFailed = 0;
+
+
+void check(const char *name, const BitVector& expected, const PackedBitVector& result)
+{
+	numTests++;
+	bool match = (expected.size()==result.size());
+	for (size_t i=0; match && i<expected.size(); i++) {
+		if (expected.bit(i)!=result.bit(i)) match = false;
+	}
+	if (match) return;
+	numFailed++;
+	cout << "FAIL " << name << endl;
+	cout << " expected=" << expected << endl;
+	cout << " result=  " << result << endl;
+}
+
+
+void check(const char *name, uint64_t expected, uint64_t result)
+{
+	numTests++;
+	if (expected==result) return;
+	numFailed++;
+	cout << "FAIL " << name << " expected=" << expected << " result=" << result << endl;
+}
+
+
+void randomize(BitVector& v)
+{
+	for (size_t i=0; i<v.size(); i++) v[i] = random() & 0x01;
+}
+
+
+int main(int argc, char *argv[])
+{
+	Parity fire(0x10004820009ULL,40,224);
+	Parity crc(0x0b,3,50);
+
+	for (unsigned t=0; t<500; t++) {
+		// a parent vector and an unaligned segment of it
+		const size_t len = 1 + random()%400;
+		BitVector parent(len);
+		randomize(parent);
+		PackedBitVector packedParent(parent);
+		check("construct",parent,packedParent);
+
+		const size_t start = random()%len;
+		const size_t span = random()%(len-start+1);
+		BitVector seg = parent.segment(start,span);
+		PackedBitVector packedSeg = packedParent.segment(start,span);
+		check("segment",seg,packedSeg);
+
+		// fields
+		if (span>0) {
+			const size_t index = random()%span;
+			const unsigned width = random()%65;
+			if (index+width<=span) {
+				check("peekField",seg.peekField(index,width),packedSeg.peekField(index,width));
+				check("peekFieldReversed",seg.peekFieldReversed(index,width),packedSeg.peekFieldReversed(index,width));
+				uint64_t value = ((uint64_t)random()<<33) ^ ((uint64_t)random()<<11) ^ random();
+				seg.fillField(index,value,width);
+				packedSeg.fillField(index,value,width);
+				check("fillField",parent,packedParent);
+				seg.fillFieldReversed(index,value,width);
+				packedSeg.fillFieldReversed(index,value,width);
+				check("fillFieldReversed",parent,packedParent);
+			}
+		}
+
+		// copies between unaligned segments
+		BitVector other(len);
+		randomize(other);
+		PackedBitVector packedOther(other);
+		const size_t dst = random()%(len-span+1);
+		seg.copyToSegment(other,dst);
+		packedSeg.copyToSegment(packedOther,dst);
+		check("copyToSegment",other,packedOther);
+
+		// whole-vector operations on the segment
+		seg.invert();
+		packedSeg.invert();
+		check("invert",parent,packedParent);
+		seg.LSB8MSB();
+		packedSeg.LSB8MSB();
+		check("LSB8MSB",parent,packedParent);
+		check("sum",seg.sum(),packedSeg.sum());
+		check("parity",seg.parity(fire),packedSeg.parity(fire));
+		check("syndrome",seg.syndrome(fire),packedSeg.syndrome(fire));
+		check("parity",seg.parity(crc),packedSeg.parity(crc));
+		check("syndrome",seg.syndrome(crc),packedSeg.syndrome(crc));
+
+		// reordering
+		unsigned perm[len];
+		for (unsigned i=0; i<len; i++) perm[i] = i;
+		for (unsigned i=len-1; i>0; i--) {
+			unsigned j = random()%(i+1);
+			unsigned tmp = perm[i]; perm[i] = perm[j]; perm[j] = tmp;
+		}
+		BitVector mapped(len);
+		PackedBitVector packedMapped(len);
+		parent.map(perm,len,mapped);
+		packedParent.map(perm,len,packedMapped);
+		check("map",mapped,packedMapped);
+		parent.unmap(perm,len,mapped);
+		packedParent.unmap(perm,len,packedMapped);
+		check("unmap",mapped,packedMapped);
+
+		// byte packing and conversion back
+		unsigned char bytes[len/8+1];
+		unsigned char packedBytes[len/8+1];
+		parent.pack(bytes);
+		packedParent.pack(packedBytes);
+		check("pack",memcmp(bytes,packedBytes,(len+7)/8),0);
+		PackedBitVector unpacked(len);
+		unpacked.unpack(bytes);
+		check("unpack",parent,unpacked);
+		BitVector back(len);
+		packedParent.copyTo(back);
+		check("copyTo",parent,PackedBitVector(back));
+	}
+
+	cout << numTests-numFailed << "/" << numTests << " passed" << endl;
+
+	return (numFailed==0) ? 0 : 1;
+}
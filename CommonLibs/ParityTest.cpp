@@ -0,0 +1,88 @@
+/*
+* Copyright 2008, 2009 Free Software Foundation, Inc.
+*
+*
+* This software is distributed under the terms of the GNU Affero Public License.
+* See the COPYING file in the main directory for details.
+*
+* This use of this software may be subject to additional restrictions.
+* See the LEGAL file in the main directory for details.
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU Affero General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU Affero General Public License for more details.
+
+	You should have received a copy of the GNU Affero General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+/*
+	Compares the table-driven BitVector::parity() and syndrome() against
+	Generator::encoderShift() and syndromeShift() one bit at a time, for
+	the GSM block codes and some other register lengths, on random blocks.
+*/
+
+
+#include "BitVector.h"
+#include <iostream>
+#include <cstdlib>
+
+using namespace std;
+
+
+uint64_t serialParity(Generator& gen, const BitVector& v)
+{
+	gen.clear();
+	for (size_t i=0; i<v.size(); i++) gen.encoderShift(v.bit(i));
+	return gen.state();
+}
+
+
+uint64_t serialSyndrome(Generator& gen, const BitVector& v)
+{
+	gen.clear();
+	for (size_t i=0; i<v.size(); i++) gen.syndromeShift(v.bit(i));
+	return gen.state();
+}
+
+
+int main(int argc, char *argv[])
+{
+	// Fire code, TCH class 1a CRC, RACH and SCH parities, then others
+	static const uint64_t coeffs[] = { 0x10004820009ULL, 0x0b, 0x06f, 0x0575, 0x1021, 0x04c11db7, 0x03, 0x123456789abcdULL };
+	static const unsigned lengths[] = { 40, 3, 6, 10, 16, 32, 2, 63 };
+	const unsigned trials = 1000;
+
+	unsigned numTests = 0;
+	unsigned numFailed = 0;
+
+	for (unsigned p=0; p<sizeof(coeffs)/sizeof(coeffs[0]); p++) {
+		Generator gen(coeffs[p],lengths[p]);
+		Generator ref(coeffs[p],lengths[p]);
+		for (unsigned t=0; t<trials; t++) {
+			BitVector v(random()%300);
+			for (unsigned i=0; i<v.size(); i++) v[i] = random() & 0x01;
+			if (v.parity(gen) != serialParity(ref,v)) {
+				cout << "FAIL parity len=" << lengths[p] << " " << v << endl;
+				numFailed++;
+			}
+			if (v.syndrome(gen) != serialSyndrome(ref,v)) {
+				cout << "FAIL syndrome len=" << lengths[p] << " " << v << endl;
+				numFailed++;
+			}
+			numTests += 2;
+		}
+	}
+
+	cout << numTests-numFailed << "/" << numTests << " passed" << endl;
+
+	return (numFailed==0) ? 0 : 1;
+}
@@ -25,8 +25,15 @@
 
 #include "Reporting.h"
 #include "Logger.h"
+#include "Configuration.h"
 #include <stdio.h>
 #include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+using namespace std;
+
+extern ConfigurationTable gConfig;
 
 static const char* createReportingTable = {
 	"CREATE TABLE IF NOT EXISTS REPORTING ("
@@ -39,6 +46,7 @@ static const char* createReportingTable = {
 
 
 ReportingTable::ReportingTable(const char* filename)
+	:mFlushStarted(false)
 {
 	gLogEarly(LOG_INFO | mFacility, "opening reporting table from path %s", filename);
 	// Connect to the database.
@@ -53,14 +61,25 @@ ReportingTable::ReportingTable(const char* filename)
 	if (!sqlite3_command(mDB,createReportingTable)) {
 		gLogEarly(LOG_EMERG | mFacility, "cannot create reporting table in database at %s, error message: %s", filename, sqlite3_errmsg(mDB));
 	}
+	if (gConfig.getNum("Control.Reporting.WAL",0)) sqlite3_enable_wal(mDB);
 }
 
 
 bool ReportingTable::create(const char* paramName)
 {
-	char cmd[200];
-	sprintf(cmd,"INSERT OR IGNORE INTO REPORTING (NAME,CLEAREDTIME) VALUES (\"%s\",%ld)", paramName, time(NULL));
-	if (!sqlite3_command(mDB,cmd)) {
+	// Intern the parameter whether or not the database is there,
+	// so the events are still counted.
+	mLock.lock();
+	if (mCounters.find(paramName)==mCounters.end()) {
+		mCounters[paramName] = new ReportingCounter(paramName);
+	}
+	startFlush();
+	mLock.unlock();
+	ScopedLock lock(mFlushLock);
+	char now[20];
+	sprintf(now,"%ld",time(NULL));
+	const char* params[] = { paramName, now };
+	if (!sqlite3_command(mDB,"INSERT OR IGNORE INTO REPORTING (NAME,CLEAREDTIME) VALUES (?,?)",2,params)) {
 		gLogEarly(LOG_CRIT|mFacility, "cannot create reporting parameter %s, error message: %s", paramName, sqlite3_errmsg(mDB));
 		return false;
 	}
@@ -68,40 +87,57 @@ bool ReportingTable::create(const char* paramName)
 }
 
 
+ReportingHandle ReportingTable::find(const char* paramName) const
+{
+	ScopedLock lock(mLock);
+	CounterMap::const_iterator itr = mCounters.find(paramName);
+	if (itr==mCounters.end()) return NULL;
+	return itr->second;
+}
 
-bool ReportingTable::incr(const char* paramName)
+
+ReportingHandle ReportingTable::handle(const char* baseName, unsigned index) const
 {
-	char cmd[200];
-	sprintf(cmd,"UPDATE REPORTING SET VALUE=VALUE+1, UPDATETIME=%ld WHERE NAME=\"%s\"", time(NULL), paramName);
-	if (!sqlite3_command(mDB,cmd)) {
-		gLogEarly(LOG_CRIT|mFacility, "cannot increment reporting parameter %s, error message: %s", paramName, sqlite3_errmsg(mDB));
-		return false;
-	}
+	char name[strlen(baseName)+10];
+	sprintf(name,"%s.%u",baseName,index);
+	return find(name);
+}
+
+
+
+bool ReportingTable::incr(ReportingHandle param)
+{
+	// Uncreated parameters are ignored, as the UPDATE used to ignore them.
+	if (!param) return false;
+	__atomic_add_fetch(&param->mCount,1,__ATOMIC_RELAXED);
+	__atomic_store_n(&param->mUpdateTime,time(NULL),__ATOMIC_RELAXED);
+	__atomic_store_n(&param->mDirty,true,__ATOMIC_RELEASE);
 	return true;
 }
 
 
 
-bool ReportingTable::max(const char* paramName, unsigned newVal)
+bool ReportingTable::max(ReportingHandle param, unsigned newVal)
 {
-	char cmd[200];
-	sprintf(cmd,"UPDATE REPORTING SET VALUE=MAX(VALUE,%u), UPDATETIME=%ld WHERE NAME=\"%s\"", newVal, time(NULL), paramName);
-	if (!sqlite3_command(mDB,cmd)) {
-		gLogEarly(LOG_CRIT|mFacility, "cannot maximize reporting parameter %s, error message: %s", paramName, sqlite3_errmsg(mDB));
-		return false;
+	if (!param) return false;
+	unsigned oldVal = __atomic_load_n(&param->mMax,__ATOMIC_RELAXED);
+	while (newVal>oldVal) {
+		if (__atomic_compare_exchange_n(&param->mMax,&oldVal,newVal,false,__ATOMIC_RELAXED,__ATOMIC_RELAXED)) break;
 	}
+	__atomic_store_n(&param->mUpdateTime,time(NULL),__ATOMIC_RELAXED);
+	__atomic_store_n(&param->mDirty,true,__ATOMIC_RELEASE);
 	return true;
 }
 
 
-bool ReportingTable::clear(const char* paramName)
+bool ReportingTable::clear(ReportingHandle param)
 {
-	char cmd[200];
-	sprintf(cmd,"UPDATE REPORTING SET VALUE=0, UPDATETIME=0, CLEAREDTIME=%ld WHERE NAME=\"%s\"", time(NULL), paramName);
-	if (!sqlite3_command(mDB,cmd)) {
-		gLogEarly(LOG_CRIT|mFacility, "cannot clear reporting parameter %s, error message: %s", paramName, sqlite3_errmsg(mDB));
-		return false;
-	}
+	if (!param) return false;
+	// Pending events from before the clear are discarded with it.
+	__atomic_store_n(&param->mCount,0,__ATOMIC_RELAXED);
+	__atomic_store_n(&param->mMax,0,__ATOMIC_RELAXED);
+	__atomic_store_n(&param->mClearedTime,time(NULL),__ATOMIC_RELAXED);
+	__atomic_store_n(&param->mDirty,true,__ATOMIC_RELEASE);
 	return true;
 }
 
@@ -117,29 +153,108 @@ bool ReportingTable::create(const char* baseName, unsigned minIndex, unsigned ma
 	return true;
 }
 
-bool ReportingTable::incr(const char* baseName, unsigned index)
+
+
+bool ReportingTable::flush()
 {
-	char name[strlen(baseName)+10];
-	sprintf(name,"%s.%u",baseName,index);
-	return incr(name);
+	ScopedLock lock(mFlushLock);
+	if (!mDB) return false;
+	// Copy the parameter list so that the lookups do not wait on the database.
+	std::vector<ReportingCounter*> params;
+	mLock.lock();
+	params.reserve(mCounters.size());
+	for (CounterMap::iterator itr = mCounters.begin(); itr!=mCounters.end(); ++itr) {
+		params.push_back(itr->second);
+	}
+	mLock.unlock();
+	bool inTransaction = false;
+	bool ok = true;
+	static const char* clearQuery = "UPDATE REPORTING SET VALUE=0, UPDATETIME=0, CLEAREDTIME=? WHERE NAME=?";
+	static const char* updateQuery = "UPDATE REPORTING SET VALUE=MAX(VALUE+?,?), UPDATETIME=? WHERE NAME=?";
+	for (size_t i=0; i<params.size(); i++) {
+		ReportingCounter *param = params[i];
+		if (!__atomic_exchange_n(&param->mDirty,false,__ATOMIC_ACQUIRE)) continue;
+		time_t cleared = __atomic_exchange_n(&param->mClearedTime,0,__ATOMIC_RELAXED);
+		unsigned increments = __atomic_exchange_n(&param->mCount,0,__ATOMIC_RELAXED);
+		unsigned newMax = __atomic_exchange_n(&param->mMax,0,__ATOMIC_RELAXED);
+		time_t updated = __atomic_load_n(&param->mUpdateTime,__ATOMIC_RELAXED);
+		if (!cleared && !increments && !newMax) continue;
+		if (!inTransaction) {
+			if (!sqlite3_command(mDB,"BEGIN TRANSACTION")) {
+				gLogEarly(LOG_CRIT|mFacility, "cannot begin reporting transaction, error message: %s", sqlite3_errmsg(mDB));
+				return false;
+			}
+			inTransaction = true;
+		}
+		if (cleared) {
+			sqlite3_stmt *stmt = sqlite3_cached_statement(mDB,clearQuery);
+			int src = SQLITE_ERROR;
+			if (stmt) {
+				sqlite3_bind_int64(stmt,1,cleared);
+				sqlite3_bind_text(stmt,2,param->mName.c_str(),-1,SQLITE_STATIC);
+				src = sqlite3_run_query(mDB,stmt);
+				sqlite3_release_statement(mDB,clearQuery,stmt);
+			}
+			if (src!=SQLITE_DONE) {
+				gLogEarly(LOG_CRIT|mFacility, "cannot clear reporting parameter %s, error message: %s", param->mName.c_str(), sqlite3_errmsg(mDB));
+				ok = false;
+			}
+		}
+		if (increments || newMax) {
+			sqlite3_stmt *stmt = sqlite3_cached_statement(mDB,updateQuery);
+			int src = SQLITE_ERROR;
+			if (stmt) {
+				sqlite3_bind_int64(stmt,1,increments);
+				sqlite3_bind_int64(stmt,2,newMax);
+				sqlite3_bind_int64(stmt,3,updated);
+				sqlite3_bind_text(stmt,4,param->mName.c_str(),-1,SQLITE_STATIC);
+				src = sqlite3_run_query(mDB,stmt);
+				sqlite3_release_statement(mDB,updateQuery,stmt);
+			}
+			if (src!=SQLITE_DONE) {
+				gLogEarly(LOG_CRIT|mFacility, "cannot update reporting parameter %s, error message: %s", param->mName.c_str(), sqlite3_errmsg(mDB));
+				ok = false;
+			}
+		}
+	}
+	if (inTransaction && !sqlite3_command(mDB,"COMMIT TRANSACTION")) {
+		gLogEarly(LOG_CRIT|mFacility, "cannot commit reporting transaction, error message: %s", sqlite3_errmsg(mDB));
+		sqlite3_command(mDB,"ROLLBACK TRANSACTION");
+		return false;
+	}
+	return ok;
 }
 
 
-bool ReportingTable::max(const char* baseName, unsigned index, unsigned newVal)
+/** The table flushed at exit, so the exit reasons are not lost. */
+static ReportingTable *sFlushAtExit = NULL;
+
+static void flushReportsAtExit()
 {
-	char name[strlen(baseName)+10];
-	sprintf(name,"%s.%u",baseName,index);
-	return max(name,newVal);
+	if (sFlushAtExit) sFlushAtExit->flush();
 }
 
 
-bool ReportingTable::clear(const char* baseName, unsigned index)
+void ReportingTable::startFlush()
 {
-	char name[strlen(baseName)+10];
-	sprintf(name,"%s.%u",baseName,index);
-	return clear(name);
+	if (mFlushStarted) return;
+	mFlushStarted = true;
+	if (!sFlushAtExit) {
+		sFlushAtExit = this;
+		atexit(flushReportsAtExit);
+	}
+	mFlushThread.start((void*(*)(void*))ReportingFlushLoopAdapter,this);
 }
 
 
+void *ReportingFlushLoopAdapter(ReportingTable *table)
+{
+	while (true) {
+		unsigned period = gConfig.getNum("Control.Reporting.FlushPeriod",10);
+		sleep(period ? period : 1);
+		table->flush();
+	}
+	return NULL;
+}
 
 
@@ -28,11 +28,39 @@
 
 #include <sqlite3util.h>
 #include <ostream>
+#include <string>
+#include <map>
+#include <vector>
+#include "Threads.h"
+
+
+/**
+	One in-memory parameter.
+	Events accumulate here and are written to the table by the flush thread.
+*/
+struct ReportingCounter {
+
+	std::string mName;			///< parameter name in the table
+	volatile unsigned mCount;	///< increments not yet written
+	volatile unsigned mMax;		///< largest max() value not yet written
+	volatile time_t mUpdateTime;	///< time of the latest event
+	volatile time_t mClearedTime;	///< time of a clear not yet written, or zero
+	volatile bool mDirty;		///< true if there is anything to write
+
+	ReportingCounter(const char* wName)
+		:mName(wName),mCount(0),mMax(0),mUpdateTime(0),mClearedTime(0),mDirty(false)
+	{ }
+};
+
+/** A handle to an interned parameter; NULL for a parameter that was never created. */
+typedef ReportingCounter* ReportingHandle;
 
 
 /**
 	Collect performance statistics into a database.
 	Parameters are counters or max/min trackers, all integer.
+	Events are counted in memory and written to the database
+	in one transaction every Control.Reporting.FlushPeriod seconds.
 */
 class ReportingTable {
 
@@ -41,7 +69,18 @@ class ReportingTable {
 	sqlite3* mDB;				///< database connection
 	int mFacility;				///< rsyslogd facility
 
+	typedef std::map<std::string,ReportingCounter*> CounterMap;
+	CounterMap mCounters;		///< parameters interned by name, never deleted
+	mutable Mutex mLock;		///< protects mCounters
+	Mutex mFlushLock;			///< serializes use of the database connection
+	Thread mFlushThread;		///< writes the counters to the database
+	bool mFlushStarted;			///< true once mFlushThread is running
+
+	/** Find an interned parameter by name. */
+	ReportingHandle find(const char* paramName) const;
 
+	/** Start the flush thread, if it is not running yet. */
+	void startFlush();
 
 	public:
 
@@ -57,29 +96,55 @@ class ReportingTable {
 	/** Create an indexed parameter set. */
 	bool create(const char* baseBame, unsigned minIndex, unsigned maxIndex);
 
+	/**@name Handles, for the frequent events. */
+	//@{
+	/** Return the handle of a created parameter, or NULL. */
+	ReportingHandle handle(const char* paramName) const { return find(paramName); }
+
+	/** Return the handle of a created indexed parameter, or NULL. */
+	ReportingHandle handle(const char* baseName, unsigned index) const;
+
 	/** Increment a counter. */
-	bool incr(const char* paramName);
+	bool incr(ReportingHandle param);
+
+	/** Take a max of a parameter. */
+	bool max(ReportingHandle param, unsigned newVal);
+
+	/** Clear a value. */
+	bool clear(ReportingHandle param);
+	//@}
+
+	/** Increment a counter. */
+	bool incr(const char* paramName) { return incr(find(paramName)); }
 
 	/** Increment an indexed counter. */
-	bool incr(const char* baseName, unsigned index);
+	bool incr(const char* baseName, unsigned index) { return incr(handle(baseName,index)); }
 
 	/** Take a max of a parameter. */
-	bool max(const char* paramName, unsigned newVal);
+	bool max(const char* paramName, unsigned newVal) { return max(find(paramName),newVal); }
 
 	/** Take a max of an indexed parameter. */
-	bool max(const char* paramName, unsigned index, unsigned newVal);
+	bool max(const char* paramName, unsigned index, unsigned newVal) { return max(handle(paramName,index),newVal); }
 
 	/** Clear a value.  */
-	bool clear(const char* paramName);
+	bool clear(const char* paramName) { return clear(find(paramName)); }
 
 	/** Clear an indexed value.  */
-	bool clear(const char* paramName, unsigned index);
+	bool clear(const char* paramName, unsigned index) { return clear(handle(paramName,index)); }
+
+	/** Write all pending events to the database in one transaction. */
+	bool flush();
 
 	/** Dump the database to a stream. */
 	void dump(std::ostream&) const;
 
+	friend void *ReportingFlushLoopAdapter(ReportingTable*);
+
 };
 
+/** Flush the table periodically. */
+void *ReportingFlushLoopAdapter(ReportingTable*);
+
 #endif
 
 
@@ -0,0 +1,219 @@
+/*
+* Copyright 2012 Free Software Foundation, Inc.
+*
+* This software is distributed under the terms of the GNU Affero Public License.
+* See the COPYING file in the main directory for details.
+*
+* This use of this software may be subject to additional restrictions.
+* See the LEGAL file in the main directory for details.
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU Affero General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU Affero General Public License for more details.
+
+	You should have received a copy of the GNU Affero General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+#include "SharedMemory.h"
+#include "Sockets.h"
+#include "Logger.h"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+#include <assert.h>
+
+
+/** Marks a region that is ready for use. */
+static const uint32_t regionMagic = 0x4f425453;
+
+
+/** One datagram in a ring. */
+struct RingSlot {
+	uint32_t length;
+	char data[MAX_UDP_LENGTH];
+};
+
+
+/** A ring, with the writer and reader fields on separate cache lines. */
+struct SharedMemoryLink::Ring {
+	uint32_t head;				///< next slot to fill, writer owned; also the futex word
+	uint32_t waiting;			///< set by a reader about to sleep on head
+	char writerPad[56];
+	uint32_t tail;				///< next slot to read, reader owned
+	char readerPad[60];
+	RingSlot slots[ringSlots];
+};
+
+
+/** The shared region; the creator writes ring 0 and reads ring 1. */
+struct SharedMemoryLink::Region {
+	uint32_t magic;
+	uint32_t size;
+	char pad[56];
+	Ring rings[2];
+};
+
+
+static int futex(uint32_t *word, int op, uint32_t value, const struct timespec *timeout)
+{
+	return syscall(SYS_futex,word,op,value,timeout,NULL,0);
+}
+
+
+
+SharedMemoryLink::SharedMemoryLink()
+	:mRegion(NULL),mCreator(false),
+	mWriteRing(NULL),mReadRing(NULL)
+{
+	mName[0] = '\0';
+}
+
+
+bool SharedMemoryLink::create(const char* name)
+{
+	close();
+	assert(strlen(name)<sizeof(mName));
+	// A region left by an earlier run would carry stale datagrams.
+	shm_unlink(name);
+	int fd = shm_open(name,O_RDWR|O_CREAT|O_EXCL,0600);
+	if (fd<0) {
+		LOG(ERR) << "cannot create shared memory " << name << ": " << strerror(errno);
+		return false;
+	}
+	// A new object is zero filled, so the rings start out empty.
+	void *region = MAP_FAILED;
+	if (ftruncate(fd,sizeof(Region))==0) {
+		region = mmap(NULL,sizeof(Region),PROT_READ|PROT_WRITE,MAP_SHARED,fd,0);
+	}
+	::close(fd);
+	if (region==MAP_FAILED) {
+		LOG(ERR) << "cannot map shared memory " << name << ": " << strerror(errno);
+		shm_unlink(name);
+		return false;
+	}
+	mRegion = (Region*)region;
+	mRegion->size = sizeof(Region);
+	__atomic_store_n(&mRegion->magic,regionMagic,__ATOMIC_RELEASE);
+	strcpy(mName,name);
+	mCreator = true;
+	mWriteRing = &mRegion->rings[0];
+	mReadRing = &mRegion->rings[1];
+	LOG(INFO) << "created shared memory " << name << ", " << sizeof(Region) << " bytes";
+	return true;
+}
+
+
+bool SharedMemoryLink::attach(const char* name)
+{
+	close();
+	assert(strlen(name)<sizeof(mName));
+	int fd = shm_open(name,O_RDWR,0);
+	if (fd<0) {
+		LOG(INFO) << "no shared memory " << name << ": " << strerror(errno);
+		return false;
+	}
+	// Only map a region of this build's layout.
+	struct stat info;
+	void *region = MAP_FAILED;
+	if ((fstat(fd,&info)==0) && ((size_t)info.st_size==sizeof(Region))) {
+		region = mmap(NULL,sizeof(Region),PROT_READ|PROT_WRITE,MAP_SHARED,fd,0);
+	}
+	::close(fd);
+	if (region==MAP_FAILED) {
+		LOG(ERR) << "cannot map shared memory " << name;
+		return false;
+	}
+	Region *candidate = (Region*)region;
+	if ((__atomic_load_n(&candidate->magic,__ATOMIC_ACQUIRE)!=regionMagic) || (candidate->size!=sizeof(Region))) {
+		LOG(ERR) << "shared memory " << name << " has an unknown layout";
+		munmap(region,sizeof(Region));
+		return false;
+	}
+	mRegion = candidate;
+	strcpy(mName,name);
+	mCreator = false;
+	mWriteRing = &mRegion->rings[1];
+	mReadRing = &mRegion->rings[0];
+	// Drop what was written for an earlier reader.
+	__atomic_store_n(&mReadRing->tail,__atomic_load_n(&mReadRing->head,__ATOMIC_ACQUIRE),__ATOMIC_RELEASE);
+	LOG(INFO) << "attached shared memory " << name;
+	return true;
+}
+
+
+void SharedMemoryLink::close()
+{
+	if (!mRegion) return;
+	munmap(mRegion,sizeof(Region));
+	if (mCreator) shm_unlink(mName);
+	mRegion = NULL;
+	mWriteRing = NULL;
+	mReadRing = NULL;
+}
+
+
+int SharedMemoryLink::write(const char* buffer, size_t length)
+{
+	assert(mRegion);
+	assert(length<=MAX_UDP_LENGTH);
+	Ring *ring = mWriteRing;
+	uint32_t head = ring->head;
+	// Like a full socket buffer, a full ring drops the datagram.
+	if (head - __atomic_load_n(&ring->tail,__ATOMIC_ACQUIRE) >= ringSlots) return -1;
+	RingSlot &slot = ring->slots[head % ringSlots];
+	slot.length = length;
+	memcpy(slot.data,buffer,length);
+	__atomic_store_n(&ring->head,head+1,__ATOMIC_SEQ_CST);
+	if (__atomic_load_n(&ring->waiting,__ATOMIC_SEQ_CST)) {
+		futex(&ring->head,FUTEX_WAKE,1,NULL);
+	}
+	return length;
+}
+
+
+int SharedMemoryLink::read(char* buffer, int timeout)
+{
+	assert(mRegion);
+	Ring *ring = mReadRing;
+	uint32_t tail = ring->tail;
+	while (__atomic_load_n(&ring->head,__ATOMIC_ACQUIRE)==tail) {
+		__atomic_store_n(&ring->waiting,1,__ATOMIC_SEQ_CST);
+		// Check again with the flag up, so a write in between is not missed.
+		if (__atomic_load_n(&ring->head,__ATOMIC_SEQ_CST)!=tail) break;
+		struct timespec ts;
+		ts.tv_sec = timeout/1000;
+		ts.tv_nsec = (timeout%1000)*1000000L;
+		// The kernel only sleeps while head still equals tail.
+		if ((futex(&ring->head,FUTEX_WAIT,tail,(timeout<0)?NULL:&ts)<0) && (errno==ETIMEDOUT)) {
+			__atomic_store_n(&ring->waiting,0,__ATOMIC_RELAXED);
+			return -1;
+		}
+	}
+	__atomic_store_n(&ring->waiting,0,__ATOMIC_RELAXED);
+	const RingSlot &slot = ring->slots[tail % ringSlots];
+	size_t length = slot.length;
+	if (length>MAX_UDP_LENGTH) length = MAX_UDP_LENGTH;
+	memcpy(buffer,slot.data,length);
+	__atomic_store_n(&ring->tail,tail+1,__ATOMIC_RELEASE);
+	return length;
+}
+
+
+// vim: ts=4 sw=4
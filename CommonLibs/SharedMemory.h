@@ -0,0 +1,117 @@
+/*
+* Copyright 2012 Free Software Foundation, Inc.
+*
+* This software is distributed under the terms of the GNU Affero Public License.
+* See the COPYING file in the main directory for details.
+*
+* This use of this software may be subject to additional restrictions.
+* See the LEGAL file in the main directory for details.
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU Affero General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU Affero General Public License for more details.
+
+	You should have received a copy of the GNU Affero General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+#ifndef SHAREDMEMORY_H
+#define SHAREDMEMORY_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+
+/**
+	A datagram link between two processes on one host, through a POSIX
+	shared memory region holding two single producer, single consumer
+	rings, one per direction.
+
+	One side creates the region and the other attaches to it.  Each side
+	writes one ring from a single thread at a time and reads the other
+	from a single thread.  A reader with nothing to read sleeps on a futex
+	in the region, and a writer only makes the wake-up call when a reader
+	says it is sleeping.
+*/
+class SharedMemoryLink {
+
+	public:
+
+	static const unsigned ringSlots = 64;	///< datagrams each ring holds
+
+	struct Ring;
+	struct Region;
+
+	private:
+
+	char mName[64];				///< name of the region
+	Region *mRegion;			///< the mapped region, NULL if not active
+	bool mCreator;				///< true if this side created the region
+	Ring *mWriteRing;			///< the ring this side writes
+	Ring *mReadRing;			///< the ring this side reads
+
+	public:
+
+	SharedMemoryLink();
+
+	~SharedMemoryLink() { close(); }
+
+	/**
+		Create a new region, replacing any left over from an earlier run.
+		@param name The region name, "/" followed by up to 62 characters.
+		@return true on success.
+	*/
+	bool create(const char* name);
+
+	/**
+		Attach to a region made by the other side.
+		Datagrams already waiting for this side are dropped.
+		@param name The region name given to create().
+		@return true on success.
+	*/
+	bool attach(const char* name);
+
+	/** Unmap the region, and remove it if this side created it. */
+	void close();
+
+	/** True if a region is mapped. */
+	bool active() const { return mRegion!=NULL; }
+
+	/**
+		Send a datagram.
+		@param buffer The data bytes.
+		@param length Number of bytes, at most MAX_UDP_LENGTH.
+		@return length, or -1 if the ring is full.
+	*/
+	int write(const char* buffer, size_t length);
+
+	/**
+		Receive a datagram, waiting as long as it takes.
+		@param buffer A char[MAX_UDP_LENGTH] procured by the caller.
+		@return The number of bytes received.
+	*/
+	int read(char* buffer) { return read(buffer,-1); }
+
+	/**
+		Receive a datagram with a timeout.
+		@param buffer A char[MAX_UDP_LENGTH] procured by the caller.
+		@param timeout Maximum wait in milliseconds, negative for none.
+		@return The number of bytes received or -1 on timeout.
+	*/
+	int read(char* buffer, int timeout);
+
+};
+
+
+#endif
+
+// vim: ts=4 sw=4
@@ -0,0 +1,136 @@
+/*
+* Copyright 2012 Free Software Foundation, Inc.
+*
+* This software is distributed under the terms of the GNU Affero Public License.
+* See the COPYING file in the main directory for details.
+*
+* This use of this software may be subject to additional restrictions.
+* See the LEGAL file in the main directory for details.
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU Affero General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU Affero General Public License for more details.
+
+	You should have received a copy of the GNU Affero General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+/*
+	Passes numbered datagrams of varying length through a SharedMemoryLink
+	in both directions, the reader thread mostly sleeping on the futex,
+	and checks that they arrive complete and in order.
+*/
+
+#include "SharedMemory.h"
+#include "Sockets.h"
+#include "Threads.h"
+#include "Logger.h"
+#include "Configuration.h"
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+ConfigurationTable gConfig;
+
+static const char* gName = "/SharedMemoryTest";
+static const unsigned gNumToSend = 100000;
+
+
+static unsigned lengthOf(unsigned i) { return 5 + (i*37)%(MAX_UDP_LENGTH-5); }
+
+
+static void send(SharedMemoryLink& link)
+{
+	char buf[MAX_UDP_LENGTH];
+	for (unsigned i=0; i<gNumToSend; i++) {
+		unsigned len = lengthOf(i);
+		memset(buf,i&0x0ff,len);
+		memcpy(buf,&i,4);
+		// A full ring drops the datagram, so wait for room instead.
+		while (link.write(buf,len)<0) usleep(100);
+	}
+}
+
+
+static bool receive(SharedMemoryLink& link)
+{
+	char buf[MAX_UDP_LENGTH];
+	for (unsigned i=0; i<gNumToSend; i++) {
+		int len = link.read(buf,1000);
+		unsigned seq;
+		memcpy(&seq,buf,4);
+		if ((len!=(int)lengthOf(i)) || (seq!=i) || ((unsigned char)buf[len-1]!=(i&0x0ff))) {
+			COUT("datagram " << i << " bad, length " << len << " sequence " << seq);
+			return false;
+		}
+	}
+	return true;
+}
+
+
+static SharedMemoryLink gCreator;
+static SharedMemoryLink gAttacher;
+static bool gDownlinkPass = false;
+
+
+void *testReader(void *)
+{
+	gDownlinkPass = receive(gAttacher);
+	return NULL;
+}
+
+
+void *testWriter(void *)
+{
+	send(gAttacher);
+	return NULL;
+}
+
+
+int main(int argc, char * argv[] )
+{
+	gLogInit("SharedMemoryTest","INFO");
+
+	SharedMemoryLink missing;
+	if (missing.attach("/SharedMemoryTestMissing")) {
+		COUT("attached to a missing region");
+		return 1;
+	}
+
+	if (!gCreator.create(gName) || !gAttacher.attach(gName)) return 1;
+
+	// an empty ring times out
+	char buf[MAX_UDP_LENGTH];
+	if (gAttacher.read(buf,10)!=-1) {
+		COUT("read from an empty ring");
+		return 1;
+	}
+
+	Thread readerThread;
+	readerThread.start(testReader,NULL);
+	send(gCreator);
+	readerThread.join();
+	COUT("creator to attacher: " << (gDownlinkPass ? "passed" : "FAILED"));
+
+	// the other direction, this time reading on the main thread
+	Thread writerThread;
+	writerThread.start(testWriter,NULL);
+	bool uplinkPass = receive(gCreator);
+	writerThread.join();
+	COUT("attacher to creator: " << (uplinkPass ? "passed" : "FAILED"));
+
+	gAttacher.close();
+	gCreator.close();
+
+	return (gDownlinkPass && uplinkPass) ? 0 : 1;
+}
+
+// vim: ts=4 sw=4
@@ -104,6 +104,7 @@ bool resolveAddress(struct sockaddr_in *address, const char *host, unsigned shor
 DatagramSocket::DatagramSocket()
 {
 	memset(mDestination, 0, sizeof(mDestination));
+	memset(mReadHeaders, 0, sizeof(mReadHeaders));
 }
 
 
@@ -200,7 +201,7 @@ int DatagramSocket::read(char* buffer)
 }
 
 
-int DatagramSocket::read(char* buffer, unsigned timeout)
+bool DatagramSocket::waitForRead(unsigned timeout)
 {
 	fd_set fds;
 	FD_ZERO(&fds);
@@ -213,9 +214,67 @@ int DatagramSocket::read(char* buffer, unsigned timeout)
 		perror("DatagramSocket::read() select() failed");
 		throw SocketError();
 	}
-	if (sel==0) return -1;
-	if (FD_ISSET(mSocketFD,&fds)) return read(buffer);
-	return -1;
+	if (sel==0) return false;
+	return FD_ISSET(mSocketFD,&fds);
+}
+
+
+int DatagramSocket::read(char* buffer, unsigned timeout)
+{
+	if (!waitForRead(timeout)) return -1;
+	return read(buffer);
+}
+
+
+
+int DatagramSocket::writeBatch(const char* const* buffers, const size_t* lengths, unsigned count)
+{
+	assert(count<=MAX_DATAGRAM_BATCH);
+	struct mmsghdr headers[MAX_DATAGRAM_BATCH];
+	struct iovec vectors[MAX_DATAGRAM_BATCH];
+	memset(headers, 0, count*sizeof(struct mmsghdr));
+	for (unsigned i=0; i<count; i++) {
+		assert(lengths[i]<=MAX_UDP_LENGTH);
+		vectors[i].iov_base = (void*)buffers[i];
+		vectors[i].iov_len = lengths[i];
+		headers[i].msg_hdr.msg_name = mDestination;
+		headers[i].msg_hdr.msg_namelen = addressSize();
+		headers[i].msg_hdr.msg_iov = &vectors[i];
+		headers[i].msg_hdr.msg_iovlen = 1;
+	}
+	int retVal = sendmmsg(mSocketFD, headers, count, 0);
+	if (retVal == -1 ) perror("DatagramSocket::writeBatch() failed");
+	return retVal;
+}
+
+
+int DatagramSocket::readBatch(char (*buffers)[MAX_UDP_LENGTH], int* lengths, unsigned maxCount)
+{
+	assert(maxCount<=MAX_DATAGRAM_BATCH);
+	for (unsigned i=0; i<maxCount; i++) {
+		mReadVectors[i].iov_base = buffers[i];
+		mReadVectors[i].iov_len = MAX_UDP_LENGTH;
+		// Every packet reports its source into mSource, so the last one stays there.
+		mReadHeaders[i].msg_hdr.msg_name = mSource;
+		mReadHeaders[i].msg_hdr.msg_namelen = sizeof(mSource);
+		mReadHeaders[i].msg_hdr.msg_iov = &mReadVectors[i];
+		mReadHeaders[i].msg_hdr.msg_iovlen = 1;
+	}
+	// Wait for the first packet, then take the rest only if already queued.
+	int count = recvmmsg(mSocketFD, mReadHeaders, maxCount, MSG_WAITFORONE, NULL);
+	if ((count==-1) && (errno!=EAGAIN)) {
+		perror("DatagramSocket::readBatch() failed");
+		throw SocketError();
+	}
+	for (int i=0; i<count; i++) lengths[i] = mReadHeaders[i].msg_len;
+	return count;
+}
+
+
+int DatagramSocket::readBatch(char (*buffers)[MAX_UDP_LENGTH], int* lengths, unsigned maxCount, unsigned timeout)
+{
+	if (!waitForRead(timeout)) return -1;
+	return readBatch(buffers,lengths,maxCount);
 }
 
 
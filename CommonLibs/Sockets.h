@@ -43,6 +43,9 @@
 
 #define MAX_UDP_LENGTH 1500
 
+/** Most packets readBatch() and writeBatch() move in one system call. */
+#define MAX_DATAGRAM_BATCH 32
+
 /** A function to resolve IP host names. */
 bool resolveAddress(struct sockaddr_in *address, const char *host, unsigned short port);
 
@@ -61,6 +64,8 @@ protected:
 	int mSocketFD;				///< underlying file descriptor
 	char mDestination[256];		///< address to which packets are sent
 	char mSource[256];		///< return address of most recent received packet
+	struct mmsghdr mReadHeaders[MAX_DATAGRAM_BATCH];	///< preallocated readBatch() message headers
+	struct iovec mReadVectors[MAX_DATAGRAM_BATCH];		///< preallocated readBatch() buffer vectors
 
 public:
 
@@ -118,6 +123,36 @@ public:
 	*/
 	int read(char* buffer, unsigned timeout);
 
+	/**
+		Send several binary packets with one system call.
+		@param buffers The packets to send to mDestination.
+		@param lengths Number of bytes in each packet.
+		@param count Number of packets, at most MAX_DATAGRAM_BATCH.
+		@return number of packets written, or -1 on error.
+	*/
+	int writeBatch(const char* const* buffers, const size_t* lengths, unsigned count);
+
+	/**
+		Receive the packets waiting, up to maxCount, with one system call.
+		Blocks for the first packet unless the socket is non-blocking.
+		Only one thread at a time may call this on a socket.
+		@param buffers maxCount buffers procured by the caller.
+		@param lengths Receives the length of each packet.
+		@param maxCount The most packets to take, at most MAX_DATAGRAM_BATCH.
+		@return The number of packets received or -1 on non-blocking pass.
+	*/
+	int readBatch(char (*buffers)[MAX_UDP_LENGTH], int* lengths, unsigned maxCount);
+
+	/**
+		Receive the packets waiting, up to maxCount, with a timeout for the first.
+		@param buffers maxCount buffers procured by the caller.
+		@param lengths Receives the length of each packet.
+		@param maxCount The most packets to take, at most MAX_DATAGRAM_BATCH.
+		@param timeout maximum wait time in milliseconds
+		@return The number of packets received or -1 on timeout.
+	*/
+	int readBatch(char (*buffers)[MAX_UDP_LENGTH], int* lengths, unsigned maxCount, unsigned timeout);
+
 
 	/** Send a packet to a given destination, other than the default. */
 	int send(const struct sockaddr *dest, const char * buffer, size_t length);
@@ -134,6 +169,11 @@ public:
 	/** Close the socket. */
 	void close();
 
+	private:
+
+	/** Wait for the socket to be readable, return false on timeout. */
+	bool waitForRead(unsigned timeout);
+
 };
 
 
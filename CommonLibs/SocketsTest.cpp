@@ -30,6 +30,7 @@
 #include "Threads.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 
 static const int gNumToSend = 10;
@@ -76,6 +77,28 @@ void *testReaderUnix(void *)
 
 int main(int argc, char * argv[] )
 {
+  // batches in both directions of the system call,
+  // first, so they run even if the per-message section below stalls
+  UDPSocket batchWriter(5062, "127.0.0.1", 5935);
+  UDPSocket batchReader(5935, "127.0.0.1", 5062);
+  const char* messages[gNumToSend];
+  size_t lengths[gNumToSend];
+  for (int i=0; i<gNumToSend; i++) {
+	messages[i] = "Hello batch";
+	lengths[i] = strlen(messages[i])+1;
+  }
+  COUT("writeBatch: " << batchWriter.writeBatch(messages,lengths,gNumToSend));
+  int rc = 0;
+  while (rc<gNumToSend) {
+	char bufs[gNumToSend][MAX_UDP_LENGTH];
+	int counts[gNumToSend];
+	int count = batchReader.readBatch(bufs,counts,gNumToSend,1000);
+	if (count<=0) break;
+	COUT("readBatch: " << count << " packets, first: " << bufs[0]);
+	rc += count;
+  }
+  bool batchPass = (rc==gNumToSend);
+  COUT("batch: " << (batchPass ? "passed" : "FAILED"));
 
   Thread readerThreadIP;
   readerThreadIP.start(testReaderIP,NULL);
@@ -98,6 +121,8 @@ int main(int argc, char * argv[] )
 
   readerThreadIP.join();
   readerThreadUnix.join();
+
+  return batchPass ? 0 : 1;
 }
 
 // vim: ts=4 sw=4
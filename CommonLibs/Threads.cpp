@@ -103,6 +103,13 @@ void Signal::wait(Mutex& wMutex, unsigned timeout) const
 }
 
 
+void Signal::wait(Mutex& wMutex, const Timeval& deadline) const
+{
+	struct timespec waitTime = deadline.timespec();
+	pthread_cond_timedwait(&mSignal,&wMutex.mMutex,&waitTime);
+}
+
+
 void Thread::start(void *(*task)(void*), void *arg)
 {
 	assert(mThread==((pthread_t)0));
@@ -104,6 +104,8 @@ class ScopedLock {
 
 
 
+class Timeval;
+
 /** A C++ interthread signal based on pthread condition variables. */
 class Signal {
 
@@ -123,6 +125,12 @@ class Signal {
 	*/
 	void wait(Mutex& wMutex, unsigned timeout) const;
 
+	/**
+		Block for the signal up to a given system time.
+		Under Linux, spurious returns are possible.
+	*/
+	void wait(Mutex& wMutex, const Timeval& deadline) const;
+
 	/**
 		Block for the signal.
 		Under Linux, spurious returns are possible.
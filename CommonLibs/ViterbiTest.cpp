@@ -0,0 +1,183 @@
+/*
+* Copyright 2008, 2009 Free Software Foundation, Inc.
+*
+*
+* This software is distributed under the terms of the GNU Affero Public License.
+* See the COPYING file in the main directory for details.
+*
+* This use of this software may be subject to additional restrictions.
+* See the LEGAL file in the main directory for details.
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU Affero General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU Affero General Public License for more details.
+
+	You should have received a copy of the GNU Affero General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+/*
+	Compares SoftVector::decode() against the original decoder, which
+	runs ViterbiR2O4::step() one sample at a time, on encoded random
+	blocks of the GSM block sizes at several noise levels.
+
+	The fixed point metrics can break a near tie the other way, so blocks
+	must match exactly only up to a moderate noise level. Above that, the
+	decoded bit error rates must agree.
+*/
+
+
+#include "BitVector.h"
+#include <iostream>
+#include <cstdlib>
+#include <math.h>
+
+using namespace std;
+
+
+/** The float decoder from before the traceback decoder. */
+void referenceDecode(const SoftVector& soft, ViterbiR2O4 &decoder, BitVector& target)
+{
+	const size_t sz = soft.size();
+	const unsigned deferral = decoder.deferral();
+	const size_t ctsz = sz + deferral*decoder.iRate();
+	assert(sz <= decoder.iRate()*target.size());
+
+	uint32_t history[ctsz];
+	{
+		BitVector bits = soft.sliced();
+		uint32_t accum = 0;
+		for (size_t i=0; i<sz; i++) {
+			accum = (accum<<1) | bits.bit(i);
+			history[i] = accum;
+		}
+		for (size_t i=sz; i<ctsz; i++) {
+			accum = (accum<<1) | (accum & 0x01);
+			history[i] = accum;
+		}
+	}
+
+	float matchCostTable[ctsz];
+	float mismatchCostTable[ctsz];
+	{
+		const float *dp = soft.begin();
+		for (size_t i=0; i<sz; i++) {
+			float pVal = dp[i];
+			if (pVal>0.5F) pVal = 1.0F-pVal;
+			float ipVal = 1.0F-pVal;
+			if (pVal<0.01F) pVal = 0.01;
+			if (ipVal<0.01F) ipVal = 0.01;
+			matchCostTable[i] = 0.25F/ipVal;
+			mismatchCostTable[i] = 0.25F/pVal;
+		}
+		for (size_t i=sz; i<ctsz; i++) {
+			matchCostTable[i] = 0.5F;
+			mismatchCostTable[i] = 0.5F;
+		}
+	}
+
+	decoder.initializeStates();
+	const unsigned step = decoder.iRate();
+	const uint32_t *ip = history + step - 1;
+	char *op = target.begin();
+	const char *const opt = target.end();
+	const float* match = matchCostTable;
+	const float* mismatch = mismatchCostTable;
+	size_t oCount = 0;
+	while (op<opt) {
+		const ViterbiR2O4::vCand &minCost = decoder.step(*ip, match, mismatch);
+		ip += step;
+		match += step;
+		mismatch += step;
+		if (oCount>=deferral) *op++ = (minCost.iState >> deferral)&0x01;
+		oCount++;
+	}
+}
+
+
+float gaussian()
+{
+	float u1 = (random()+1.0F)/(RAND_MAX+2.0F);
+	float u2 = (random()+1.0F)/(RAND_MAX+2.0F);
+	return sqrtf(-2.0F*logf(u1))*cosf(2.0F*M_PI*u2);
+}
+
+
+int main(int argc, char *argv[])
+{
+	// TCH/FS class 1, XCCH and RACH sizes, with their tail bits
+	static const unsigned blockSizes[] = { 189, 228, 18 };
+	static const float noiseLevels[] = { 0.0F, 0.3F, 0.5F, 0.7F, 1.0F };
+	const float exactNoise = 0.5F;
+	const unsigned trials = 200;
+
+	ViterbiR2O4 coder;
+	ViterbiR2O4 reference;
+	unsigned numBlocks = 0;
+	unsigned numMatched = 0;
+	bool pass = true;
+
+	for (unsigned b=0; b<sizeof(blockSizes)/sizeof(blockSizes[0]); b++) {
+		const unsigned len = blockSizes[b];
+		for (unsigned n=0; n<sizeof(noiseLevels)/sizeof(noiseLevels[0]); n++) {
+			unsigned bitErrors = 0;
+			unsigned refErrors = 0;
+			for (unsigned t=0; t<trials; t++) {
+				BitVector u(len);
+				for (unsigned i=0; i<len-4; i++) u[i] = random() & 0x01;
+				u.tail(len-4).zero();
+				BitVector c(2*len);
+				u.encode(coder,c);
+
+				// BPSK through gaussian noise, then to probabilities
+				SoftVector soft(2*len);
+				for (unsigned i=0; i<2*len; i++) {
+					float x = (c.bit(i) ? 1.0F : -1.0F) + noiseLevels[n]*gaussian();
+					soft[i] = 1.0F/(1.0F+expf(-4.0F*x));
+				}
+				// some erased symbols, as after puncturing or stealing
+				for (unsigned i=0; i<len/8; i++) soft[random()%(2*len)] = 0.5F;
+
+				BitVector expected(len);
+				referenceDecode(soft,reference,expected);
+				BitVector result(len);
+				soft.decode(coder,result);
+
+				numBlocks++;
+				bool match = true;
+				for (unsigned i=0; i<len; i++) {
+					if (result.bit(i) != expected.bit(i)) match = false;
+					if (result.bit(i) != u.bit(i)) bitErrors++;
+					if (expected.bit(i) != u.bit(i)) refErrors++;
+				}
+				if (match) numMatched++;
+				else if (noiseLevels[n] <= exactNoise) {
+					pass = false;
+					cout << "FAIL len=" << len << " noise=" << noiseLevels[n] << endl;
+					cout << " expected=" << expected << endl;
+					cout << " result=  " << result << endl;
+				}
+			}
+			float ber = (float)bitErrors/(trials*len);
+			float refBer = (float)refErrors/(trials*len);
+			cout << "len=" << len << " noise=" << noiseLevels[n]
+				<< " BER=" << ber << " reference BER=" << refBer << endl;
+			if (ber > 1.05F*refBer + 0.001F) {
+				pass = false;
+				cout << "FAIL len=" << len << " noise=" << noiseLevels[n] << " BER" << endl;
+			}
+		}
+	}
+
+	cout << numMatched << "/" << numBlocks << " blocks match" << endl;
+
+	return pass ? 0 : 1;
+}
@@ -11,6 +11,10 @@
 #include <unistd.h>
 #include <stdio.h>
 
+#include <map>
+#include <string>
+#include "Threads.h"
+
 
 // Wrappers to sqlite operations.
 // These will eventually get moved to commonlibs.
@@ -47,18 +51,118 @@ int sqlite3_run_query(sqlite3* DB, sqlite3_stmt *stmt)
 }
 
 
+typedef std::map<std::pair<sqlite3*,std::string>,sqlite3_stmt*> StatementCache;
+
+// These are allocated on first use and never deleted,
+// since tables are opened during static initialization and used until exit.
+static StatementCache& statementCache()
+{
+	static StatementCache *cache = new StatementCache;
+	return *cache;
+}
+
+static Mutex& statementCacheLock()
+{
+	static Mutex *lock = new Mutex;
+	return *lock;
+}
+
+
+sqlite3_stmt* sqlite3_cached_statement(sqlite3* DB, const char* query)
+{
+	{
+		ScopedLock lock(statementCacheLock());
+		StatementCache &cache = statementCache();
+		StatementCache::iterator itr = cache.find(std::make_pair(DB,std::string(query)));
+		if (itr!=cache.end()) {
+			sqlite3_stmt *stmt = itr->second;
+			cache.erase(itr);
+			return stmt;
+		}
+	}
+	// Not cached, or another thread has it now.
+	sqlite3_stmt *stmt;
+	if (sqlite3_prepare_statement(DB,&stmt,query)) return NULL;
+	return stmt;
+}
+
+
+void sqlite3_release_statement(sqlite3* DB, const char* query, sqlite3_stmt* stmt)
+{
+	if (!stmt) return;
+	sqlite3_reset(stmt);
+	sqlite3_clear_bindings(stmt);
+	ScopedLock lock(statementCacheLock());
+	StatementCache &cache = statementCache();
+	std::pair<sqlite3*,std::string> key(DB,std::string(query));
+	// Keep one statement per query; extras come from concurrent use.
+	if (cache.find(key)==cache.end()) cache[key] = stmt;
+	else sqlite3_finalize(stmt);
+}
+
+
+int sqlite3_close_database(sqlite3* DB)
+{
+	{
+		ScopedLock lock(statementCacheLock());
+		StatementCache &cache = statementCache();
+		StatementCache::iterator itr = cache.lower_bound(std::make_pair(DB,std::string()));
+		while (itr!=cache.end() && itr->first.first==DB) {
+			sqlite3_finalize(itr->second);
+			cache.erase(itr++);
+		}
+	}
+	return sqlite3_close(DB);
+}
+
+
+bool sqlite3_enable_wal(sqlite3* DB, int busyTimeout)
+{
+	sqlite3_busy_timeout(DB,busyTimeout);
+	// This pragma answers with the resulting mode.
+	sqlite3_stmt *stmt;
+	if (sqlite3_prepare_statement(DB,&stmt,"PRAGMA journal_mode=WAL")) return false;
+	bool wal = false;
+	if (sqlite3_run_query(DB,stmt)==SQLITE_ROW) {
+		const char* mode = (const char*)sqlite3_column_text(stmt,0);
+		wal = mode && strcmp(mode,"wal")==0;
+	}
+	sqlite3_finalize(stmt);
+	if (!wal) {
+		fprintf(stderr,"cannot set WAL journaling: %s\n",sqlite3_errmsg(DB));
+		return false;
+	}
+	return sqlite3_command(DB,"PRAGMA synchronous=NORMAL");
+}
+
+
+
+/**
+	Look up one column of the first row matching a key, through the statement cache.
+	The key is bound, so it needs no quoting.
+	@return SQLITE_ROW with the statement left on the row, or an error; release the statement either way.
+*/
+static int single_lookup(sqlite3* DB, const char* tableName,
+		const char* keyName, const char* keyData, const unsigned* keyNumber,
+		const char* valueName, char* query, sqlite3_stmt* &stmt)
+{
+	sprintf(query,"SELECT %s FROM %s WHERE %s == ?",valueName,tableName,keyName);
+	stmt = sqlite3_cached_statement(DB,query);
+	if (!stmt) return SQLITE_ERROR;
+	if (keyNumber) sqlite3_bind_int64(stmt,1,*keyNumber);
+	else sqlite3_bind_text(stmt,1,keyData,-1,SQLITE_TRANSIENT);
+	return sqlite3_run_query(DB,stmt);
+}
+
+
 bool sqlite3_exists(sqlite3* DB, const char *tableName,
 		const char* keyName, const char* keyData)
 {
-	size_t stringSize = 100 + strlen(tableName) + strlen(keyName) + strlen(keyData);
+	size_t stringSize = 100 + strlen(tableName) + strlen(keyName);
 	char query[stringSize];
-	sprintf(query,"SELECT * FROM %s WHERE %s == \"%s\"",tableName,keyName,keyData);
-	// Prepare the statement.
 	sqlite3_stmt *stmt;
-	if (sqlite3_prepare_statement(DB,&stmt,query)) return false;
-	// Read the result.
-	int src = sqlite3_run_query(DB,stmt);
-	sqlite3_finalize(stmt);
+	int src = single_lookup(DB,tableName,keyName,keyData,NULL,"*",query,stmt);
+	sqlite3_release_statement(DB,query,stmt);
 	// Anything there?
 	return (src == SQLITE_ROW);
 }
@@ -69,20 +173,16 @@ bool sqlite3_single_lookup(sqlite3* DB, const char *tableName,
 		const char* keyName, const char* keyData,
 		const char* valueName, unsigned &valueData)
 {
-	size_t stringSize = 100 + strlen(valueName) + strlen(tableName) + strlen(keyName) + strlen(keyData);
+	size_t stringSize = 100 + strlen(valueName) + strlen(tableName) + strlen(keyName);
 	char query[stringSize];
-	sprintf(query,"SELECT %s FROM %s WHERE %s == \"%s\"",valueName,tableName,keyName,keyData);
-	// Prepare the statement.
 	sqlite3_stmt *stmt;
-	if (sqlite3_prepare_statement(DB,&stmt,query)) return false;
-	// Read the result.
-	int src = sqlite3_run_query(DB,stmt);
+	int src = single_lookup(DB,tableName,keyName,keyData,NULL,valueName,query,stmt);
 	bool retVal = false;
 	if (src == SQLITE_ROW) {
 		valueData = (unsigned)sqlite3_column_int64(stmt,0);
 		retVal = true;
 	}
-	sqlite3_finalize(stmt);
+	sqlite3_release_statement(DB,query,stmt);
 	return retVal;
 }
 
@@ -93,21 +193,17 @@ bool sqlite3_single_lookup(sqlite3* DB, const char* tableName,
 		const char* valueName, char* &valueData)
 {
 	valueData=NULL;
-	size_t stringSize = 100 + strlen(valueName) + strlen(tableName) + strlen(keyName) + strlen(keyData);
+	size_t stringSize = 100 + strlen(valueName) + strlen(tableName) + strlen(keyName);
 	char query[stringSize];
-	sprintf(query,"SELECT %s FROM %s WHERE %s == \"%s\"",valueName,tableName,keyName,keyData);
-	// Prepare the statement.
 	sqlite3_stmt *stmt;
-	if (sqlite3_prepare_statement(DB,&stmt,query)) return false;
-	// Read the result.
-	int src = sqlite3_run_query(DB,stmt);
+	int src = single_lookup(DB,tableName,keyName,keyData,NULL,valueName,query,stmt);
 	bool retVal = false;
 	if (src == SQLITE_ROW) {
 		const char* ptr = (const char*)sqlite3_column_text(stmt,0);
 		if (ptr) valueData = strdup(ptr);
 		retVal = true;
 	}
-	sqlite3_finalize(stmt);
+	sqlite3_release_statement(DB,query,stmt);
 	return retVal;
 }
 
@@ -118,21 +214,17 @@ bool sqlite3_single_lookup(sqlite3* DB, const char* tableName,
 		const char* valueName, char* &valueData)
 {
 	valueData=NULL;
-	size_t stringSize = 100 + strlen(valueName) + strlen(tableName) + strlen(keyName) + 20;
+	size_t stringSize = 100 + strlen(valueName) + strlen(tableName) + strlen(keyName);
 	char query[stringSize];
-	sprintf(query,"SELECT %s FROM %s WHERE %s == %u",valueName,tableName,keyName,keyData);
-	// Prepare the statement.
 	sqlite3_stmt *stmt;
-	if (sqlite3_prepare_statement(DB,&stmt,query)) return false;
-	// Read the result.
-	int src = sqlite3_run_query(DB,stmt);
+	int src = single_lookup(DB,tableName,keyName,NULL,&keyData,valueName,query,stmt);
 	bool retVal = false;
 	if (src == SQLITE_ROW) {
 		const char* ptr = (const char*)sqlite3_column_text(stmt,0);
 		if (ptr) valueData = strdup(ptr);
 		retVal = true;
 	}
-	sqlite3_finalize(stmt);
+	sqlite3_release_statement(DB,query,stmt);
 	return retVal;
 }
 
@@ -151,4 +243,18 @@ bool sqlite3_command(sqlite3* DB, const char* query)
 }
 
 
+bool sqlite3_command(sqlite3* DB, const char* query, unsigned numParams, const char* const* params)
+{
+	sqlite3_stmt *stmt = sqlite3_cached_statement(DB,query);
+	if (!stmt) return false;
+	for (unsigned i=0; i<numParams; i++) {
+		if (params[i]) sqlite3_bind_text(stmt,i+1,params[i],-1,SQLITE_TRANSIENT);
+		else sqlite3_bind_null(stmt,i+1);
+	}
+	int src = sqlite3_run_query(DB,stmt);
+	sqlite3_release_statement(DB,query,stmt);
+	return src==SQLITE_DONE;
+}
+
+
 
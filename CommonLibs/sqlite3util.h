@@ -26,4 +26,35 @@ bool sqlite3_exists(sqlite3* DB, const char* tableName,
 /** Run a query, ignoring the result; return true on success. */
 bool sqlite3_command(sqlite3* DB, const char* query);
 
+/**
+	Run a query through the statement cache, ignoring the result; return true on success.
+	Each "?" in the query is bound, in order, to the next of the params; a NULL binds SQL NULL.
+	The params are text; column affinity converts them when stored or compared to a column,
+	but not inside other expressions, so bind numbers there through sqlite3_cached_statement.
+*/
+bool sqlite3_command(sqlite3* DB, const char* query, unsigned numParams, const char* const* params);
+
+/**@name Per-connection cache of prepared statements, keyed by the SQL text. */
+//@{
+/**
+	Take a prepared statement for this query from the cache, or prepare a new one.
+	The caller has it to itself until it is returned with sqlite3_release_statement.
+	@return The statement, or NULL if it does not compile.
+*/
+sqlite3_stmt* sqlite3_cached_statement(sqlite3* DB, const char* query);
+
+/** Reset a statement from sqlite3_cached_statement and return it to the cache. */
+void sqlite3_release_statement(sqlite3* DB, const char* query, sqlite3_stmt* stmt);
+
+/** Finalize the cached statements of a connection and close it. */
+int sqlite3_close_database(sqlite3* DB);
+//@}
+
+/**
+	Set a connection up for many small writes:
+	write-ahead logging, synchronous=NORMAL and a busy timeout in milliseconds.
+	@return true on success.
+*/
+bool sqlite3_enable_wal(sqlite3* DB, int busyTimeout=1000);
+
 #endif
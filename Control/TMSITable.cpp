@@ -37,6 +37,8 @@
 #include <string>
 #include <iostream>
 #include <iomanip>
+#include <string.h>
+#include <unistd.h>
 
 using namespace std;
 using namespace Control;
@@ -78,6 +80,18 @@ int TMSITable::open(const char* wPath)
 		LOG(EMERG) << "Cannot create TMSI table";
         return 1;
 	}
+	if (gConfig.getNum("Control.Reporting.WAL",0)) sqlite3_enable_wal(mDB);
+	if (sqlite3_prepare_statement(mDB,&mInsertStmt,
+			"INSERT INTO TMSI_TABLE (IMSI,CREATED,ACCESSED,PREV_MCC,PREV_MNC,PREV_LAC,OLD_TMSI) "
+			"VALUES (?,?,?,?,?,?,?)") ||
+		sqlite3_prepare_statement(mDB,&mUpdateStmt,
+			"UPDATE TMSI_TABLE SET ACCESSED=?,L3TI=COALESCE(?,L3TI),IMEI=COALESCE(?,IMEI),"
+			"A5_SUPPORT=COALESCE(?,A5_SUPPORT),POWER_CLASS=COALESCE(?,POWER_CLASS) WHERE TMSI=?")) {
+		LOG(EMERG) << "Cannot prepare TMSI table statements: " << sqlite3_errmsg(mDB);
+		return 1;
+	}
+	load();
+	mFlushThread.start((void*(*)(void*))TMSIFlushLoopAdapter,this);
     return 0;
 }
 
@@ -85,7 +99,37 @@ int TMSITable::open(const char* wPath)
 
 TMSITable::~TMSITable()
 {
-	if (mDB) sqlite3_close(mDB);
+	// The flush thread and late LURs may still be running,
+	// so the database goes away under the same locks they use.
+	ScopedLock flushLock(mFlushLock);
+	flush();
+	ScopedLock lock(mDBLock);
+	if (!mDB) return;
+	sqlite3_finalize(mInsertStmt);
+	sqlite3_finalize(mUpdateStmt);
+	sqlite3_close_database(mDB);
+	mDB = NULL;
+}
+
+
+
+void TMSITable::load()
+{
+	sqlite3_stmt *stmt;
+	if (sqlite3_prepare_statement(mDB,&stmt,"SELECT TMSI,IMSI,L3TI FROM TMSI_TABLE")) {
+		LOG(ERR) << "sqlite3_prepare_statement failed";
+		return;
+	}
+	ScopedLock lock(mLock);
+	while (sqlite3_run_query(mDB,stmt)==SQLITE_ROW) {
+		unsigned TMSI = (unsigned)sqlite3_column_int64(stmt,0);
+		const char* IMSI = (const char*)sqlite3_column_text(stmt,1);
+		if (!IMSI) continue;
+		mIMSIs[IMSI] = TMSIRecord(TMSI,(unsigned)sqlite3_column_int(stmt,2));
+		mTMSIs[TMSI] = IMSI;
+	}
+	sqlite3_finalize(stmt);
+	LOG(INFO) << "loaded " << mIMSIs.size() << " TMSI table entries";
 }
 
 
@@ -95,63 +139,62 @@ unsigned TMSITable::assign(const char* IMSI, const GSM::L3LocationUpdatingReques
 {
 	// Create or find an entry based on IMSI.
 	// Return assigned TMSI.
-	assert(mDB);
 
-	gReports.incr("OpenBTS.GSM.MM.TMSI.Assigned");
+	static ReportingHandle assigned = gReports.handle("OpenBTS.GSM.MM.TMSI.Assigned");
+	gReports.incr(assigned);
 
 	LOG(DEBUG) << "IMSI=" << IMSI;
 	// Is there already a record?
-	unsigned TMSI;
-	if (sqlite3_single_lookup(mDB,"TMSI_TABLE","IMSI",IMSI,"TMSI",TMSI)) {
+	ScopedLock lock(mLock);
+	IMSIMap::iterator itr = mIMSIs.find(IMSI);
+	if (itr!=mIMSIs.end()) {
+		unsigned TMSI = itr->second.mTMSI;
 		LOG(DEBUG) << "found TMSI " << TMSI;
 		touch(TMSI);
 		return TMSI;
 	}
 
 	// Create a new record.
+	// This one is written at once, since the database assigns the TMSI.
 	LOG(NOTICE) << "new entry for IMSI " << IMSI;
-	char query[1000];
 	unsigned now = (unsigned)time(NULL);
-	if (!lur) {
-		sprintf(query,
-				"INSERT INTO TMSI_TABLE (IMSI,CREATED,ACCESSED) "
-				"VALUES ('%s',%u,%u)",
-				IMSI,now,now);
-	} else {
+	ScopedLock DBLock(mDBLock);
+	if (!mDB) {
+		LOG(ALERT) << "no TMSI table database, cannot create TMSI";
+		return 0;
+	}
+	sqlite3_bind_text(mInsertStmt,1,IMSI,-1,SQLITE_TRANSIENT);
+	sqlite3_bind_int64(mInsertStmt,2,now);
+	sqlite3_bind_int64(mInsertStmt,3,now);
+	if (lur) {
 		const GSM::L3LocationAreaIdentity &lai = lur->LAI();
 		const GSM::L3MobileIdentity &mid = lur->mobileID();
-		if (mid.type()==GSM::TMSIType) {
-			sprintf(query,
-					"INSERT INTO TMSI_TABLE (IMSI,CREATED,ACCESSED,PREV_MCC,PREV_MNC,PREV_LAC,OLD_TMSI) "
-					"VALUES ('%s',%u,%u,%u,%u,%u,%u)",
-					IMSI,now,now,lai.MCC(),lai.MNC(),lai.LAC(),mid.TMSI());
-		} else {
-			sprintf(query,
-					"INSERT INTO TMSI_TABLE (IMSI,CREATED,ACCESSED,PREV_MCC,PREV_MNC,PREV_LAC) "
-					"VALUES ('%s',%u,%u,%u,%u,%u)",
-					IMSI,now,now,lai.MCC(),lai.MNC(),lai.LAC());
-		}
+		sqlite3_bind_int64(mInsertStmt,4,lai.MCC());
+		sqlite3_bind_int64(mInsertStmt,5,lai.MNC());
+		sqlite3_bind_int64(mInsertStmt,6,lai.LAC());
+		if (mid.type()==GSM::TMSIType) sqlite3_bind_int64(mInsertStmt,7,mid.TMSI());
 	}
-	if (!sqlite3_command(mDB,query)) {
+	int src = sqlite3_run_query(mDB,mInsertStmt);
+	sqlite3_reset(mInsertStmt);
+	sqlite3_clear_bindings(mInsertStmt);
+	if (src!=SQLITE_DONE) {
 		LOG(ALERT) << "TMSI creation failed";
 		return 0;
 	}
-	if (!sqlite3_single_lookup(mDB,"TMSI_TABLE","IMSI",IMSI,"TMSI",TMSI)) {
-		LOG(ERR) << "TMSI database inconsistancy";
-		return 0;
-	}
+	unsigned TMSI = (unsigned)sqlite3_last_insert_rowid(mDB);
+	mIMSIs[IMSI] = TMSIRecord(TMSI);
+	mTMSIs[TMSI] = IMSI;
 	return TMSI;
 }
 	
 
 
-void TMSITable::touch(unsigned TMSI) const
+TMSIUpdate& TMSITable::touch(unsigned TMSI) const
 {
-	// Update timestamp.
-	char query[100];
-	sprintf(query,"UPDATE TMSI_TABLE SET ACCESSED = %u WHERE TMSI == %u",
-		(unsigned)time(NULL),TMSI);
-	sqlite3_command(mDB,query);
+	// Update timestamp, in the next flush.
+	TMSIUpdate &update = mUpdates[TMSI];
+	update.mAccessed = (unsigned)time(NULL);
+	return update;
 }
 
 
@@ -159,16 +202,20 @@ void TMSITable::touch(unsigned TMSI) const
 // Returned string must be free'd by the caller.
 char* TMSITable::IMSI(unsigned TMSI) const
 {
-	char* IMSI = NULL;
-	if (sqlite3_single_lookup(mDB,"TMSI_TABLE","TMSI",TMSI,"IMSI",IMSI)) touch(TMSI);
-	return IMSI;
+	ScopedLock lock(mLock);
+	TMSIMap::const_iterator itr = mTMSIs.find(TMSI);
+	if (itr==mTMSIs.end()) return NULL;
+	touch(TMSI);
+	return strdup(itr->second.c_str());
 }
 
 unsigned TMSITable::TMSI(const char* IMSI) const
 {
-	unsigned TMSI=0;
-	if (sqlite3_single_lookup(mDB,"TMSI_TABLE","IMSI",IMSI,"TMSI",TMSI)) touch(TMSI);
-	return TMSI;
+	ScopedLock lock(mLock);
+	IMSIMap::const_iterator itr = mIMSIs.find(IMSI);
+	if (itr==mIMSIs.end()) return 0;
+	touch(itr->second.mTMSI);
+	return itr->second.mTMSI;
 }
 
 
@@ -197,6 +244,9 @@ void printAge(unsigned seconds, ostream& os)
 
 void TMSITable::dump(ostream& os) const
 {
+	// Bring the ages up to date first.
+	flush();
+	ScopedLock lock(mDBLock);
 	sqlite3_stmt *stmt;
 	if (sqlite3_prepare_statement(mDB,&stmt,"SELECT TMSI,IMSI,CREATED,ACCESSED FROM TMSI_TABLE")) {
 		LOG(ERR) << "sqlite3_prepare_statement failed";
@@ -217,6 +267,11 @@ void TMSITable::dump(ostream& os) const
 
 void TMSITable::clear()
 {
+	ScopedLock lock(mLock);
+	mIMSIs.clear();
+	mTMSIs.clear();
+	mUpdates.clear();
+	ScopedLock DBLock(mDBLock);
 	sqlite3_command(mDB,"DELETE FROM TMSI_TABLE WHERE 1");
 }
 
@@ -224,46 +279,101 @@ void TMSITable::clear()
 
 bool TMSITable::IMEI(const char* IMSI, const char *IMEI)
 {
-	char query[100];
-	sprintf(query,"UPDATE TMSI_TABLE SET IMEI=\"%s\",ACCESSED=%u WHERE IMSI=\"%s\"",
-		IMEI,(unsigned)time(NULL),IMSI);
-	return sqlite3_command(mDB,query);
+	if (!mDB) return false;
+	ScopedLock lock(mLock);
+	IMSIMap::const_iterator itr = mIMSIs.find(IMSI);
+	// No record, nothing to update.
+	if (itr==mIMSIs.end()) return true;
+	TMSIUpdate &update = touch(itr->second.mTMSI);
+	update.mIMEI = IMEI;
+	update.mFields |= TMSIUpdate::IMEI;
+	return true;
 }
 
 
 
 bool TMSITable::classmark(const char* IMSI, const GSM::L3MobileStationClassmark2& classmark)
 {
+	if (!mDB) return false;
 	int A5Bits = (classmark.A5_1()<<2) + (classmark.A5_2()<<1) + classmark.A5_3();
-	char query[100];
-	sprintf(query,
-		"UPDATE TMSI_TABLE SET A5_SUPPORT=%u,ACCESSED=%u,POWER_CLASS=%u "
-		" WHERE IMSI=\"%s\"",
-		A5Bits,(unsigned)time(NULL),classmark.powerClass(),IMSI);
-	return sqlite3_command(mDB,query);
+	ScopedLock lock(mLock);
+	IMSIMap::const_iterator itr = mIMSIs.find(IMSI);
+	if (itr==mIMSIs.end()) return true;
+	TMSIUpdate &update = touch(itr->second.mTMSI);
+	update.mA5Bits = A5Bits;
+	update.mPowerClass = classmark.powerClass();
+	update.mFields |= TMSIUpdate::Classmark;
+	return true;
 }
 
 
 
 unsigned TMSITable::nextL3TI(const char* IMSI)
 {
-	// FIXME -- This should be a single atomic operation.
-	unsigned l3ti;
-	if (!sqlite3_single_lookup(mDB,"TMSI_TABLE","IMSI",IMSI,"L3TI",l3ti)) {
+	ScopedLock lock(mLock);
+	IMSIMap::iterator itr = mIMSIs.find(IMSI);
+	if (itr==mIMSIs.end()) {
 		LOG(ERR) << "cannot read L3TI from TMSI_TABLE, using random L3TI";
 		return random() % 8;
 	}
 	// Note that TI=7 is a reserved value, so value values are 0-6.  See GSM 04.07 11.2.3.1.3.
-	unsigned next = (l3ti+1) % 7;
-	char query[200];
-	sprintf(query,"UPDATE TMSI_TABLE SET L3TI=%u,ACCESSED=%u WHERE IMSI='%s'",
-		next, (unsigned)time(NULL),IMSI);
-	if (!sqlite3_command(mDB,query)) {
-		LOG(ALERT) << "cannot write L3TI to TMSI_TABLE";
-	}
+	unsigned next = (itr->second.mL3TI+1) % 7;
+	itr->second.mL3TI = next;
+	TMSIUpdate &update = touch(itr->second.mTMSI);
+	update.mL3TI = next;
+	update.mFields |= TMSIUpdate::L3TI;
 	return next;
 }
 
 
 
+void TMSITable::flush() const
+{
+	ScopedLock flushLock(mFlushLock);
+	UpdateMap updates;
+	mLock.lock();
+	updates.swap(mUpdates);
+	mLock.unlock();
+	if (updates.empty()) return;
+
+	ScopedLock lock(mDBLock);
+	if (!mDB) return;
+	if (!sqlite3_command(mDB,"BEGIN TRANSACTION")) {
+		LOG(ALERT) << "cannot begin TMSI table update: " << sqlite3_errmsg(mDB);
+		return;
+	}
+	for (UpdateMap::const_iterator itr = updates.begin(); itr!=updates.end(); ++itr) {
+		const TMSIUpdate &update = itr->second;
+		sqlite3_bind_int64(mUpdateStmt,1,update.mAccessed);
+		if (update.mFields & TMSIUpdate::L3TI) sqlite3_bind_int64(mUpdateStmt,2,update.mL3TI);
+		if (update.mFields & TMSIUpdate::IMEI) sqlite3_bind_text(mUpdateStmt,3,update.mIMEI.c_str(),-1,SQLITE_TRANSIENT);
+		if (update.mFields & TMSIUpdate::Classmark) {
+			sqlite3_bind_int64(mUpdateStmt,4,update.mA5Bits);
+			sqlite3_bind_int64(mUpdateStmt,5,update.mPowerClass);
+		}
+		sqlite3_bind_int64(mUpdateStmt,6,itr->first);
+		if (sqlite3_run_query(mDB,mUpdateStmt)!=SQLITE_DONE) {
+			LOG(ALERT) << "cannot update TMSI " << hex << itr->first << dec << " in TMSI_TABLE";
+		}
+		sqlite3_reset(mUpdateStmt);
+		sqlite3_clear_bindings(mUpdateStmt);
+	}
+	if (!sqlite3_command(mDB,"COMMIT TRANSACTION")) {
+		LOG(ALERT) << "cannot commit TMSI table update: " << sqlite3_errmsg(mDB);
+		sqlite3_command(mDB,"ROLLBACK TRANSACTION");
+	}
+}
+
+
+void *Control::TMSIFlushLoopAdapter(TMSITable *table)
+{
+	while (true) {
+		sleep(1);
+		table->flush();
+	}
+	return NULL;
+}
+
+
+
 // vim: ts=4 sw=4
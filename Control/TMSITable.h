@@ -28,12 +28,14 @@
 #define TMSITABLE_H
 
 #include <map>
+#include <string>
 
 #include <Timeval.h>
 #include <Threads.h>
 
 
 struct sqlite3;
+struct sqlite3_stmt;
 
 namespace GSM {
 class L3LocationUpdatingRequest;
@@ -44,12 +46,65 @@ class L3MobileIdentity;
 
 namespace Control {
 
+
+/** The cached part of a TMSI_TABLE row. */
+struct TMSIRecord {
+	unsigned mTMSI;
+	unsigned mL3TI;
+	TMSIRecord(unsigned wTMSI=0, unsigned wL3TI=0):mTMSI(wTMSI),mL3TI(wL3TI) {}
+};
+
+
+/** Changes to a TMSI_TABLE row not yet written. */
+struct TMSIUpdate {
+
+	/** Bits of mFields, naming the columns that are set besides ACCESSED. */
+	enum Field {
+		L3TI = 0x01,
+		IMEI = 0x02,
+		Classmark = 0x04	///< A5_SUPPORT and POWER_CLASS
+	};
+
+	unsigned mFields;
+	unsigned mAccessed;
+	unsigned mL3TI;
+	std::string mIMEI;
+	unsigned mA5Bits;
+	unsigned mPowerClass;
+
+	TMSIUpdate():mFields(0),mAccessed(0),mL3TI(0),mA5Bits(0),mPowerClass(0) {}
+};
+
+
+/**
+	The TMSI table.
+	The IMSI/TMSI mapping and the L3TIs are cached in memory, loaded when the table is opened.
+	New TMSIs are written at once; other changes are written behind, in batches.
+*/
 class TMSITable {
 
 	private:
 
 	sqlite3 *mDB;			///< database connection
 
+	typedef std::map<std::string,TMSIRecord> IMSIMap;
+	typedef std::map<unsigned,std::string> TMSIMap;
+	typedef std::map<unsigned,TMSIUpdate> UpdateMap;
+
+	/**@name The cache, authoritative for these columns. */
+	//@{
+	IMSIMap mIMSIs;					///< TMSI and L3TI by IMSI
+	TMSIMap mTMSIs;					///< IMSI by TMSI
+	mutable UpdateMap mUpdates;		///< changes not yet written, by TMSI
+	mutable Mutex mLock;			///< protects the maps; taken before mDBLock
+	//@}
+
+	mutable Mutex mFlushLock;		///< serializes flushes; taken before mLock
+	mutable Mutex mDBLock;			///< serializes use of the database connection
+	sqlite3_stmt *mInsertStmt;		///< creates a row
+	sqlite3_stmt *mUpdateStmt;		///< writes a TMSIUpdate
+	Thread mFlushThread;			///< writes the updates periodically
+
 
 	public:
 
@@ -66,13 +121,13 @@ class TMSITable {
 		Create a new entry in the table.
 		@param IMSI	The IMSI to create an entry for.
 		@param The associated LUR, if any.
-		@return The assigned TMSI.
+		@return The assigned TMSI, or 0 if it could not be created.
 	*/
 	unsigned assign(const char* IMSI, const GSM::L3LocationUpdatingRequest* lur=NULL);
 
 	/**
 		Find an IMSI in the table.
-		This is a log-time operation.
+		This is a log-time operation on the cache.
 		@param TMSI The TMSI to find.
 		@return Pointer to IMSI to be freed by the caller, or NULL.
 	*/
@@ -80,7 +135,7 @@ class TMSITable {
 
 	/**
 		Find a TMSI in the table.
-		This is a linear-time operation.
+		This is a log-time operation on the cache.
 		@param IMSI The IMSI to mach.
 		@return A TMSI value or zero on failure.
 	*/
@@ -101,13 +156,28 @@ class TMSITable {
 	/** Get the next TI value to use for this IMSI or TMSI. */
 	unsigned nextL3TI(const char* IMSI);
 
+	/** Write the pending updates to the database in one transaction. */
+	void flush() const;
+
 	private:
 
-	/** Update the "accessed" time on a record. */
-	void touch(unsigned TMSI) const;
+	/** Load the cache from the database. */
+	void load();
+
+	/**
+		Return the pending update of a record, with its "accessed" time set to now.
+		The caller should hold mLock.
+	*/
+	TMSIUpdate& touch(unsigned TMSI) const;
+
+	friend void *TMSIFlushLoopAdapter(TMSITable*);
 };
 
 
+/** Flush the TMSI table updates periodically. */
+void *TMSIFlushLoopAdapter(TMSITable*);
+
+
 }
 
 #endif
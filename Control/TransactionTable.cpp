@@ -108,7 +108,6 @@ TransactionEntry::TransactionEntry(
 	mCalling(wCalling),
 	mSIP(proxy,mSubscriber.digits()),
 	mGSMState(wState),
-	mNumSQLTries(gConfig.getNum("Control.NumSQLTries")),
 	mChannel(wChannel),
 	mTerminationRequested(false),
 	mRemoved(false),
@@ -134,7 +133,6 @@ TransactionEntry::TransactionEntry(
 	mCalled(wCalled),
 	mSIP(proxy,mSubscriber.digits()),
 	mGSMState(GSM::MOCInitiated),
-	mNumSQLTries(gConfig.getNum("Control.NumSQLTries")),
 	mChannel(wChannel),
 	mTerminationRequested(false),
 	mRemoved(false),
@@ -158,7 +156,6 @@ TransactionEntry::TransactionEntry(
 	mL3TI(wL3TI),
 	mSIP(proxy,mSubscriber.digits()),
 	mGSMState(GSM::MOCInitiated),
-	mNumSQLTries(2*gConfig.getNum("Control.NumSQLTries")),
 	mChannel(wChannel),
 	mTerminationRequested(false),
 	mRemoved(false),
@@ -182,7 +179,6 @@ TransactionEntry::TransactionEntry(
 	mL3TI(7),mCalled(wCalled),
 	mSIP(proxy,mSubscriber.digits()),
 	mGSMState(GSM::SMSSubmitting),
-	mNumSQLTries(gConfig.getNum("Control.NumSQLTries")),
 	mChannel(wChannel),
 	mTerminationRequested(false),
 	mRemoved(false),
@@ -205,7 +201,6 @@ TransactionEntry::TransactionEntry(
 	mL3TI(7),
 	mSIP(proxy,mSubscriber.digits()),
 	mGSMState(GSM::SMSSubmitting),
-	mNumSQLTries(gConfig.getNum("Control.NumSQLTries")),
 	mChannel(wChannel),
 	mTerminationRequested(false),
 	mRemoved(false),
@@ -226,9 +221,7 @@ TransactionEntry::~TransactionEntry()
 	gSIPInterface.removeCall(mSIP.callID());
 
 	// Delete the SQL table entry.
-	char query[100];
-	sprintf(query,"DELETE FROM TRANSACTION_TABLE WHERE ID=%u",mID);
-	runQuery(query);
+	journal(TransactionJournalRecord(TransactionJournalRecord::Delete));
 
 }
 
@@ -408,13 +401,10 @@ void TransactionEntry::messageType(const char *wContentType)
 
 
 
-void TransactionEntry::runQuery(const char* query) const
+void TransactionEntry::journal(const TransactionJournalRecord& change) const
 {
 	// Caller should hold mLock and should have already checked mRemoved..
-	for (unsigned i=0; i<mNumSQLTries; i++) {
-		if (sqlite3_command(gTransactionTable.DB(),query)) return;
-	}
-	LOG(ALERT) << "transaction table access failed after " << mNumSQLTries << "attempts. query:" << query << " error: " << sqlite3_errmsg(gTransactionTable.DB());
+	gTransactionTable.journal(mID,change);
 }
 
 
@@ -427,8 +417,6 @@ void TransactionEntry::insertIntoDatabase()
 	ostringstream serviceTypeSS;
 	serviceTypeSS << mService;
 
-	ostringstream sipStateSS;
-	sipStateSS << mSIP.state();
 	mPrevSIPState = mSIP.state();
 
 	char subscriber[25];
@@ -444,31 +432,22 @@ void TransactionEntry::insertIntoDatabase()
 	const char* stateString = GSM::CallStateString(mGSMState);
 	assert(stateString);
 
-	// FIXME -- This should be done in a single SQL transaction.
-
-	char query[500];
+	// The row and its channel go out together in the next journal flush.
+	TransactionJournalRecord row(TransactionJournalRecord::Insert);
 	unsigned now = (unsigned)time(NULL);
-	sprintf(query,"INSERT INTO TRANSACTION_TABLE "
-		        "(ID,CREATED,CHANGED,TYPE,SUBSCRIBER,L3TI,CALLED,CALLING,GSMSTATE,SIPSTATE,SIP_CALLID,SIP_PROXY) "
-		"VALUES  (%u,%u,     %u,     '%s','%s',      %u,'%s',  '%s',   '%s',    '%s',      '%s',      '%s')",
-		mID,now,now,
-		serviceTypeSS.str().c_str(),
-		subscriber,
-		mL3TI,
-		mCalled.digits(),
-		mCalling.digits(),
-		stateString,
-		sipStateSS.str().c_str(),
-		mSIP.callID().c_str(),
-		mSIP.proxyIP().c_str()
-	);
-
-	runQuery(query);
-
-	if (!mChannel) return;
-	sprintf(query,"UPDATE TRANSACTION_TABLE SET CHANNEL='%s' WHERE ID=%u",
-			mChannel->descriptiveString(), mID);
-	runQuery(query);
+	row.mCreated = now;
+	row.mChanged = now;
+	row.mType = serviceTypeSS.str();
+	row.mSubscriber = subscriber;
+	row.mL3TI = mL3TI;
+	row.mCalled = mCalled.digits();
+	row.mCalling = mCalling.digits();
+	row.mGSMState = stateString;
+	row.mSIPState = SIP::SIPStateString(mSIP.state());
+	row.mSIPCallID = mSIP.callID();
+	row.mSIPProxy = mSIP.proxyIP();
+	if (mChannel) row.mChannel = mChannel->descriptiveString();
+	journal(row);
 }
 
 
@@ -476,19 +455,16 @@ void TransactionEntry::insertIntoDatabase()
 void TransactionEntry::channel(GSM::LogicalChannel* wChannel)
 {
 	if (mRemoved) throw RemovedTransaction(mID);
-	ScopedLock lock(mLock);
-	mChannel = wChannel;
-
-	char query[500];
-	if (mChannel) {
-		sprintf(query,"UPDATE TRANSACTION_TABLE SET CHANGED=%u,CHANNEL='%s' WHERE ID=%u",
-				(unsigned)time(NULL), mChannel->descriptiveString(), mID);
-	} else {
-		sprintf(query,"UPDATE TRANSACTION_TABLE SET CHANGED=%u,CHANNEL=NULL WHERE ID=%u",
-				(unsigned)time(NULL), mID);
+	{
+		ScopedLock lock(mLock);
+		mChannel = wChannel;
+
+		TransactionJournalRecord change(TransactionJournalRecord::Channel);
+		change.mChanged = (unsigned)time(NULL);
+		if (mChannel) change.mChannel = mChannel->descriptiveString();
+		journal(change);
 	}
-
-	runQuery(query);
+	gTransactionTable.reindex(this);
 }
 
 
@@ -531,11 +507,10 @@ void TransactionEntry::GSMState(GSM::CallState wState)
 	const char* stateString = GSM::CallStateString(wState);
 	assert(stateString);
 
-	char query[150];
-	sprintf(query,
-		"UPDATE TRANSACTION_TABLE SET GSMSTATE='%s',CHANGED=%u WHERE ID=%u",
-		stateString,now, mID);
-	runQuery(query);
+	TransactionJournalRecord change(TransactionJournalRecord::GSMState);
+	change.mGSMState = stateString;
+	change.mChanged = now;
+	journal(change);
 }
 
 
@@ -548,13 +523,10 @@ SIP::SIPState TransactionEntry::echoSIPState(SIP::SIPState state) const
 	const char* stateString = SIP::SIPStateString(state);
 	assert(stateString);
 
-	unsigned now = time(NULL);
-
-	char query[150];
-	sprintf(query,
-		"UPDATE TRANSACTION_TABLE SET SIPSTATE='%s',CHANGED=%u WHERE ID=%u",
-		stateString,now,mID);
-	runQuery(query);
+	TransactionJournalRecord change(TransactionJournalRecord::SIPState);
+	change.mSIPState = stateString;
+	change.mChanged = time(NULL);
+	journal(change);
 
 	return state;
 }
@@ -565,9 +537,14 @@ SIP::SIPState TransactionEntry::echoSIPState(SIP::SIPState state) const
 SIP::SIPState TransactionEntry::MOCSendINVITE(const char* calledUser, const char* calledDomain, short rtpPort, unsigned codec)
 {
 	if (mRemoved) throw RemovedTransaction(mID);
-	ScopedLock lock(mLock);
-	SIP::SIPState state = mSIP.MOCSendINVITE(calledUser,calledDomain,rtpPort,codec,channel());
-	echoSIPState(state);
+	SIP::SIPState state;
+	{
+		ScopedLock lock(mLock);
+		state = mSIP.MOCSendINVITE(calledUser,calledDomain,rtpPort,codec,channel());
+		echoSIPState(state);
+	}
+	// The RTP port is indexed.
+	gTransactionTable.reindex(this);
 	return state;
 }
 
@@ -601,9 +578,14 @@ SIP::SIPState TransactionEntry::MOCSendACK()
 SIP::SIPState TransactionEntry::SOSSendINVITE(short rtpPort, unsigned codec)
 {
 	if (mRemoved) throw RemovedTransaction(mID);
-	ScopedLock lock(mLock);
-	SIP::SIPState state = mSIP.SOSSendINVITE(rtpPort,codec,channel());
-	echoSIPState(state);
+	SIP::SIPState state;
+	{
+		ScopedLock lock(mLock);
+		state = mSIP.SOSSendINVITE(rtpPort,codec,channel());
+		echoSIPState(state);
+	}
+	// The RTP port is indexed.
+	gTransactionTable.reindex(this);
 	return state;
 }
 
@@ -648,9 +630,14 @@ SIP::SIPState TransactionEntry::MTCCheckForCancel()
 SIP::SIPState TransactionEntry::MTCSendOK(short rtpPort, unsigned codec)
 {
 	if (mRemoved) throw RemovedTransaction(mID);
-	ScopedLock lock(mLock);
-	SIP::SIPState state = mSIP.MTCSendOK(rtpPort,codec,channel());
-	echoSIPState(state);
+	SIP::SIPState state;
+	{
+		ScopedLock lock(mLock);
+		state = mSIP.MTCSendOK(rtpPort,codec,channel());
+		echoSIPState(state);
+	}
+	// The RTP port is indexed.
+	gTransactionTable.reindex(this);
 	return state;
 }
 
@@ -817,15 +804,22 @@ bool TransactionEntry::sendINFOAndWaitForOK(unsigned info)
 void TransactionEntry::SIPUser(const char* IMSI)
 {
 	if (mRemoved) throw RemovedTransaction(mID);
-	ScopedLock lock(mLock);
-	mSIP.user(IMSI);
+	{
+		ScopedLock lock(mLock);
+		mSIP.user(IMSI);
+	}
+	// The call ID is indexed.
+	gTransactionTable.reindex(this);
 }
 
 void TransactionEntry::SIPUser(const char* callID, const char *IMSI , const char *origID, const char *origHost)
 {
 	if (mRemoved) throw RemovedTransaction(mID);
-	ScopedLock lock(mLock);
-	mSIP.user(callID,IMSI,origID,origHost);
+	{
+		ScopedLock lock(mLock);
+		mSIP.user(callID,IMSI,origID,origHost);
+	}
+	gTransactionTable.reindex(this);
 }
 
 void TransactionEntry::called(const L3CalledPartyBCDNumber& wCalled)
@@ -834,11 +828,9 @@ void TransactionEntry::called(const L3CalledPartyBCDNumber& wCalled)
 	ScopedLock lock(mLock);
 	mCalled = wCalled;
 
-	char query[151];
-	snprintf(query,150,
-		"UPDATE TRANSACTION_TABLE SET CALLED='%s' WHERE ID=%u",
-		mCalled.digits(), mID);
-	runQuery(query);
+	TransactionJournalRecord change(TransactionJournalRecord::Called);
+	change.mCalled = mCalled.digits();
+	journal(change);
 }
 
 
@@ -848,11 +840,9 @@ void TransactionEntry::L3TI(unsigned wL3TI)
 	ScopedLock lock(mLock);
 	mL3TI = wL3TI;
 
-	char query[151];
-	snprintf(query,150,
-		"UPDATE TRANSACTION_TABLE SET L3TI=%u WHERE ID=%u",
-		mL3TI, mID);
-	runQuery(query);
+	TransactionJournalRecord change(TransactionJournalRecord::L3TI);
+	change.mL3TI = mL3TI;
+	journal(change);
 }
 
 
@@ -869,6 +859,9 @@ void TransactionTable::init(const char* path)
 {
 	// This assumes the main application uses sdevrandom.
 	mIDCounter = random();
+	// Dead entries are reaped in the background, not in the searches,
+	// and that must happen even without a database.
+	mSweepThread.start((void*(*)(void*))TransactionSweepLoopAdapter,this);
 	// Connect to the database.
 	int rc = sqlite3_open(path,&mDB);
 	if (rc) {
@@ -884,13 +877,57 @@ void TransactionTable::init(const char* path)
 	// Clear any previous entires.
 	if (!sqlite3_command(gTransactionTable.DB(),"DELETE FROM TRANSACTION_TABLE"))
 		LOG(WARNING) << "cannot clear previous transaction table";
+	if (gConfig.getNum("Control.Reporting.WAL",0)) sqlite3_enable_wal(mDB);
+
+	// Changes to the rows are written behind, in batches.
+	if (sqlite3_prepare_statement(mDB,&mInsertStmt,
+			"INSERT OR REPLACE INTO TRANSACTION_TABLE "
+			"(ID,CREATED,CHANGED,TYPE,SUBSCRIBER,L3TI,CALLED,CALLING,GSMSTATE,SIPSTATE,SIP_CALLID,SIP_PROXY,CHANNEL) "
+			"VALUES (?,?,?,?,?,?,?,?,?,?,?,?,?)") ||
+		sqlite3_prepare_statement(mDB,&mDeleteStmt,
+			"DELETE FROM TRANSACTION_TABLE WHERE ID=?") ||
+		sqlite3_prepare_statement(mDB,&mChannelStmt,
+			"UPDATE TRANSACTION_TABLE SET CHANNEL=?,CHANGED=? WHERE ID=?") ||
+		sqlite3_prepare_statement(mDB,&mGSMStateStmt,
+			"UPDATE TRANSACTION_TABLE SET GSMSTATE=?,CHANGED=? WHERE ID=?") ||
+		sqlite3_prepare_statement(mDB,&mSIPStateStmt,
+			"UPDATE TRANSACTION_TABLE SET SIPSTATE=?,CHANGED=? WHERE ID=?") ||
+		sqlite3_prepare_statement(mDB,&mCalledStmt,
+			"UPDATE TRANSACTION_TABLE SET CALLED=? WHERE ID=?") ||
+		sqlite3_prepare_statement(mDB,&mL3TIStmt,
+			"UPDATE TRANSACTION_TABLE SET L3TI=? WHERE ID=?")) {
+		LOG(ALERT) << "Cannot prepare Transaction Table statements: " << sqlite3_errmsg(mDB);
+		ScopedLock lock(mJournalLock);
+		sqlite3_close(mDB);
+		mDB = NULL;
+		mJournal.clear();
+		return;
+	}
+	mJournalThread.start((void*(*)(void*))TransactionJournalLoopAdapter,this);
 }
 
 TransactionTable::~TransactionTable()
 {
 	// Don't bother disposing of the memory,
 	// since this is only invoked when the application exits.
-	if (mDB) sqlite3_close(mDB);
+	// But do write out the last changes, so the mirror is not stale.
+	// The journal and sweep threads are still running,
+	// so hold off flushes and journaling while the database goes away.
+	ScopedLock flushLock(mFlushLock);
+	if (!mDB) return;
+	flushJournal();
+	sqlite3 *db = mDB;
+	mJournalLock.lock();
+	mDB = NULL;
+	mJournalLock.unlock();
+	sqlite3_finalize(mInsertStmt);
+	sqlite3_finalize(mDeleteStmt);
+	sqlite3_finalize(mChannelStmt);
+	sqlite3_finalize(mGSMStateStmt);
+	sqlite3_finalize(mSIPStateStmt);
+	sqlite3_finalize(mCalledStmt);
+	sqlite3_finalize(mL3TIStmt);
+	sqlite3_close_database(db);
 }
 
 
@@ -908,6 +945,7 @@ void TransactionTable::add(TransactionEntry* value)
 	LOG(INFO) << "new transaction " << *value;
 	ScopedLock lock(mLock);
 	mTable[value->ID()]=value;
+	index(value);
 	value->insertIntoDatabase();
 }
 
@@ -933,6 +971,7 @@ void TransactionTable::innerRemove(TransactionMap::iterator itr)
 	// This should not be called anywhere but from clearDeadEntries.
 	LOG(DEBUG) << "removing transaction: " << *(itr->second);
 	TransactionEntry *t = itr->second;
+	unindex(t);
 	mTable.erase(itr);
 	delete t;
 }
@@ -973,6 +1012,163 @@ bool TransactionTable::removePaging(unsigned key)
 
 
 
+void TransactionJournalRecord::merge(const TransactionJournalRecord& change)
+{
+	if (change.mFields & Delete) {
+		// Nothing else matters once the row is going away.
+		*this = change;
+		return;
+	}
+	if (change.mFields & Insert) *this = change;
+	if (change.mFields & Channel) mChannel = change.mChannel;
+	if (change.mFields & GSMState) mGSMState = change.mGSMState;
+	if (change.mFields & SIPState) mSIPState = change.mSIPState;
+	if (change.mFields & Called) mCalled = change.mCalled;
+	if (change.mFields & L3TI) mL3TI = change.mL3TI;
+	if (change.mFields & (Channel|GSMState|SIPState)) mChanged = change.mChanged;
+	mFields |= change.mFields;
+}
+
+
+void TransactionTable::journal(unsigned ID, const TransactionJournalRecord& change)
+{
+	// Without a database there is no journal thread to drain the journal.
+	ScopedLock lock(mJournalLock);
+	if (!mDB) return;
+	TransactionJournal::iterator itr = mJournal.find(ID);
+	if (itr==mJournal.end()) {
+		mJournal[ID] = change;
+		return;
+	}
+	// A row inserted and deleted between flushes never reaches the database.
+	if ((change.mFields & TransactionJournalRecord::Delete) &&
+		(itr->second.mFields & TransactionJournalRecord::Insert)) {
+		mJournal.erase(itr);
+		return;
+	}
+	itr->second.merge(change);
+}
+
+
+/** Bind a string, or NULL for an empty or missing one. */
+static void bindText(sqlite3_stmt *stmt, int index, const char *text)
+{
+	if (text && text[0]) sqlite3_bind_text(stmt,index,text,-1,SQLITE_TRANSIENT);
+	else sqlite3_bind_null(stmt,index);
+}
+
+
+/** Run a bound statement and reset it for the next use. */
+static bool runStatement(sqlite3* DB, sqlite3_stmt *stmt)
+{
+	int src = sqlite3_run_query(DB,stmt);
+	sqlite3_reset(stmt);
+	sqlite3_clear_bindings(stmt);
+	return src==SQLITE_DONE;
+}
+
+
+bool TransactionTable::writeRecord(unsigned ID, const TransactionJournalRecord& record)
+{
+	// Caller holds mFlushLock.
+	typedef TransactionJournalRecord R;
+	if (record.mFields & R::Delete) {
+		sqlite3_bind_int64(mDeleteStmt,1,ID);
+		return runStatement(mDB,mDeleteStmt);
+	}
+	if (record.mFields & R::Insert) {
+		// Later changes are already merged into the inserted row.
+		sqlite3_bind_int64(mInsertStmt,1,ID);
+		sqlite3_bind_int64(mInsertStmt,2,record.mCreated);
+		sqlite3_bind_int64(mInsertStmt,3,record.mChanged);
+		sqlite3_bind_text(mInsertStmt,4,record.mType.c_str(),-1,SQLITE_TRANSIENT);
+		sqlite3_bind_text(mInsertStmt,5,record.mSubscriber.c_str(),-1,SQLITE_TRANSIENT);
+		sqlite3_bind_int64(mInsertStmt,6,record.mL3TI);
+		sqlite3_bind_text(mInsertStmt,7,record.mCalled.c_str(),-1,SQLITE_TRANSIENT);
+		sqlite3_bind_text(mInsertStmt,8,record.mCalling.c_str(),-1,SQLITE_TRANSIENT);
+		bindText(mInsertStmt,9,record.mGSMState);
+		bindText(mInsertStmt,10,record.mSIPState);
+		sqlite3_bind_text(mInsertStmt,11,record.mSIPCallID.c_str(),-1,SQLITE_TRANSIENT);
+		sqlite3_bind_text(mInsertStmt,12,record.mSIPProxy.c_str(),-1,SQLITE_TRANSIENT);
+		bindText(mInsertStmt,13,record.mChannel.c_str());
+		return runStatement(mDB,mInsertStmt);
+	}
+	bool ok = true;
+	if (record.mFields & R::Channel) {
+		bindText(mChannelStmt,1,record.mChannel.c_str());
+		sqlite3_bind_int64(mChannelStmt,2,record.mChanged);
+		sqlite3_bind_int64(mChannelStmt,3,ID);
+		ok = runStatement(mDB,mChannelStmt) && ok;
+	}
+	if (record.mFields & R::GSMState) {
+		bindText(mGSMStateStmt,1,record.mGSMState);
+		sqlite3_bind_int64(mGSMStateStmt,2,record.mChanged);
+		sqlite3_bind_int64(mGSMStateStmt,3,ID);
+		ok = runStatement(mDB,mGSMStateStmt) && ok;
+	}
+	if (record.mFields & R::SIPState) {
+		bindText(mSIPStateStmt,1,record.mSIPState);
+		sqlite3_bind_int64(mSIPStateStmt,2,record.mChanged);
+		sqlite3_bind_int64(mSIPStateStmt,3,ID);
+		ok = runStatement(mDB,mSIPStateStmt) && ok;
+	}
+	if (record.mFields & R::Called) {
+		sqlite3_bind_text(mCalledStmt,1,record.mCalled.c_str(),-1,SQLITE_TRANSIENT);
+		sqlite3_bind_int64(mCalledStmt,2,ID);
+		ok = runStatement(mDB,mCalledStmt) && ok;
+	}
+	if (record.mFields & R::L3TI) {
+		sqlite3_bind_int64(mL3TIStmt,1,record.mL3TI);
+		sqlite3_bind_int64(mL3TIStmt,2,ID);
+		ok = runStatement(mDB,mL3TIStmt) && ok;
+	}
+	return ok;
+}
+
+
+bool TransactionTable::flushJournal()
+{
+	ScopedLock flushLock(mFlushLock);
+	// mDB only goes away under mFlushLock, and journal() drops changes once it has.
+	if (!mDB) return false;
+	// Take the pending changes and let the call threads go on.
+	TransactionJournal pending;
+	mJournalLock.lock();
+	pending.swap(mJournal);
+	mJournalLock.unlock();
+	if (pending.empty()) return true;
+
+	if (!sqlite3_command(mDB,"BEGIN TRANSACTION")) {
+		LOG(ALERT) << "cannot begin transaction table update: " << sqlite3_errmsg(mDB);
+		return false;
+	}
+	bool ok = true;
+	for (TransactionJournal::const_iterator itr = pending.begin(); itr!=pending.end(); ++itr) {
+		if (writeRecord(itr->first,itr->second)) continue;
+		LOG(ALERT) << "transaction table update failed for transaction " << itr->first << ": " << sqlite3_errmsg(mDB);
+		ok = false;
+	}
+	if (!sqlite3_command(mDB,"COMMIT TRANSACTION")) {
+		LOG(ALERT) << "cannot commit transaction table update: " << sqlite3_errmsg(mDB);
+		sqlite3_command(mDB,"ROLLBACK TRANSACTION");
+		return false;
+	}
+	return ok;
+}
+
+
+void *Control::TransactionJournalLoopAdapter(TransactionTable *table)
+{
+	// External readers see the table at most this far behind.
+	const unsigned flushPeriod = 250000;	// microseconds
+	while (true) {
+		usleep(flushPeriod);
+		table->flushJournal();
+	}
+	return NULL;
+}
+
+
 void TransactionTable::clearDeadEntries()
 {
 	// Caller should hold mLock.
@@ -989,6 +1185,61 @@ void TransactionTable::clearDeadEntries()
 }
 
 
+void *Control::TransactionSweepLoopAdapter(TransactionTable *table)
+{
+	// Entries are not dead until they have been idle for many seconds,
+	// so a one-second sweep is plenty.
+	while (true) {
+		sleep(1);
+		ScopedLock lock(table->mLock);
+		table->clearDeadEntries();
+	}
+	return NULL;
+}
+
+
+
+
+void TransactionTable::index(TransactionEntry* entry)
+{
+	// The caller is the thread changing the entry, so its keys are stable here.
+	TransactionIndexKeys &keys = entry->mIndexKeys;
+	unsigned ID = entry->ID();
+	mSubscriberIndex[std::make_pair(entry->subscriber(),ID)] = entry;
+	keys.mChannel = entry->mChannel;
+	keys.mSACCH = entry->mChannel ? entry->mChannel->SACCH() : NULL;
+	keys.mCallID = entry->mSIP.callID();
+	keys.mRTPPort = entry->mSIP.RTPPort();
+	if (keys.mChannel) mChannelIndex[std::make_pair(keys.mChannel,ID)] = entry;
+	if (keys.mSACCH) mSACCHIndex[std::make_pair(keys.mSACCH,ID)] = entry;
+	if (keys.mCallID.size()) mCallIDIndex[std::make_pair(keys.mCallID,ID)] = entry;
+	if (keys.mRTPPort) mRTPPortIndex[std::make_pair(keys.mRTPPort,ID)] = entry;
+}
+
+
+void TransactionTable::unindex(TransactionEntry* entry)
+{
+	const TransactionIndexKeys &keys = entry->mIndexKeys;
+	unsigned ID = entry->ID();
+	mSubscriberIndex.erase(std::make_pair(entry->subscriber(),ID));
+	mChannelIndex.erase(std::make_pair(keys.mChannel,ID));
+	mSACCHIndex.erase(std::make_pair(keys.mSACCH,ID));
+	mCallIDIndex.erase(std::make_pair(keys.mCallID,ID));
+	mRTPPortIndex.erase(std::make_pair(keys.mRTPPort,ID));
+}
+
+
+void TransactionTable::reindex(TransactionEntry* entry)
+{
+	ScopedLock lock(mLock);
+	// Entries not yet added are indexed by add().
+	TransactionMap::iterator itr = mTable.find(entry->ID());
+	if (itr==mTable.end() || itr->second!=entry) return;
+	unindex(entry);
+	index(entry);
+}
+
+
 
 
 TransactionEntry* TransactionTable::find(const GSM::LogicalChannel *chan)
@@ -997,17 +1248,11 @@ TransactionEntry* TransactionTable::find(const GSM::LogicalChannel *chan)
 
 	ScopedLock lock(mLock);
 
-	// Yes, it's linear time.
-	// Since clearDeadEntries is also linear, do that here, too.
-	clearDeadEntries();
-
-	// Brute force search.
-	// This search assumes in order by transaction ID.
+	// The index is in order by transaction ID; the last live match wins.
 	TransactionEntry *retVal = NULL;
-	for (TransactionMap::iterator itr = mTable.begin(); itr!=mTable.end(); ++itr) {
+	ChannelIndex::iterator itr = mChannelIndex.lower_bound(std::make_pair(chan,0U));
+	for (; itr!=mChannelIndex.end() && itr->first.first==chan; ++itr) {
 		if (itr->second->deadOrRemoved()) continue;
-		const GSM::LogicalChannel* thisChan = itr->second->channel();
-		if ((void*)thisChan != (void*)chan) continue;
 		retVal = itr->second;
 	}
 	//LOG(DEBUG) << "no match for " << *chan << " (" << chan << ")";
@@ -1021,16 +1266,10 @@ TransactionEntry* TransactionTable::findBySACCH(const GSM::SACCHLogicalChannel *
 
 	ScopedLock lock(mLock);
 
-	// Yes, it's linear time.
-	// Since clearDeadEntries is also linear, do that here, too.
-	clearDeadEntries();
-
-	// Brute force search.
 	TransactionEntry *retVal = NULL;
-	for (TransactionMap::iterator itr = mTable.begin(); itr!=mTable.end(); ++itr) {
+	SACCHIndex::iterator itr = mSACCHIndex.lower_bound(std::make_pair(chan,0U));
+	for (; itr!=mSACCHIndex.end() && itr->first.first==chan; ++itr) {
 		if (itr->second->deadOrRemoved()) continue;
-		const GSM::LogicalChannel* thisChan = itr->second->channel();
-		if (thisChan->SACCH() != chan) continue;
 		retVal = itr->second;
 	}
 	return retVal;
@@ -1043,11 +1282,7 @@ TransactionEntry* TransactionTable::find(GSM::TypeAndOffset desc)
 
 	ScopedLock lock(mLock);
 
-	// Yes, it's linear time.
-	// Since clearDeadEntries is also linear, do that here, too.
-	clearDeadEntries();
-
-	// Brute force search.
+	// Yes, it's linear time, but only the CLI uses it.
 	for (TransactionMap::iterator itr = mTable.begin(); itr!=mTable.end(); ++itr) {
 		if (itr->second->deadOrRemoved()) continue;
 		const GSM::LogicalChannel* thisChan = itr->second->channel();
@@ -1065,15 +1300,10 @@ TransactionEntry* TransactionTable::find(const L3MobileIdentity& mobileID, GSM::
 
 	ScopedLock lock(mLock);
 
-	// Yes, it's linear time.
-	// Since clearDeadEntries is also linear, do that here, too.
-	clearDeadEntries();
-
-	// Brute force search.
-	for (TransactionMap::iterator itr = mTable.begin(); itr!=mTable.end(); ++itr) {
+	SubscriberIndex::iterator itr = mSubscriberIndex.lower_bound(std::make_pair(mobileID,0U));
+	for (; itr!=mSubscriberIndex.end() && itr->first.first==mobileID; ++itr) {
 		if (itr->second->deadOrRemoved()) continue;
 		if (itr->second->GSMState() != state) continue;
-		if (itr->second->subscriber() != mobileID) continue;
 		return itr->second;
 	}
 	return NULL;
@@ -1085,14 +1315,9 @@ bool TransactionTable::isBusy(const L3MobileIdentity& mobileID)
 
 	ScopedLock lock(mLock);
 
-	// Yes, it's linear time.
-	// Since clearDeadEntries is also linear, do that here, too.
-	clearDeadEntries();
-
-	// Brute force search.
-	for (TransactionMap::iterator itr = mTable.begin(); itr!=mTable.end(); ++itr) {
+	SubscriberIndex::iterator itr = mSubscriberIndex.lower_bound(std::make_pair(mobileID,0U));
+	for (; itr!=mSubscriberIndex.end() && itr->first.first==mobileID; ++itr) {
 		if (itr->second->deadOrRemoved()) continue;
-		if (itr->second->subscriber() != mobileID) continue;
 		GSM::L3CMServiceType service = itr->second->service();
 		bool speech =
 			service==GSM::L3CMServiceType::EmergencyCall ||
@@ -1127,15 +1352,10 @@ TransactionEntry* TransactionTable::find(const L3MobileIdentity& mobileID, const
 	LOG(DEBUG) << "by ID and call-ID: " << mobileID << ", call " << callID;
 
 	string callIDString = string(callID);
-	// Yes, it's linear time.
-	// Since clearDeadEntries is also linear, do that here, too.
-	clearDeadEntries();
-
-	// Brute force search.
 	ScopedLock lock(mLock);
-	for (TransactionMap::iterator itr = mTable.begin(); itr!=mTable.end(); ++itr) {
+	CallIDIndex::iterator itr = mCallIDIndex.lower_bound(std::make_pair(callIDString,0U));
+	for (; itr!=mCallIDIndex.end() && itr->first.first==callIDString; ++itr) {
 		if (itr->second->deadOrRemoved()) continue;
-		if (itr->second->mSIP.callID() != callIDString) continue;
 		if (itr->second->subscriber() != mobileID) continue;
 		return itr->second;
 	}
@@ -1147,15 +1367,10 @@ TransactionEntry* TransactionTable::find(const L3MobileIdentity& mobileID, unsig
 {
 	LOG(DEBUG) << "by ID and transaction-ID: " << mobileID << ", transaction " << transactionID;
 
-	// Yes, it's linear time.
-	// Since clearDeadEntries is also linear, do that here, too.
-	clearDeadEntries();
-
-	// Brute force search.
 	ScopedLock lock(mLock);
-	for (TransactionMap::iterator itr = mTable.begin(); itr!=mTable.end(); ++itr) {
+	SubscriberIndex::iterator itr = mSubscriberIndex.lower_bound(std::make_pair(mobileID,0U));
+	for (; itr!=mSubscriberIndex.end() && itr->first.first==mobileID; ++itr) {
 		if (itr->second->deadOrRemoved()) continue;
-		if (itr->second->subscriber() != mobileID) continue;
 		return itr->second;
 	}
 	return NULL;
@@ -1164,24 +1379,16 @@ TransactionEntry* TransactionTable::find(const L3MobileIdentity& mobileID, unsig
 
 TransactionEntry* TransactionTable::answeredPaging(const L3MobileIdentity& mobileID)
 {
-	// Yes, it's linear time.
-	// Even in a 6-ARFCN system, it should rarely be more than a dozen entries.
-
 	ScopedLock lock(mLock);
 
-	// Since clearDeadEntries is also linear, do that here, too.
-	clearDeadEntries();
-
-	// Brute force search.
-	for (TransactionMap::iterator itr = mTable.begin(); itr!=mTable.end(); ++itr) {
+	SubscriberIndex::iterator itr = mSubscriberIndex.lower_bound(std::make_pair(mobileID,0U));
+	for (; itr!=mSubscriberIndex.end() && itr->first.first==mobileID; ++itr) {
 		if (itr->second->deadOrRemoved()) continue;
 		if (itr->second->GSMState() != GSM::Paging) continue;
-		if (itr->second->subscriber() == mobileID) {
-			// Stop T3113 and change the state.
-			itr->second->GSMState(AnsweredPaging);
-			itr->second->resetTimer("3113");
-			return itr->second;
-		}
+		// Stop T3113 and change the state.
+		itr->second->GSMState(AnsweredPaging);
+		itr->second->resetTimer("3113");
+		return itr->second;
 	}
 	return NULL;
 }
@@ -1189,18 +1396,11 @@ TransactionEntry* TransactionTable::answeredPaging(const L3MobileIdentity& mobil
 
 GSM::LogicalChannel* TransactionTable::findChannel(const L3MobileIdentity& mobileID)
 {
-	// Yes, it's linear time.
-	// Even in a 6-ARFCN system, it should rarely be more than a dozen entries.
-
 	ScopedLock lock(mLock);
 
-	// Since clearDeadEntries is also linear, do that here, too.
-	clearDeadEntries();
-
-	// Brute force search.
-	for (TransactionMap::iterator itr = mTable.begin(); itr!=mTable.end(); ++itr) {
+	SubscriberIndex::iterator itr = mSubscriberIndex.lower_bound(std::make_pair(mobileID,0U));
+	for (; itr!=mSubscriberIndex.end() && itr->first.first==mobileID; ++itr) {
 		if (itr->second->deadOrRemoved()) continue;
-		if (itr->second->subscriber() != mobileID) continue;
 		GSM::LogicalChannel* chan = itr->second->channel();
 		if (!chan) continue;
 		if (chan->type() == FACCHType) return chan;
@@ -1213,11 +1413,11 @@ GSM::LogicalChannel* TransactionTable::findChannel(const L3MobileIdentity& mobil
 unsigned TransactionTable::countChan(const GSM::LogicalChannel* chan)
 {
 	ScopedLock lock(mLock);
-	clearDeadEntries();
 	unsigned count = 0;
-	for (TransactionMap::iterator itr = mTable.begin(); itr!=mTable.end(); ++itr) {
+	ChannelIndex::iterator itr = mChannelIndex.lower_bound(std::make_pair(chan,0U));
+	for (; itr!=mChannelIndex.end() && itr->first.first==chan; ++itr) {
 		if (itr->second->deadOrRemoved()) continue;
-		if (itr->second->channel() == chan) count++;
+		count++;
 	}
 	return count;
 }
@@ -1240,7 +1440,6 @@ size_t TransactionTable::dump(ostream& os, bool showAll) const
 TransactionEntry* TransactionTable::findLongestCall()
 {
 	ScopedLock lock(mLock);
-	clearDeadEntries();
 	long longTime = 0;
 	TransactionMap::iterator longCall = mTable.end();
 	for (TransactionMap::iterator itr = mTable.begin(); itr!=mTable.end(); ++itr) {
@@ -1258,20 +1457,14 @@ TransactionEntry* TransactionTable::findLongestCall()
 	return longCall->second;
 }
 
-/* linear, we should move the actual search into this structure */
 bool TransactionTable::RTPAvailable(short rtpPort)
 {
 	ScopedLock lock(mLock);
-	clearDeadEntries();
-	bool avail = true;
-	for (TransactionMap::iterator itr = mTable.begin(); itr!=mTable.end(); ++itr) {
-		if (itr->second->deadOrRemoved()) continue;
-		if (itr->second->mSIP.RTPPort() == rtpPort){
-			avail = false;
-			break;
-		}
+	RTPPortIndex::iterator itr = mRTPPortIndex.lower_bound(std::make_pair(rtpPort,0U));
+	for (; itr!=mRTPPortIndex.end() && itr->first.first==rtpPort; ++itr) {
+		if (!itr->second->deadOrRemoved()) return false;
 	}
-	return avail;
+	return true;
 }
 
 bool TransactionTable::duplicateMessage(const GSM::L3MobileIdentity& mobileID, const std::string& wMessage)
@@ -1279,13 +1472,9 @@ bool TransactionTable::duplicateMessage(const GSM::L3MobileIdentity& mobileID, c
 
 	ScopedLock lock(mLock);
 
-	// Since clearDeadEntries is also linear, do that here, too.
-	clearDeadEntries();
-
-	// Brute force search.
-	for (TransactionMap::const_iterator itr = mTable.begin(); itr!=mTable.end(); ++itr) {
+	SubscriberIndex::iterator itr = mSubscriberIndex.lower_bound(std::make_pair(mobileID,0U));
+	for (; itr!=mSubscriberIndex.end() && itr->first.first==mobileID; ++itr) {
 		if (itr->second->deadOrRemoved()) continue;
-		if (itr->second->subscriber() != mobileID) continue;
 		if (itr->second->message() == wMessage) return true;
 	}
 	return false;
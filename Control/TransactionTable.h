@@ -46,6 +46,7 @@ class SACCHLogicalChannel;
 
 
 struct sqlite3;
+struct sqlite3_stmt;
 
 
 /**@namespace Control This namepace is for use by the control layer. */
@@ -54,6 +55,61 @@ namespace Control {
 typedef std::map<std::string, GSM::Z100Timer> TimerTable;
 
 
+/**
+	A pending change to one row of the transaction table database.
+	Changes to the same transaction are merged until the next flush.
+*/
+struct TransactionJournalRecord {
+
+	/** Bits of mFields, naming the columns that are set. */
+	enum Field {
+		Insert = 0x01,		///< a new row; all columns are set
+		Channel = 0x02,
+		GSMState = 0x04,
+		SIPState = 0x08,
+		Called = 0x10,
+		L3TI = 0x20,
+		Delete = 0x40		///< remove the row; nothing else is set
+	};
+
+	unsigned mFields;				///< the Field bits that are set
+	unsigned mCreated;				///< CREATED, for Insert
+	unsigned mChanged;				///< CHANGED, for Insert, Channel, GSMState and SIPState
+	std::string mType;				///< TYPE, for Insert
+	std::string mSubscriber;		///< SUBSCRIBER, for Insert
+	std::string mCalling;			///< CALLING, for Insert
+	std::string mSIPCallID;			///< SIP_CALLID, for Insert
+	std::string mSIPProxy;			///< SIP_PROXY, for Insert
+	std::string mChannel;			///< CHANNEL, empty for NULL
+	std::string mCalled;			///< CALLED
+	const char* mGSMState;			///< GSMSTATE, a static string
+	const char* mSIPState;			///< SIPSTATE, a static string
+	unsigned mL3TI;					///< L3TI
+
+	TransactionJournalRecord(unsigned wFields=0)
+		:mFields(wFields),mCreated(0),mChanged(0),
+		mGSMState(NULL),mSIPState(NULL),mL3TI(0)
+	{ }
+
+	/** Fold a later change into this one. */
+	void merge(const TransactionJournalRecord& change);
+};
+
+
+/** The keys under which a TransactionTable currently indexes an entry. */
+struct TransactionIndexKeys {
+
+	const GSM::LogicalChannel* mChannel;		///< key in the channel index, or NULL
+	const GSM::SACCHLogicalChannel* mSACCH;		///< key in the SACCH index, or NULL
+	std::string mCallID;						///< key in the call ID index, or empty
+	short mRTPPort;								///< key in the RTP port index, or zero
+
+	TransactionIndexKeys()
+		:mChannel(NULL),mSACCH(NULL),mRTPPort(0)
+	{ }
+};
+
+
 
 
 /**
@@ -90,8 +146,6 @@ class TransactionEntry {
 	Timeval mStateTimer;					///< timestamp of last state change.
 	TimerTable mTimers;						///< table of Z100-type state timers
 
-	unsigned mNumSQLTries;					///< number of SQL tries for DB operations
-
 	GSM::LogicalChannel *mChannel;			///< current channel of the transaction
 
 	bool mTerminationRequested;
@@ -100,6 +154,8 @@ class TransactionEntry {
 
 	bool mFake;					///true if this is a fake message generated internally	
 
+	TransactionIndexKeys mIndexKeys;	///< where gTransactionTable has this entry indexed, protected by the table lock
+
 	public:
 
 	/** This form is used for MTC or MT-SMS with TI generated by the network. */
@@ -237,7 +293,7 @@ class TransactionEntry {
 	bool startDTMF(char key) { ScopedLock lock(mLock); return mSIP.startDTMF(key); }
 	void stopDTMF() { ScopedLock lock(mLock); mSIP.stopDTMF(); }
 
-	void SIPUser(const std::string& IMSI) { ScopedLock lock(mLock); SIPUser(IMSI.c_str()); }
+	void SIPUser(const std::string& IMSI) { SIPUser(IMSI.c_str()); }
 	void SIPUser(const char* IMSI);
 	void SIPUser(const char* callID, const char *IMSI , const char *origID, const char *origHost);
 
@@ -297,8 +353,8 @@ class TransactionEntry {
 	/** Set up a new entry in gTransactionTable's sqlite3 database. */
 	void insertIntoDatabase();
 
-	/** Run a database query. */
-	void runQuery(const char* query) const;
+	/** Queue a change to this entry's database row. */
+	void journal(const TransactionJournalRecord& change) const;
 
 	/** Echo latest SIPSTATE to the database. */
 	SIP::SIPState echoSIPState(SIP::SIPState state) const;
@@ -317,6 +373,18 @@ std::ostream& operator<<(std::ostream& os, const TransactionEntry&);
 /** A map of transactions keyed by ID. */
 class TransactionMap : public std::map<unsigned,TransactionEntry*> {};
 
+/** Pending database changes keyed by transaction ID. */
+typedef std::map<unsigned,TransactionJournalRecord> TransactionJournal;
+
+/**@name Secondary indexes of the transaction table, keyed by (key,ID) so entries with the same key stay in ID order. */
+//@{
+typedef std::map<std::pair<GSM::L3MobileIdentity,unsigned>,TransactionEntry*> SubscriberIndex;
+typedef std::map<std::pair<std::string,unsigned>,TransactionEntry*> CallIDIndex;
+typedef std::map<std::pair<const GSM::LogicalChannel*,unsigned>,TransactionEntry*> ChannelIndex;
+typedef std::map<std::pair<const GSM::SACCHLogicalChannel*,unsigned>,TransactionEntry*> SACCHIndex;
+typedef std::map<std::pair<short,unsigned>,TransactionEntry*> RTPPortIndex;
+//@}
+
 /**
 	A table for tracking the states of active transactions.
 */
@@ -330,6 +398,32 @@ class TransactionTable {
 	mutable Mutex mLock;
 	unsigned mIDCounter;
 
+	/**@name Secondary indexes, protected by mLock. */
+	//@{
+	SubscriberIndex mSubscriberIndex;
+	CallIDIndex mCallIDIndex;
+	ChannelIndex mChannelIndex;
+	SACCHIndex mSACCHIndex;
+	RTPPortIndex mRTPPortIndex;
+	//@}
+
+	Thread mSweepThread;	///< removes dead entries in the background
+
+	/**@name Write-behind of the database mirror. */
+	//@{
+	TransactionJournal mJournal;	///< changes not yet written
+	Mutex mJournalLock;				///< protects mJournal; taken last, after any entry lock
+	Mutex mFlushLock;				///< serializes flushes, protects the statements and the closing of mDB
+	Thread mJournalThread;			///< writes mJournal to the database
+	sqlite3_stmt *mInsertStmt;
+	sqlite3_stmt *mDeleteStmt;
+	sqlite3_stmt *mChannelStmt;
+	sqlite3_stmt *mGSMStateStmt;
+	sqlite3_stmt *mSIPStateStmt;
+	sqlite3_stmt *mCalledStmt;
+	sqlite3_stmt *mL3TIStmt;
+	//@}
+
 	public:
 
 	/**
@@ -392,7 +486,6 @@ class TransactionTable {
 
 	/**
 		Find an entry by its channel pointer; returns first entry found.
-		Also clears dead entries during search.
 		@param chan The channel pointer.
 		@return pointer to entry or NULL if no active match
 	*/
@@ -400,7 +493,6 @@ class TransactionTable {
 
 	/**
 		Find an entry by its SACCH channel pointer; returns first entry found.
-		Also clears dead entries during search.
 		@param chan The channel pointer.
 		@return pointer to entry or NULL if no active match
 	*/
@@ -408,7 +500,6 @@ class TransactionTable {
 
 	/**
 		Find an entry by its channel type and offset.
-		Also clears dead entries during search.
 		@param chan The channel pointer to the first record found.
 		@return pointer to entry or NULL if no active match
 	*/
@@ -416,7 +507,6 @@ class TransactionTable {
 
 	/**
 		Find an entry in the given state by its mobile ID.
-		Also clears dead entries during search.
 		@param mobileID The mobile to search for.
 		@return pointer to entry or NULL if no match
 	*/
@@ -437,7 +527,6 @@ class TransactionTable {
 
 	/**
 		Find an entry in the Paging state by its mobile ID, change state to AnsweredPaging and reset T3113.
-		Also clears dead entries during search.
 		@param mobileID The mobile to search for.
 		@return pointer to entry or NULL if no match
 	*/
@@ -458,6 +547,12 @@ class TransactionTable {
 
 	size_t dump(std::ostream& os, bool showAll=false) const;
 
+	/**
+		Write all pending changes to the database in one transaction.
+		@return false on a database error.
+	*/
+	bool flushJournal();
+
 	private:
 
 	friend class TransactionEntry;
@@ -472,15 +567,44 @@ class TransactionTable {
 	*/
 	void clearDeadEntries();
 
+	/**@name Index maintenance; the caller should hold mLock. */
+	//@{
+	/** Add an entry to the secondary indexes under its current keys. */
+	void index(TransactionEntry*);
+	/** Remove an entry from the secondary indexes. */
+	void unindex(TransactionEntry*);
+	//@}
+
+	/**
+		Update the indexes after a change to the channel, call ID or RTP port of an entry.
+		The caller should not hold the entry lock.
+	*/
+	void reindex(TransactionEntry*);
+
+	/** Merge a change to a row into the journal. */
+	void journal(unsigned ID, const TransactionJournalRecord& change);
+
+	/** Write one journal record; the caller holds mFlushLock. */
+	bool writeRecord(unsigned ID, const TransactionJournalRecord& record);
+
 	/**
 		Remove and entry from the table and from gSIPInterface.
 	*/
 	void innerRemove(TransactionMap::iterator);
 
+	friend void *TransactionSweepLoopAdapter(TransactionTable*);
+	friend void *TransactionJournalLoopAdapter(TransactionTable*);
 
 };
 
 
+/** Remove dead entries from the table periodically. */
+void *TransactionSweepLoopAdapter(TransactionTable*);
+
+/** Flush the journal to the database periodically. */
+void *TransactionJournalLoopAdapter(TransactionTable*);
+
+
 
 
 
@@ -187,6 +187,90 @@ const unsigned GSM::RACHWaitSParam[16] =
 	55
 };
 
+// See GSM 05.03 4.1.4.
+// c[k] goes to i[B][j] with B=k%4 and j=2*((49*k)%57)+((k%8)/4).
+const unsigned GSM::gXCCHInterleave[4][114] =
+{
+	{
+		0,228,64,292,128,356,192,420,256,28,320,92,384,156,448,220,56,284,120,
+		348,184,412,248,20,312,84,376,148,440,212,48,276,112,340,176,404,240,12,
+		304,76,368,140,432,204,40,268,104,332,168,396,232,4,296,68,360,132,424,
+		196,32,260,96,324,160,388,224,452,288,60,352,124,416,188,24,252,88,316,
+		152,380,216,444,280,52,344,116,408,180,16,244,80,308,144,372,208,436,272,
+		44,336,108,400,172,8,236,72,300,136,364,200,428,264,36,328,100,392,164
+	},
+	{
+		57,285,121,349,185,413,249,21,313,85,377,149,441,213,49,277,113,341,177,
+		405,241,13,305,77,369,141,433,205,41,269,105,333,169,397,233,5,297,69,
+		361,133,425,197,33,261,97,325,161,389,225,453,289,61,353,125,417,189,25,
+		253,89,317,153,381,217,445,281,53,345,117,409,181,17,245,81,309,145,373,
+		209,437,273,45,337,109,401,173,9,237,73,301,137,365,201,429,265,37,329,
+		101,393,165,1,229,65,293,129,357,193,421,257,29,321,93,385,157,449,221
+	},
+	{
+		114,342,178,406,242,14,306,78,370,142,434,206,42,270,106,334,170,398,234,
+		6,298,70,362,134,426,198,34,262,98,326,162,390,226,454,290,62,354,126,
+		418,190,26,254,90,318,154,382,218,446,282,54,346,118,410,182,18,246,82,
+		310,146,374,210,438,274,46,338,110,402,174,10,238,74,302,138,366,202,430,
+		266,38,330,102,394,166,2,230,66,294,130,358,194,422,258,30,322,94,386,
+		158,450,222,58,286,122,350,186,414,250,22,314,86,378,150,442,214,50,278
+	},
+	{
+		171,399,235,7,299,71,363,135,427,199,35,263,99,327,163,391,227,455,291,
+		63,355,127,419,191,27,255,91,319,155,383,219,447,283,55,347,119,411,183,
+		19,247,83,311,147,375,211,439,275,47,339,111,403,175,11,239,75,303,139,
+		367,203,431,267,39,331,103,395,167,3,231,67,295,131,359,195,423,259,31,
+		323,95,387,159,451,223,59,287,123,351,187,415,251,23,315,87,379,151,443,
+		215,51,279,115,343,179,407,243,15,307,79,371,143,435,207,43,271,107,335
+	}
+};
+
+// See GSM 05.03 3.1.3.
+// c[k] goes to half-burst r=k%8, bit n=(49*k)%57.
+const unsigned GSM::gTCHInterleave[8][57] =
+{
+	{
+		0,64,128,192,256,320,384,448,56,120,184,248,312,376,440,48,112,176,240,
+		304,368,432,40,104,168,232,296,360,424,32,96,160,224,288,352,416,24,88,
+		152,216,280,344,408,16,80,144,208,272,336,400,8,72,136,200,264,328,392
+	},
+	{
+		57,121,185,249,313,377,441,49,113,177,241,305,369,433,41,105,169,233,297,
+		361,425,33,97,161,225,289,353,417,25,89,153,217,281,345,409,17,81,145,
+		209,273,337,401,9,73,137,201,265,329,393,1,65,129,193,257,321,385,449
+	},
+	{
+		114,178,242,306,370,434,42,106,170,234,298,362,426,34,98,162,226,290,354,
+		418,26,90,154,218,282,346,410,18,82,146,210,274,338,402,10,74,138,202,
+		266,330,394,2,66,130,194,258,322,386,450,58,122,186,250,314,378,442,50
+	},
+	{
+		171,235,299,363,427,35,99,163,227,291,355,419,27,91,155,219,283,347,411,
+		19,83,147,211,275,339,403,11,75,139,203,267,331,395,3,67,131,195,259,
+		323,387,451,59,123,187,251,315,379,443,51,115,179,243,307,371,435,43,107
+	},
+	{
+		228,292,356,420,28,92,156,220,284,348,412,20,84,148,212,276,340,404,12,
+		76,140,204,268,332,396,4,68,132,196,260,324,388,452,60,124,188,252,316,
+		380,444,52,116,180,244,308,372,436,44,108,172,236,300,364,428,36,100,164
+	},
+	{
+		285,349,413,21,85,149,213,277,341,405,13,77,141,205,269,333,397,5,69,
+		133,197,261,325,389,453,61,125,189,253,317,381,445,53,117,181,245,309,373,
+		437,45,109,173,237,301,365,429,37,101,165,229,293,357,421,29,93,157,221
+	},
+	{
+		342,406,14,78,142,206,270,334,398,6,70,134,198,262,326,390,454,62,126,
+		190,254,318,382,446,54,118,182,246,310,374,438,46,110,174,238,302,366,430,
+		38,102,166,230,294,358,422,30,94,158,222,286,350,414,22,86,150,214,278
+	},
+	{
+		399,7,71,135,199,263,327,391,455,63,127,191,255,319,383,447,55,119,183,
+		247,311,375,439,47,111,175,239,303,367,431,39,103,167,231,295,359,423,31,
+		95,159,223,287,351,415,23,87,151,215,279,343,407,15,79,143,207,271,335
+	}
+};
+
 
 
 
@@ -254,6 +338,16 @@ void Clock::wait(const Time& when) const
 }
 
 
+Timeval Clock::systime(const Time& when) const
+{
+	mLock.lock();
+	int64_t elapsedUSec = (int64_t)FNDelta(when.FN(),mBaseFN) * gFrameMicroseconds;
+	int64_t usec = 1000000LL*mBaseTime.sec() + mBaseTime.usec() + elapsedUSec;
+	mLock.unlock();
+	return Timeval(usec/1000000,usec%1000000);
+}
+
+
 
 
 
@@ -323,6 +323,22 @@ extern const unsigned RACHWaitSParam[];
 //@}
 
 
+/**@name Interleaver permutations, GSM 05.03 3.1.3 and 4.1.4, as gather tables. */
+//@{
+/**
+	xCCH block interleaver, 4.1.4.
+	gXCCHInterleave[B][j] is the index k in c[] of bit i[B][j].
+*/
+extern const unsigned gXCCHInterleave[4][114];
+/**
+	TCH/FS and FACCH/F block diagonal interleaver, 3.1.3.
+	Bits of c[] with k%8==r fill half a burst, all even or all odd positions.
+	gTCHInterleave[r][n] is the index k in c[] of bit i[(r+offset)%8][2*n+r/4].
+*/
+extern const unsigned gTCHInterleave[8][57];
+//@}
+
+
 
 
 /**@name Modulus operations for frame numbers. */
@@ -547,6 +563,9 @@ class Clock {
 
 	/** Block until the clock passes a given time. */
 	void wait(const Time&) const;
+
+	/** The system time at which the clock reaches a given frame. */
+	Timeval systime(const Time&) const;
 };
 
 
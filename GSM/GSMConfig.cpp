@@ -49,6 +49,7 @@ void GSMConfig::init()
 	mBand = (GSMBand)gConfig.getNum("GSM.Radio.Band");
 	mT3122 = gConfig.getNum("GSM.Timer.T3122Min");
 	regenerateBeacon();
+	mScheduler.start(gConfig.getNum("GSM.L1.Workers",2));
 }
 
 void GSMConfig::start()
@@ -193,7 +194,8 @@ TCHFACCHLogicalChannel *GSMConfig::getTCH()
 	TCHFACCHLogicalChannel *chan = getChan<TCHFACCHLogicalChannel>(mTCHPool);
 	if (chan) {
 	    chan->open();
-	    gReports.incr("OpenBTS.GSM.RR.ChannelAssignment");
+	    static ReportingHandle assignments = gReports.handle("OpenBTS.GSM.RR.ChannelAssignment");
+	    gReports.incr(assignments);
 	}
 	return chan;
 }
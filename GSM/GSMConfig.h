@@ -39,6 +39,7 @@
 #include "GSML3RRMessages.h"
 
 #include "TRXManager.h"
+#include "GSML1Scheduler.h"
 
 
 namespace GSM {
@@ -90,6 +91,8 @@ class GSMConfig {
 
 	Clock mClock;		///< local copy of BTS master clock
 
+	L1Scheduler mScheduler;		///< worker pool for the clock-driven L1 encoders
+
 	/**@name Encoded L2 frames to be sent on the BCCH. */
 	//@{
 	L2Frame mSI1Frame;
@@ -150,6 +153,7 @@ class GSMConfig {
 	unsigned BCC() const { return mBCC; }
 	unsigned NCC() const { return mNCC; }
 	GSM::Clock& clock() { return mClock; }
+	L1Scheduler& scheduler() { return mScheduler; }
 	const L3LocationAreaIdentity& LAI() const { return mLAI; }
 	//@}
 
@@ -606,15 +606,13 @@ bool XCCHL1Decoder::processBurst(const RxBurst& inBurst)
 void XCCHL1Decoder::deinterleave()
 {
 	// Deinterleave i[][] to c[].
-	// This comes directly from GSM 05.03, 4.1.4.
-	for (int k=0; k<456; k++) {
-		int B = k%4;
-		int j = 2*((49*k) % 57) + ((k%8)/4);
-		mC[k] = mI[B][j];
-		// Mark this i[][] bit as unknown now.
+	// This comes directly from GSM 05.03, 4.1.4, through the table in GSMCommon.
+	for (int B=0; B<4; B++) {
+		mI[B].unmap(gXCCHInterleave[B],114,mC);
+		// Mark the i[][] bits as unknown now.
 		// This makes it possible for the soft decoder to work around
 		// a missing burst.
-		mI[B][j] = 0.5F;
+		mI[B].unknown();
 	}
 }
 
@@ -855,12 +853,8 @@ void XCCHL1Encoder::encode()
 
 void XCCHL1Encoder::interleave()
 {
-	// GSM 05.03, 4.1.4.  Verbatim.
-	for (int k=0; k<456; k++) {
-		int B = k%4;
-		int j = 2*((49*k) % 57) + ((k%8)/4);
-		mI[B][j] = mC[k];
-	}
+	// GSM 05.03, 4.1.4, through the table in GSMCommon.
+	for (int B=0; B<4; B++) mC.map(gXCCHInterleave[B],114,mI[B]);
 }
 
 
@@ -897,25 +891,15 @@ void XCCHL1Encoder::transmit()
 void GeneratorL1Encoder::start()
 {
 	L1Encoder::start();
-	mSendThread.start((void*(*)(void*))GeneratorL1EncoderServiceLoopAdapter,(void*)this);
+	gBTS.scheduler().add(this);
 }
 
 
-
-void *GSM::GeneratorL1EncoderServiceLoopAdapter(GeneratorL1Encoder* gen)
-{
-	gen->serviceLoop();
-	// DONTREACH
-	return NULL;
-}
-
-void GeneratorL1Encoder::serviceLoop()
+void GeneratorL1Encoder::serviceFrame()
 {
-	while (mRunning) {
-		resync();
-		waitToSend();
-		generate();
-	}
+	// The scheduler has already waited for the previous burst.
+	resync();
+	generate();
 }
 
 
@@ -986,7 +970,7 @@ void FCCHL1Encoder::generate()
 		mDownstream->writeHighSide(mBurst);
 		rollForward();
 	}
-	sleep(1);
+	// The scheduler waits about a second before the next call.
 }
 
 
@@ -995,23 +979,7 @@ void FCCHL1Encoder::generate()
 void NDCCHL1Encoder::start()
 {
 	L1Encoder::start();
-	mSendThread.start((void*(*)(void*))NDCCHL1EncoderServiceLoopAdapter,(void*)this);
-}
-
-
-
-void *GSM::NDCCHL1EncoderServiceLoopAdapter(NDCCHL1Encoder* gen)
-{
-	gen->serviceLoop();
-	// DONTREACH
-	return NULL;
-}
-
-void NDCCHL1Encoder::serviceLoop()
-{
-	while (mRunning) {
-		generate();
-	}
+	gBTS.scheduler().add(this);
 }
 
 
@@ -1141,11 +1109,16 @@ bool TCHFACCHL1Decoder::processBurst( const RxBurst& inBurst)
 void TCHFACCHL1Decoder::deinterleave(int blockOffset )
 {
 	OBJLOG(DEBUG) <<"TCHFACCHL1Decoder blockOffset=" << blockOffset;
-	for (int k=0; k<456; k++) {
-		int B = ( k + blockOffset ) % 8;
-		int j = 2*((49*k) % 57) + ((k%8)/4);
-		mC[k] = mI[B][j];
-		mI[B][j] = 0.5F;
+	// GSM 05.03, 3.1.3, through the table in GSMCommon.
+	// Each k%8 fills the even or odd half of one burst.
+	float *cp = mC.begin();
+	for (int r=0; r<8; r++) {
+		const unsigned *kp = gTCHInterleave[r];
+		float *ip = mI[(r+blockOffset)%8].begin() + r/4;
+		for (int n=0; n<57; n++) {
+			cp[kp[n]] = ip[2*n];
+			ip[2*n] = 0.5F;
+		}
 	}
 }
 
@@ -1235,16 +1208,6 @@ bool TCHFACCHL1Decoder::decodeTCH(bool stolen)
 
 
 
-void GSM::TCHFACCHL1EncoderRoutine( TCHFACCHL1Encoder * encoder )
-{
-	while (1) {
-		encoder->dispatch();
-	}
-}
-
-
-
-
 TCHFACCHL1Encoder::TCHFACCHL1Encoder(
 	unsigned wCN,
 	unsigned wTN,
@@ -1270,7 +1233,15 @@ void TCHFACCHL1Encoder::start()
 {
 	L1Encoder::start();
 	OBJLOG(DEBUG) <<"TCHFACCHL1Encoder";
-	mEncoderThread.start((void*(*)(void*))TCHFACCHL1EncoderRoutine,(void*)this);
+	gBTS.scheduler().add(this);
+}
+
+
+Time TCHFACCHL1Encoder::serviceTime() const
+{
+	// While the channel is idle, dispatch() just steps through multiframes.
+	if (!active()) return mNextWriteTime;
+	return mPrevWriteTime;
 }
 
 
@@ -1338,18 +1309,17 @@ void TCHFACCHL1Encoder::dispatch()
 	// Get right with the system clock.
 	resync();
 
-	// If the channel is not active, wait for a multiframe and return.
+	// If the channel is not active, skip a multiframe and return.
+	// The scheduler calls again at serviceTime().
 	// Most channels do not need this, becuase they are entirely data-driven
 	// from above.  TCH/FACCH, however, must feed the interleaver on time.
 	if (!active()) {
 		mNextWriteTime += 26;
-		gBTS.clock().wait(mNextWriteTime);
 		return;
 	}
 
-	// Let previous data get transmitted.
+	// The scheduler has already let previous data get transmitted.
 	resync();
-	waitToSend();
 	
 	// flag to control stealing bits
 	bool currentFACCH = false; 
@@ -1421,11 +1391,13 @@ void TCHFACCHL1Encoder::dispatch()
 
 void TCHFACCHL1Encoder::interleave(int blockOffset)
 {
-	// GSM 05.03, 3.1.3
-	for (int k=0; k<456; k++) {
-		int B = ( k + blockOffset ) % 8;
-		int j = 2*((49*k) % 57) + ((k%8)/4);
-		mI[B][j] = mC[k];
+	// GSM 05.03, 3.1.3, through the table in GSMCommon.
+	// Each k%8 fills the even or odd half of one burst.
+	const char *cp = mC.begin();
+	for (int r=0; r<8; r++) {
+		const unsigned *kp = gTCHInterleave[r];
+		char *ip = mI[(r+blockOffset)%8].begin() + r/4;
+		for (int n=0; n<57; n++) ip[2*n] = cp[kp[n]];
 	}
 }
 
@@ -172,6 +172,16 @@ class L1Encoder {
 	/** Start the service loop thread, if there is one.  */
 	virtual void start() { mRunning=true; }
 
+	/**
+		Do the work due at serviceTime() without blocking.
+		Called by the L1Scheduler for clock-driven encoders,
+		which add themselves to it in start().
+	*/
+	virtual void serviceFrame() {}
+
+	/** The time at which the L1Scheduler should next call serviceFrame(). */
+	virtual Time serviceTime() const { return mPrevWriteTime; }
+
 	const char* descriptiveString() const { return mDescriptiveString; }
 
 	protected:
@@ -725,9 +735,6 @@ private:
 
 	L2FrameFIFO mL2Q;				///< input queue for L2 FACCH frames
 
-	Thread mEncoderThread;
-	friend void TCHFACCHL1EncoderRoutine( TCHFACCHL1Encoder * encoder );	
-
 public:
 
 	TCHFACCHL1Encoder(unsigned wCN, unsigned wTN, 
@@ -750,13 +757,18 @@ protected:
 	void sendFrame(const L2Frame&);
 
 	/**
-		dispatch called in a while loop.
+		dispatch called from the L1Scheduler at each serviceTime().
 		process reading transcoder and fifo to 
 		interleave and send.
 	*/
 	void dispatch();
 
-	/** Will start the dispatch thread. */
+	void serviceFrame() { dispatch(); }
+
+	/** The last burst sent, or the next block time while the channel is idle. */
+	Time serviceTime() const;
+
+	/** Will add the encoder to the L1Scheduler. */
 	void start();
 
 	/** Encode a vocoder frame into c[]. */
@@ -765,9 +777,6 @@ protected:
 };
 
 
-/** The C adapter for pthreads. */
-void TCHFACCHL1EncoderRoutine( TCHFACCHL1Encoder * encoder );
-
 /** L1 decoder used for full rate TCH and FACCH -- mostly from GSM 05.03 3.1 and 4.2 */
 class TCHFACCHL1Decoder : public XCCHL1Decoder {
 
@@ -839,10 +848,6 @@ class TCHFACCHL1Decoder : public XCCHL1Decoder {
 */
 class GeneratorL1Encoder : public L1Encoder {
 
-	private:
-
-	Thread mSendThread;
-
 	public:
 
 	GeneratorL1Encoder(	
@@ -853,25 +858,20 @@ class GeneratorL1Encoder : public L1Encoder {
 		:L1Encoder(wCN,wTN,wMapping,wParent)
 	{ }
 
+	/** Add the encoder to the L1Scheduler. */
 	void start();
 
+	/** The L1Scheduler calls generate at each serviceTime(). */
+	void serviceFrame();
+
 	protected: 
 
 	/** The generate method actually produces output bursts. */
 	virtual void generate() =0;
 
-	/** The core service loop calls generate repeatedly. */
-	void serviceLoop();
-
-	/** Provide a C interface for pthreads. */
-	friend void *GeneratorL1EncoderServiceLoopAdapter(GeneratorL1Encoder*);
-
 };
 
 
-void *GeneratorL1EncoderServiceLoopAdapter(GeneratorL1Encoder*);
-
-
 /**
 	The L1 encoder for the sync channel (SCH).
 	The SCH sends out an encoding of the current BTS clock.
@@ -913,6 +913,12 @@ class FCCHL1Encoder : public GeneratorL1Encoder {
 
 	FCCHL1Encoder(L1FEC *wParent);
 
+	/**
+		Refresh about once a second.
+		The radio repeats C0 bursts in between.
+	*/
+	Time serviceTime() const { return mPrevWriteTime + 217; }
+
 	protected:
 
 	void generate();
@@ -927,10 +933,6 @@ class FCCHL1Encoder : public GeneratorL1Encoder {
 */
 class NDCCHL1Encoder : public XCCHL1Encoder {
 
-	protected:
-
-	Thread mSendThread;
-
 	public:
 
 
@@ -942,20 +944,17 @@ class NDCCHL1Encoder : public XCCHL1Encoder {
 		:XCCHL1Encoder(wCN, wTN, wMapping, wParent)
 	{ }
 
+	/** Add the encoder to the L1Scheduler. */
 	void start();
 
+	/** The L1Scheduler calls generate at each serviceTime(). */
+	void serviceFrame() { generate(); }
+
 	protected:
 
 	virtual void generate() =0;
-
-	/** The core service loop. */
-	void serviceLoop();
-
-	friend void *NDCCHL1EncoderServiceLoopAdapter(NDCCHL1Encoder*);
 };
 
-void *NDCCHL1EncoderServiceLoopAdapter(NDCCHL1Encoder*);
-
 
 
 /**
@@ -0,0 +1,144 @@
+/*
+* Copyright 2011 Range Networks, Inc.
+*
+* This software is distributed under the terms of the GNU Affero Public License.
+* See the COPYING file in the main directory for details.
+*
+* This use of this software may be subject to additional restrictions.
+* See the LEGAL file in the main directory for details.
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU Affero General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU Affero General Public License for more details.
+
+	You should have received a copy of the GNU Affero General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+#include "GSML1Scheduler.h"
+#include "GSML1FEC.h"
+#include "GSMConfig.h"
+
+#include <Logger.h>
+
+
+using namespace std;
+using namespace GSM;
+
+
+/** Microseconds from one system time to another, b-a. */
+static long deltaUSec(const Timeval& a, const Timeval& b)
+{
+	return 1000000L*((long)b.sec()-(long)a.sec()) + ((long)b.usec()-(long)a.usec());
+}
+
+
+void L1Scheduler::start(unsigned wNumWorkers)
+{
+	assert(mWorkers==NULL);
+	if (wNumWorkers<1) wNumWorkers=1;
+	mNumWorkers = wNumWorkers;
+	LOG(INFO) << "starting " << mNumWorkers << " L1 scheduler workers";
+	mWorkers = new Thread[mNumWorkers];
+	for (unsigned i=0; i<mNumWorkers; i++) {
+		mWorkers[i].start((void*(*)(void*))L1SchedulerServiceLoopAdapter,this);
+	}
+}
+
+
+void L1Scheduler::add(L1Encoder* encoder)
+{
+	ScopedLock lock(mLock);
+	mNumJobs++;
+	schedule(encoder,Timeval());
+}
+
+
+unsigned L1Scheduler::size() const
+{
+	ScopedLock lock(mLock);
+	return mNumJobs;
+}
+
+
+void L1Scheduler::schedule(L1Encoder* encoder, const Timeval& deadline)
+{
+	// Caller holds mLock.
+	Job job;
+	job.deadline = deadline;
+	job.encoder = encoder;
+	bool earliest = mJobs.empty() || Later()(mJobs.top(),job);
+	mJobs.push(job);
+	if (earliest) mWakeup.signal();
+}
+
+
+void L1Scheduler::serviceLoop()
+{
+	mLock.lock();
+	while (true) {
+		if (mJobs.empty()) {
+			mWakeup.wait(mLock);
+			continue;
+		}
+		Job job = mJobs.top();
+		Timeval now;
+		long lateness = deltaUSec(job.deadline,now);
+		if (lateness<0) {
+			// Sleep to the earliest deadline, or until an earlier one is queued.
+			mWakeup.wait(mLock,job.deadline);
+			continue;
+		}
+		mJobs.pop();
+		// Pass the wakeup along if another job is due.
+		if (!mJobs.empty()) mWakeup.signal();
+
+		mWakeups++;
+		mTotalLateness += lateness;
+		if (lateness>mMaxLateness) mMaxLateness = lateness;
+		if (lateness>=(long)gFrameMicroseconds) mLateWakeups++;
+
+		mLock.unlock();
+		job.encoder->serviceFrame();
+		Timeval deadline = gBTS.clock().systime(job.encoder->serviceTime());
+		// Same limit as Clock::wait, against a wild write time.
+		static const long maxSleep = 51*26*gFrameMicroseconds;
+		now.now();
+		if (deltaUSec(now,deadline)>maxSleep) deadline = Timeval(maxSleep/1000);
+		mLock.lock();
+
+		schedule(job.encoder,deadline);
+	}
+}
+
+
+void *GSM::L1SchedulerServiceLoopAdapter(L1Scheduler* scheduler)
+{
+	scheduler->serviceLoop();
+	return NULL;
+}
+
+
+void L1Scheduler::stats(ostream& os) const
+{
+	ScopedLock lock(mLock);
+	os << "L1 scheduler: " << mNumJobs << " encoders on " << mNumWorkers << " workers";
+	if (mWakeups==0) {
+		os << endl;
+		return;
+	}
+	os << ", wakeup lateness mean " << (long)(mTotalLateness/mWakeups)
+		<< " us, max " << mMaxLateness
+		<< " us, " << mLateWakeups << "/" << mWakeups << " a frame or more late" << endl;
+}
+
+// vim: ts=4 sw=4
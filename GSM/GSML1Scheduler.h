@@ -0,0 +1,124 @@
+/*
+* Copyright 2011 Range Networks, Inc.
+*
+* This software is distributed under the terms of the GNU Affero Public License.
+* See the COPYING file in the main directory for details.
+*
+* This use of this software may be subject to additional restrictions.
+* See the LEGAL file in the main directory for details.
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU Affero General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU Affero General Public License for more details.
+
+	You should have received a copy of the GNU Affero General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef GSML1SCHEDULER_H
+#define GSML1SCHEDULER_H
+
+#include <iostream>
+#include <queue>
+#include <vector>
+
+#include <Threads.h>
+#include <Timeval.h>
+
+
+namespace GSM {
+
+
+class L1Encoder;
+
+
+/**
+	A small pool of threads that runs the clock-driven L1 encoders.
+	Each encoder is kept in a queue ordered by the system time of its next
+	deadline, L1Encoder::serviceTime(). A worker sleeps until the earliest
+	deadline, calls L1Encoder::serviceFrame() and queues the encoder again.
+	An encoder is never serviced by two workers at once, so per-channel
+	state stays in the encoder objects without extra locking.
+*/
+class L1Scheduler {
+
+	private:
+
+	/** An encoder and the system time of its next deadline. */
+	struct Job {
+		Timeval deadline;
+		L1Encoder* encoder;
+	};
+
+	/** Orders the job queue, earliest deadline on top. */
+	struct Later {
+		bool operator()(const Job& a, const Job& b) const
+		{
+			if (a.deadline.sec()!=b.deadline.sec()) return a.deadline.sec()>b.deadline.sec();
+			return a.deadline.usec()>b.deadline.usec();
+		}
+	};
+
+	mutable Mutex mLock;
+	Signal mWakeup;				///< signaled when the earliest deadline changes
+	std::priority_queue<Job,std::vector<Job>,Later> mJobs;
+	unsigned mNumJobs;			///< encoders in the schedule, queued or running
+	unsigned mNumWorkers;
+	Thread* mWorkers;
+
+	/**@name Wakeup lateness statistics, in microseconds. */
+	//@{
+	unsigned long mWakeups;		///< jobs run since start()
+	unsigned long mLateWakeups;	///< jobs run a frame or more past their deadline
+	double mTotalLateness;
+	long mMaxLateness;
+	//@}
+
+	public:
+
+	L1Scheduler()
+		:mNumJobs(0),mNumWorkers(0),mWorkers(NULL),
+		mWakeups(0),mLateWakeups(0),mTotalLateness(0),mMaxLateness(0)
+	{ }
+
+	/** Start the worker threads. */
+	void start(unsigned wNumWorkers);
+
+	/** Schedule an encoder to run right away, and from then on at its deadlines. */
+	void add(L1Encoder* encoder);
+
+	/** Number of encoders in the schedule. */
+	unsigned size() const;
+
+	/** Print the worker count and wakeup lateness. */
+	void stats(std::ostream& os) const;
+
+	private:
+
+	/** Queue an encoder at a deadline and wake a worker if it is now the earliest. */
+	void schedule(L1Encoder* encoder, const Timeval& deadline);
+
+	/** The worker loop. */
+	void serviceLoop();
+
+	friend void *L1SchedulerServiceLoopAdapter(L1Scheduler*);
+};
+
+
+void *L1SchedulerServiceLoopAdapter(L1Scheduler*);
+
+
+}	// namespace GSM
+
+
+#endif
+
+// vim: ts=4 sw=4
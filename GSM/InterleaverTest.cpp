@@ -0,0 +1,175 @@
+/*
+* Copyright 2008 Free Software Foundation, Inc.
+* Copyright 2011 Range Networks, Inc.
+*
+* This software is distributed under the terms of the GNU Affero Public License.
+* See the COPYING file in the main directory for details.
+*
+* This use of this software may be subject to additional restrictions.
+* See the LEGAL file in the main directory for details.
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU Affero General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU Affero General Public License for more details.
+
+	You should have received a copy of the GNU Affero General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+/*
+	Checks the interleaver tables in GSMCommon against the formulas of
+	GSM 05.03 3.1.3 and 4.1.4, and that gathering and scattering through
+	the tables reproduces the formula interleavers on random blocks of
+	soft, hard and packed bits.
+*/
+
+
+#include "GSMCommon.h"
+#include <BitVector.h>
+#include <iostream>
+#include <cstdlib>
+
+using namespace std;
+using namespace GSM;
+
+
+/** Burst position of c[k] from GSM 05.03 3.1.3 and 4.1.4. */
+static unsigned position(unsigned k)
+{
+	return 2*((49*k) % 57) + ((k%8)/4);
+}
+
+
+/** Check both tables against the formulas, and that each is a permutation of c[]. */
+static bool checkTables()
+{
+	bool pass = true;
+
+	bool seen[456];
+	for (unsigned k=0; k<456; k++) seen[k] = false;
+	for (unsigned B=0; B<4; B++) {
+		for (unsigned j=0; j<114; j++) {
+			const unsigned k = gXCCHInterleave[B][j];
+			if (k>=456 || seen[k] || k%4!=B || position(k)!=j) {
+				cout << "FAIL gXCCHInterleave[" << B << "][" << j << "]=" << k << endl;
+				pass = false;
+			}
+			else seen[k] = true;
+		}
+	}
+
+	for (unsigned k=0; k<456; k++) seen[k] = false;
+	for (unsigned r=0; r<8; r++) {
+		for (unsigned n=0; n<57; n++) {
+			const unsigned k = gTCHInterleave[r][n];
+			if (k>=456 || seen[k] || k%8!=r || position(k)!=2*n+r/4) {
+				cout << "FAIL gTCHInterleave[" << r << "][" << n << "]=" << k << endl;
+				pass = false;
+			}
+			else seen[k] = true;
+		}
+	}
+
+	return pass;
+}
+
+
+/** Interleave c[] by the tables and by the formulas, hard, packed and soft. */
+static bool checkXCCH()
+{
+	BitVector c(456);
+	SoftVector sc(456);
+	for (unsigned k=0; k<456; k++) {
+		c[k] = random() & 0x01;
+		sc[k] = (float)random()/RAND_MAX;
+	}
+	PackedBitVector pc(c);
+
+	bool pass = true;
+	BitVector c2(456);
+	SoftVector sc2(456);
+	for (unsigned B=0; B<4; B++) {
+		BitVector i(114);
+		c.map(gXCCHInterleave[B],114,i);
+		PackedBitVector pi(114);
+		pc.map(gXCCHInterleave[B],114,pi);
+		SoftVector si(114);
+		sc.map(gXCCHInterleave[B],114,si);
+		for (unsigned k=B; k<456; k+=4) {
+			const unsigned j = position(k);
+			if (i[j]!=c[k] || pi.bit(j)!=c.bit(k) || si[j]!=sc[k]) pass = false;
+		}
+		i.unmap(gXCCHInterleave[B],114,c2);
+		si.unmap(gXCCHInterleave[B],114,sc2);
+	}
+	for (unsigned k=0; k<456; k++) {
+		if (c2[k]!=c[k] || sc2[k]!=sc[k]) pass = false;
+	}
+
+	if (!pass) cout << "FAIL xCCH c=" << c << endl;
+	return pass;
+}
+
+
+/** The same for the TCH diagonal interleaver at one block offset. */
+static bool checkTCH(unsigned blockOffset)
+{
+	BitVector c(456);
+	for (unsigned k=0; k<456; k++) c[k] = random() & 0x01;
+
+	BitVector expected[8];
+	BitVector i[8];
+	for (unsigned B=0; B<8; B++) {
+		expected[B].resize(114);
+		expected[B].zero();
+		i[B].resize(114);
+		i[B].zero();
+	}
+	for (unsigned k=0; k<456; k++) expected[(k+blockOffset)%8][position(k)] = c[k];
+
+	// the same gather GSML1FEC uses
+	for (unsigned r=0; r<8; r++) {
+		char *ip = i[(r+blockOffset)%8].begin() + r/4;
+		for (unsigned n=0; n<57; n++) ip[2*n] = c[gTCHInterleave[r][n]];
+	}
+
+	bool pass = true;
+	for (unsigned B=0; B<8; B++) {
+		for (unsigned j=0; j<114; j++) {
+			if (i[B][j]!=expected[B][j]) pass = false;
+		}
+	}
+
+	if (!pass) cout << "FAIL TCH offset=" << blockOffset << " c=" << c << endl;
+	return pass;
+}
+
+
+int main(int argc, char *argv[])
+{
+	unsigned numTests = 0;
+	unsigned numFailed = 0;
+
+	if (!checkTables()) numFailed++;
+	numTests++;
+
+	for (unsigned t=0; t<1000; t++) {
+		if (!checkXCCH()) numFailed++;
+		if (!checkTCH(0)) numFailed++;
+		if (!checkTCH(4)) numFailed++;
+		numTests += 3;
+	}
+
+	cout << numTests-numFailed << "/" << numTests << " passed" << endl;
+
+	return (numFailed==0) ? 0 : 1;
+}
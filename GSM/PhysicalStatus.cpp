@@ -75,12 +75,13 @@ int PhysicalStatus::open(const char* wPath)
 		LOG(EMERG) << "Cannot create TMSI table";
 		return 1;
 	}
+	if (gConfig.getNum("Control.Reporting.WAL",0)) sqlite3_enable_wal(mDB);
 	return 0;
 }
 
 PhysicalStatus::~PhysicalStatus()
 {
-	if (mDB) sqlite3_close(mDB);
+	if (mDB) sqlite3_close_database(mDB);
 }
 
 bool PhysicalStatus::createEntry(const LogicalChannel* chan)
@@ -96,11 +97,10 @@ bool PhysicalStatus::createEntry(const LogicalChannel* chan)
 	/* Check to see if the key exists. */
 	if (!sqlite3_exists(mDB, "PHYSTATUS", "CN_TN_TYPE_AND_OFFSET", chanString)) {
 		/* No? Ok, it should now. */
-		char query[500];
-		sprintf(query, "INSERT INTO PHYSTATUS (CN_TN_TYPE_AND_OFFSET, ACCESSED) VALUES "
-					   "(\"%s\", %u)",
-				chanString, (unsigned)time(NULL));
-		return sqlite3_command(mDB, query);
+		char now[20];
+		sprintf(now, "%u", (unsigned)time(NULL));
+		const char* params[] = { chanString, now };
+		return sqlite3_command(mDB, "INSERT INTO PHYSTATUS (CN_TN_TYPE_AND_OFFSET, ACCESSED) VALUES (?,?)", 2, params);
 	}
 
 	return false;
@@ -119,35 +119,40 @@ bool PhysicalStatus::setPhysical(const LogicalChannel* chan,
 
 	createEntry(chan);
 
-	char query[500];
-	sprintf(query,
+	static const char* query =
 		"UPDATE PHYSTATUS SET "
-		"RXLEV_FULL_SERVING_CELL=%d, "
-		"RXLEV_SUB_SERVING_CELL=%d, "
-		"RXQUAL_FULL_SERVING_CELL_BER=%f, "
-		"RXQUAL_SUB_SERVING_CELL_BER=%f, "
-		"RSSI=%f, "
-		"TIME_ERR=%f, "
-		"TRANS_PWR=%u, "
-		"TIME_ADVC=%u, "
-		"FER=%f, "
-		"ACCESSED=%u, "
-		"ARFCN=%u "
-		"WHERE CN_TN_TYPE_AND_OFFSET==\"%s\"",
-		measResults.RXLEV_FULL_SERVING_CELL_dBm(),
-		measResults.RXLEV_SUB_SERVING_CELL_dBm(),
-		measResults.RXQUAL_FULL_SERVING_CELL_BER(),
-		measResults.RXQUAL_SUB_SERVING_CELL_BER(),
-		chan->RSSI(), chan->timingError(),
-		chan->actualMSPower(), chan->actualMSTiming(),
-		chan->FER(),
-		(unsigned)time(NULL),
-		chan->ARFCN(),
-		chan->descriptiveString());
-
-	LOG(DEBUG) << "Query: " << query;
-
-	return sqlite3_command(mDB, query);
+		"RXLEV_FULL_SERVING_CELL=?, "
+		"RXLEV_SUB_SERVING_CELL=?, "
+		"RXQUAL_FULL_SERVING_CELL_BER=?, "
+		"RXQUAL_SUB_SERVING_CELL_BER=?, "
+		"RSSI=?, "
+		"TIME_ERR=?, "
+		"TRANS_PWR=?, "
+		"TIME_ADVC=?, "
+		"FER=?, "
+		"ACCESSED=?, "
+		"ARFCN=? "
+		"WHERE CN_TN_TYPE_AND_OFFSET==?";
+	sqlite3_stmt *stmt = sqlite3_cached_statement(mDB, query);
+	if (!stmt) return false;
+	sqlite3_bind_int(stmt, 1, measResults.RXLEV_FULL_SERVING_CELL_dBm());
+	sqlite3_bind_int(stmt, 2, measResults.RXLEV_SUB_SERVING_CELL_dBm());
+	sqlite3_bind_double(stmt, 3, measResults.RXQUAL_FULL_SERVING_CELL_BER());
+	sqlite3_bind_double(stmt, 4, measResults.RXQUAL_SUB_SERVING_CELL_BER());
+	sqlite3_bind_double(stmt, 5, chan->RSSI());
+	sqlite3_bind_double(stmt, 6, chan->timingError());
+	sqlite3_bind_int(stmt, 7, chan->actualMSPower());
+	sqlite3_bind_int(stmt, 8, chan->actualMSTiming());
+	sqlite3_bind_double(stmt, 9, chan->FER());
+	sqlite3_bind_int64(stmt, 10, (unsigned)time(NULL));
+	sqlite3_bind_int64(stmt, 11, chan->ARFCN());
+	sqlite3_bind_text(stmt, 12, chan->descriptiveString(), -1, SQLITE_TRANSIENT);
+
+	LOG(DEBUG) << "channel: " << chan->descriptiveString();
+
+	int src = sqlite3_run_query(mDB, stmt);
+	sqlite3_release_statement(mDB, query, stmt);
+	return src==SQLITE_DONE;
 }
 
 #if 0
@@ -227,11 +227,21 @@ void SIPInterface::drive()
 	// All inbound SIP messages go here for processing.
 
 	LOG(DEBUG) << "blocking on socket";
-	int numRead = mSIPSocket.read(mReadBuffer);
-	if (numRead<0) {
+	int numMessages = mSIPSocket.readBatch(mReadBuffers,mReadLengths,readBatchSize);
+	if (numMessages<0) {
 		LOG(ALERT) << "cannot read SIP socket.";
 		return;
 	}
+	for (int i=0; i<numMessages; i++) {
+		int numRead = mReadLengths[i];
+		memcpy(mReadBuffer,mReadBuffers[i],numRead);
+		processMessage(numRead);
+	}
+}
+
+
+void SIPInterface::processMessage(int numRead)
+{
 	if (numRead<10) {
 		LOG(WARNING) << "malformed packet (" << numRead << " bytes) on SIP socket";
 		return;
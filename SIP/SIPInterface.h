@@ -128,7 +128,10 @@ class SIPInterface
 
 private:
 
-	char mReadBuffer[2048];		///< buffer for UDP reads
+	static const unsigned readBatchSize = 8;	///< most messages taken per socket read
+	char mReadBuffers[readBatchSize][MAX_UDP_LENGTH];	///< buffers for UDP reads
+	int mReadLengths[readBatchSize];	///< lengths of the messages in mReadBuffers
+	char mReadBuffer[2048];		///< the message being processed, NULL-terminated
 
 	UDPSocket mSIPSocket;
 
@@ -158,9 +161,12 @@ public:
 	/** Start the SIP drive loop. */
 	void start();
 
-	/** Receive, parse and dispatch a single SIP message. */
+	/** Receive, parse and dispatch the SIP messages waiting on the socket. */
 	void drive();
 
+	/** Parse and dispatch the SIP message in mReadBuffer. */
+	void processMessage(int numRead);
+
 	/**
 		Look for incoming INVITE messages to start MTC.
 		@param msg The SIP message to check.
@@ -181,7 +181,7 @@ int SubscriberRegistry::init()
 
 SubscriberRegistry::~SubscriberRegistry()
 {
-	if (mDB) sqlite3_close(mDB);
+	if (mDB) sqlite3_close_database(mDB);
 }
 
 
@@ -130,8 +130,14 @@ unsigned TransceiverManager::C0() const
 ::ARFCNManager::ARFCNManager(const char* wTRXAddress, int wBasePort, TransceiverManager &wTransceiver)
 	:mTransceiver(wTransceiver),
 	mDataSocket(wBasePort+100+1,wTRXAddress,wBasePort+1),
-	mControlSocket(wBasePort+100,wTRXAddress,wBasePort)
+	mSharedData(false),
+	mControlSocket(wBasePort+100,wTRXAddress,wBasePort),
+	mNumDecodeWorkers(0),
+	mDataFormat(1),mTxBatchCount(0),mTxFlushStarted(false)
 {
+	// The transceiver names its shared memory after its data port.
+	sprintf(mDataLinkName,"/OpenBTS.TRX.%d",wBasePort+1);
+
 	// The default demux table is full of NULL pointers.
 	for (int i=0; i<8; i++) {
 		for (unsigned j=0; j<maxModulus; j++) {
@@ -145,6 +151,16 @@ unsigned TransceiverManager::C0() const
 
 void ::ARFCNManager::start()
 {
+	// Optionally fan bursts out to decode threads by timeslot.
+	// Each decoder sits on one timeslot, so it still sees its bursts in order.
+	mNumDecodeWorkers = gConfig.getNum("GSM.L1.DecodeWorkers",0);
+	if (mNumDecodeWorkers>8) mNumDecodeWorkers=8;
+	for (unsigned i=0; i<mNumDecodeWorkers; i++) {
+		mDecodeWorkers[i].manager = this;
+		mDecodeWorkers[i].thread.start((void*(*)(void*))DecodeLoopAdapter,&mDecodeWorkers[i]);
+	}
+	// Move the data interface to shared memory, if configured and offered.
+	setSharedMemory(gConfig.getNum("TRX.SharedMemory",0));
 	mRxThread.start((void*(*)(void*))ReceiveLoopAdapter,this);
 }
 
@@ -166,7 +182,8 @@ void ::ARFCNManager::installDecoder(GSM::L1Decoder *wL1d)
 		while (FN<maxModulus) {
 			// Don't overwrite existing entries.
 			assert(mDemuxTable[TN][FN]==NULL);
-			mDemuxTable[TN][FN] = wL1d;
+			// Publish the decoder to the lock-free readers in receiveBurst.
+			__atomic_store_n(&mDemuxTable[TN][FN],wL1d,__ATOMIC_RELEASE);
 			FN += mapping.repeatLength();
 		}
 	}
@@ -179,14 +196,27 @@ void ::ARFCNManager::installDecoder(GSM::L1Decoder *wL1d)
 void ::ARFCNManager::writeHighSide(const GSM::TxBurst& burst)
 {
 	LOG(DEBUG) << "transmit at time " << gBTS.clock().get() << ": " << burst;
-	// format the transmission request message
+	mDataSocketLock.lock();
+	// format the transmission request message,
+	// either on its own or as the next record of the batch
 	static const int bufferSize = gSlotLen+1+4+1;
-	char buffer[bufferSize];
-	unsigned char *wp = (unsigned char*)buffer;
+	unsigned char buffer[bufferSize];
+	unsigned char *wp = buffer;
+	uint32_t FN = burst.time().FN();
+	if (mDataFormat==2) {
+		// Each record carries its own FN, so a batch can span frames.
+		// The first burst of a batch sets its deadline and wakes the flush thread.
+		if (!mTxBatchCount) {
+			Timeval now;
+			unsigned usec = now.usec() + gFrameMicroseconds/2;
+			mTxBatchDeadline = Timeval(now.sec()+usec/1000000,usec%1000000);
+			mTxBatchStarted.signal();
+		}
+		wp = mTxBatch + 2 + mTxBatchCount*txRecordLength;
+	}
 	// slot
 	*wp++ = burst.time().TN();
 	// frame number
-	uint32_t FN = burst.time().FN();
 	*wp++ = (FN>>24) & 0x0ff;
 	*wp++ = (FN>>16) & 0x0ff;
 	*wp++ = (FN>>8) & 0x0ff;
@@ -194,28 +224,105 @@ void ::ARFCNManager::writeHighSide(const GSM::TxBurst& burst)
 	// power level
 	/// FIXME -- We hard-code gain to 0 dB for now.
 	*wp++ = 0;
-	// copy data
-	const char *dp = burst.begin();
-	for (unsigned i=0; i<gSlotLen; i++) {
-		*wp++ = (unsigned char)((*dp++) & 0x01);
+	if (mDataFormat==2) {
+		// packed data, sent when the batch is full or by the flush thread
+		burst.pack(wp);
+		mTxBatchCount++;
+		if (mTxBatchCount==batchMaxBursts) flushTxBatch();
+	} else {
+		// copy data
+		const char *dp = burst.begin();
+		for (unsigned i=0; i<gSlotLen; i++) {
+			*wp++ = (unsigned char)((*dp++) & 0x01);
+		}
+		// write to the socket
+		writeData((char*)buffer,bufferSize);
 	}
-	// write to the socket
-	mDataSocketLock.lock();
-	mDataSocket.write(buffer,bufferSize);
 	mDataSocketLock.unlock();
 }
 
 
+void ::ARFCNManager::writeData(const char* buffer, size_t length)
+{
+	if (!mSharedData) {
+		mDataSocket.write(buffer,length);
+		return;
+	}
+	if (mDataLink.write(buffer,length)<0) {
+		LOG(WARNING) << "shared memory data ring full, dropping a message";
+	}
+}
+
+
+void ::ARFCNManager::flushTxBatch()
+{
+	if (!mTxBatchCount) return;
+	mTxBatch[0] = batchMarker;
+	mTxBatch[1] = mTxBatchCount;
+	writeData((char*)mTxBatch,2+mTxBatchCount*txRecordLength);
+	mTxBatchCount = 0;
+}
+
+
+void* TxFlushLoopAdapter(::ARFCNManager* manager)
+{
+	// Sleep until a batch is started, then until its deadline,
+	// unless it fills up and is sent by writeHighSide first.
+	manager->mDataSocketLock.lock();
+	while (true) {
+		if (!manager->mTxBatchCount) {
+			manager->mTxBatchStarted.wait(manager->mDataSocketLock);
+			continue;
+		}
+		if (!manager->mTxBatchDeadline.passed()) {
+			manager->mTxBatchStarted.wait(manager->mDataSocketLock,manager->mTxBatchDeadline);
+			continue;
+		}
+		manager->flushTxBatch();
+	}
+	manager->mDataSocketLock.unlock();
+	return NULL;
+}
+
+
 
 
 void ::ARFCNManager::driveRx()
 {
-	// read the message
-	char buffer[MAX_UDP_LENGTH];
-	int msgLen = mDataSocket.read(buffer);
-	if (msgLen<=0) SOCKET_ERROR;
-	// decode
-	unsigned char *rp = (unsigned char*)buffer;
+	// read the messages, all that are waiting on the socket
+	int numRead;
+	if (mSharedData) {
+		mRxLengths[0] = mDataLink.read(mRxBuffers[0]);
+		numRead = 1;
+	} else {
+		numRead = mDataSocket.readBatch(mRxBuffers,mRxLengths,rxBatchSize);
+	}
+	if (numRead<=0) SOCKET_ERROR;
+	for (int i=0; i<numRead; i++) receiveMessage(mRxBuffers[i],mRxLengths[i]);
+}
+
+
+void ::ARFCNManager::receiveMessage(const char* buffer, int msgLen)
+{
+	if (msgLen<=0) return;
+	const unsigned char *rp = (const unsigned char*)buffer;
+	// A format 1 message is a single burst, starting with its timeslot.
+	if (rp[0]!=batchMarker) {
+		receiveRecord(rp);
+		return;
+	}
+	// A batch is the marker, the burst count and the bursts.
+	unsigned count = rp[1];
+	if ((count>batchMaxBursts) || (msgLen!=(int)(2+count*rxRecordLength))) {
+		LOG(ERR) << "badly formatted burst batch, " << msgLen << " bytes for " << count << " bursts";
+		return;
+	}
+	for (unsigned i=0; i<count; i++) receiveRecord(rp+2+i*rxRecordLength);
+}
+
+
+void ::ARFCNManager::receiveRecord(const unsigned char* rp)
+{
 	// timeslot number
 	unsigned TN = *rp++;
 	// frame number
@@ -224,10 +331,10 @@ void ::ARFCNManager::driveRx()
 	FN = (FN<<8) + (*rp++);
 	FN = (FN<<8) + (*rp++);
 	// physcial header data
-	signed char* srp = (signed char*)rp++;
+	const signed char* srp = (const signed char*)rp++;
 	// reported RSSI is negated dB wrt full scale
 	int RSSI = *srp;
-	srp = (signed char*)rp++;
+	srp = (const signed char*)rp++;
 	// timing error comes in 1/256 symbol steps
 	// because that fits nicely in 2 bytes
 	int timingError = *srp;
@@ -469,6 +576,44 @@ bool ::ARFCNManager::setSlot(unsigned TN, unsigned combination)
 	return true;
 }
 
+bool ::ARFCNManager::setDataFormat(unsigned format)
+{
+	int status = sendCommand("SETFORMAT",format);
+	if (status!=0) {
+		LOG(NOTICE) << "SETFORMAT failed with status " << status << ", staying on data format " << mDataFormat;
+		return false;
+	}
+	mDataSocketLock.lock();
+	flushTxBatch();
+	mDataFormat = format;
+	if ((format==2) && !mTxFlushStarted) {
+		mTxFlushThread.start((void*(*)(void*))TxFlushLoopAdapter,this);
+		mTxFlushStarted = true;
+	}
+	mDataSocketLock.unlock();
+	return true;
+}
+
+bool ::ARFCNManager::setSharedMemory(bool enable)
+{
+	// Attach first, so the transceiver is only asked when this side is ready.
+	if (enable && !mDataLink.attach(mDataLinkName)) {
+		LOG(NOTICE) << "transceiver offers no shared memory, using UDP";
+		enable = false;
+	}
+	int status = sendCommand("SETSHM",enable ? 1 : 0);
+	if (enable && (status!=0)) {
+		LOG(NOTICE) << "SETSHM failed with status " << status << ", using UDP";
+		enable = false;
+	}
+	mDataSocketLock.lock();
+	mSharedData = enable;
+	if (!enable) mDataLink.close();
+	mDataSocketLock.unlock();
+	LOG(INFO) << "data interface on " << (enable ? mDataLinkName : "UDP");
+	return enable;
+}
+
 bool ::ARFCNManager::setMaxDelay(unsigned km)
 {
         int status = sendCommand("SETMAXDLY",km);
@@ -501,21 +646,42 @@ signed ::ARFCNManager::getNoiseLevel(void)
         return noiselevel;
 }
 
-void ::ARFCNManager::receiveBurst(const RxBurst& inBurst)
+L1Decoder* ::ARFCNManager::demux(const GSM::Time& when) const
 {
-	LOG(DEBUG) << "receiveBurst: " << inBurst;
-	uint32_t FN = inBurst.time().FN() % maxModulus;
-	unsigned TN = inBurst.time().TN();
-
-	mTableLock.lock();
-	L1Decoder *proc = mDemuxTable[TN][FN];
+	uint32_t FN = when.FN() % maxModulus;
+	unsigned TN = when.TN();
+	L1Decoder *proc = __atomic_load_n(&mDemuxTable[TN][FN],__ATOMIC_ACQUIRE);
 	if (proc==NULL) {
 		LOG(DEBUG) << "ARFNManager::receiveBurst in unconfigured TDMA position TN: " << TN << " FN: " << FN << ".";
-		mTableLock.unlock();
+	}
+	return proc;
+}
+
+
+void ::ARFCNManager::receiveBurst(const RxBurst& inBurst)
+{
+	LOG(DEBUG) << "receiveBurst: " << inBurst;
+	if (mNumDecodeWorkers) {
+		// Copy the burst out of the receive buffer for the decode thread.
+		unsigned TN = inBurst.time().TN();
+		if (demux(inBurst.time())) mDecodeWorkers[TN%mNumDecodeWorkers].queue.write(new RxBurst(inBurst));
 		return;
 	}
-	proc->writeLowSide(inBurst);
-	mTableLock.unlock();
+	L1Decoder *proc = demux(inBurst.time());
+	if (proc) proc->writeLowSide(inBurst);
+}
+
+
+void* DecodeLoopAdapter(ARFCNDecodeWorker* worker)
+{
+	while (true) {
+		RxBurst *burst = worker->queue.read();
+		if (burst==NULL) continue;
+		L1Decoder *proc = worker->manager->demux(burst->time());
+		if (proc) proc->writeLowSide(*burst);
+		delete burst;
+	}
+	return NULL;
 }
 
 
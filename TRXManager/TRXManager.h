@@ -33,6 +33,7 @@
 
 #include "Threads.h"
 #include "Sockets.h"
+#include "SharedMemory.h"
 #include "Interthread.h"
 #include "GSMCommon.h"
 #include "GSMTransfer.h"
@@ -113,6 +114,18 @@ void* ClockLoopAdapter(TransceiverManager *TRXm);
 
 
 
+/** A thread decoding bursts for some of the timeslots of an ARFCNManager. */
+struct ARFCNDecodeWorker {
+	ARFCNManager* manager;
+	GSM::RxBurstFIFO queue;		///< bursts waiting for this worker
+	Thread thread;
+};
+
+/** C interface for the decode threads. */
+void* DecodeLoopAdapter(ARFCNDecodeWorker*);
+
+
+
 /**
 	The ARFCN Manager processes transceiver functions for a single ARFCN.
 	When we do frequency hopping, this will manage a full rate radio channel.
@@ -125,18 +138,54 @@ class ARFCNManager {
 
 	Mutex mDataSocketLock;			///< lock to prevent contentional for the socket
 	UDPSocket mDataSocket;			///< socket for data transfer
+	SharedMemoryLink mDataLink;		///< shared memory alternative to mDataSocket
+	char mDataLinkName[32];			///< name of the transceiver's shared memory region
+	bool mSharedData;				///< true if mDataLink carries the data
 	Mutex mControlLock;				///< lock to prevent overlapping transactions
 	UDPSocket mControlSocket;		///< socket for radio control
 
 	Thread mRxThread;				///< thread to receive data from rx
 
+	/**@name Receive buffers, for all the messages driveRx() takes in one call. */
+	//@{
+	static const unsigned rxBatchSize=16;
+	char mRxBuffers[rxBatchSize][MAX_UDP_LENGTH];
+	int mRxLengths[rxBatchSize];
+	//@}
+
 	/**@name The demux table. */
 	//@{
+	/**
+		Serializes installDecoder().
+		Entries only go from NULL to a decoder, each with an atomic store,
+		so receiveBurst() reads the table without taking the lock.
+	*/
 	Mutex mTableLock;
 	static const unsigned maxModulus=51*26*4;	///< maximum unified repeat period
 	GSM::L1Decoder* mDemuxTable[8][maxModulus];		///< the demultiplexing table for received bursts
 	//@}
 
+	/**@name Optional decode threads, each serving the timeslots with TN%mNumDecodeWorkers==index. */
+	//@{
+	unsigned mNumDecodeWorkers;		///< 0 decodes on the receive thread
+	ARFCNDecodeWorker mDecodeWorkers[8];
+	//@}
+
+	/**@name Data socket format 2, several bursts per datagram, see README.TRXManager. */
+	//@{
+	static const unsigned batchMarker=0x82;		///< first byte of a batch, never a timeslot index
+	static const unsigned batchMaxBursts=8;		///< most bursts in one batch
+	static const unsigned txRecordLength=6+(GSM::gSlotLen+7)/8;	///< a downlink burst, bits packed MSB first
+	static const unsigned rxRecordLength=8+GSM::gSlotLen;	///< an uplink burst, 8-bit soft bits
+	unsigned mDataFormat;			///< 1 until the transceiver accepts SETFORMAT 2
+	unsigned char mTxBatch[2+batchMaxBursts*txRecordLength];	///< downlink bursts not yet sent, under mDataSocketLock
+	unsigned mTxBatchCount;			///< bursts in mTxBatch
+	Timeval mTxBatchDeadline;		///< when a partial batch must go, half a frame after its first burst
+	Signal mTxBatchStarted;			///< signaled when a burst goes into an empty batch
+	Thread mTxFlushThread;			///< sends partial batches at their deadlines
+	bool mTxFlushStarted;			///< set once mTxFlushThread runs
+	//@}
+
 	unsigned mARFCN;						///< the current ARFCN
 
 
@@ -227,6 +276,15 @@ class ARFCNManager {
 	*/
 	bool setSlot(unsigned TN, unsigned combo);
 
+	/**
+		Select the data socket format, 1 for one burst per datagram
+		or 2 for batches.  A transceiver that does not know the command
+		stays on format 1.
+		@param format The format to request.
+		@return true on success.
+	*/
+	bool setDataFormat(unsigned format);
+
 	//@}
 
 
@@ -240,12 +298,41 @@ class ARFCNManager {
 	/** Action for reception. */
 	void driveRx();
 
-	/** Demultiplex and process a received burst. */
+	/** Parse one uplink message, of either data format. */
+	void receiveMessage(const char* buffer, int msgLen);
+
+	/** Parse one uplink burst record and pass it to receiveBurst(). */
+	void receiveRecord(const unsigned char* rp);
+
+	/**
+		Move the data interface to shared memory, or back to UDP.
+		Called before the uplink thread starts.
+		@param enable Use shared memory if the transceiver offers it.
+		@return true if shared memory is in use.
+	*/
+	bool setSharedMemory(bool enable);
+
+	/** Send a data message on the interface in use.  Caller holds mDataSocketLock. */
+	void writeData(const char* buffer, size_t length);
+
+	/** Send the pending downlink batch, if any.  Caller holds mDataSocketLock. */
+	void flushTxBatch();
+
+	/** Demultiplex and process a received burst, or queue it for a decode thread. */
 	void receiveBurst(const GSM::RxBurst&);
 
+	/** Look up the decoder for a burst, NULL if none is installed. */
+	GSM::L1Decoder* demux(const GSM::Time&) const;
+
 	/** Receiver loop. */
 	friend void* ReceiveLoopAdapter(ARFCNManager*);
 
+	/** Decode thread loop. */
+	friend void* DecodeLoopAdapter(ARFCNDecodeWorker*);
+
+	/** Downlink batch flush loop. */
+	friend void* TxFlushLoopAdapter(ARFCNManager*);
+
 	/**
 		Send a command packet and get the response packet.
 		@param command The NULL-terminated command string to send.
@@ -285,6 +372,7 @@ class ARFCNManager {
 
 /** C interface for ARFCNManager threads. */
 void* ReceiveLoopAdapter(ARFCNManager*);
+void* TxFlushLoopAdapter(ARFCNManager*);
 
 
 #endif
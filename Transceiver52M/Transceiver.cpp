@@ -29,8 +29,10 @@
 
 
 #include <stdio.h>
+#include <unistd.h>
 #include "Transceiver.h"
 #include <Logger.h>
+#include <Configuration.h>
 
 #ifdef HAVE_CONFIG_H
 #include "config.h"
@@ -46,6 +48,8 @@
 
 #define INIT_ENERGY_THRSHD		5.0f
 
+extern ConfigurationTable gConfig;
+
 Transceiver::Transceiver(int wBasePort,
 			 const char *TRXAddress,
 			 int wSamplesPerSymbol,
@@ -72,6 +76,7 @@ Transceiver::Transceiver(int wBasePort,
   mLatencyUpdateTime = startTime;
   mRadioInterface->getClock()->set(startTime);
   mMaxExpectedDelay = 0;
+  mMaxRACHDelay = gConfig.getNum("GSM.MS.TA.Max",63);
 
   // generate pulse and setup up signal processing library
   gsmPulse = generateGSMPulse(2,mSamplesPerSymbol);
@@ -97,6 +102,7 @@ Transceiver::Transceiver(int wBasePort,
     DFEForward[i] = NULL;
     DFEFeedback[i] = NULL;
     channelEstimateTime[i] = startTime;
+    corrBuffer[i] = new signalVector((gSlotLen+8)*mSamplesPerSymbol);
   }
 
   mOn = false;
@@ -105,29 +111,91 @@ Transceiver::Transceiver(int wBasePort,
   mPower = -10;
   mEnergyThreshold = INIT_ENERGY_THRSHD;
   prevFalseDetectionTime = startTime;
+
+  // demodulate on worker threads, unless configured for none
+  long numWorkers;
+  if (gConfig.defines("TRX.RxWorkers"))
+    numWorkers = gConfig.getNum("TRX.RxWorkers");
+  else
+    numWorkers = sysconf(_SC_NPROCESSORS_ONLN) - 1;
+  if (numWorkers < 0) numWorkers = 0;
+  if (numWorkers > RXWORKER_MAX) numWorkers = RXWORKER_MAX;
+  mNumRxWorkers = numWorkers;
+  for (unsigned i = 0; i < mNumRxWorkers; i++)
+    mRxWorkers[i] = new RxWorker(this);
+  mRxOrderHead = 0;
+  mRxOrderTail = 0;
+  mPendingRxBurst = NULL;
+  mDataFormat = 1;
+  mRxBatchCount = 0;
+
+  // offer the data interface in shared memory, named after its port
+  mSharedData = 0;
+  if (gConfig.getNum("TRX.SharedMemory",0)) {
+    char name[32];
+    sprintf(name,"/OpenBTS.TRX.%d",wBasePort+2);
+    mDataLink.create(name);
+  }
+  LOG(INFO) << "demodulating with " << mNumRxWorkers << " receive workers";
 }
 
 Transceiver::~Transceiver()
 {
   delete gsmPulse;
+  for (int i = 0; i < 8; i++)
+    delete corrBuffer[i];
   sigProcLibDestroy();
   mTransmitPriorityQueue.clear();
 }
   
 
+RxWorker::RxWorker(Transceiver *wTransceiver)
+  :mTransceiver(wTransceiver),
+   mThread(32768),
+   mResultHead(0),
+   mResultTail(0),
+   mDispatched(0)
+{
+}
+
+void RxWorker::start()
+{
+  mThread.start((void * (*)(void*))RxWorkerLoopAdapter,(void*) this);
+}
+
+void RxWorker::dispatch(radioVector *rxBurst)
+{
+  // cannot fail, inFlight() < RXWORKER_DEPTH <= VECTORFIFO_SIZE
+  mBursts.put(rxBurst);
+  mDispatched++;
+}
+
+const RxResult *RxWorker::result()
+{
+  if (mResultHead == __atomic_load_n(&mResultTail,__ATOMIC_ACQUIRE))
+    return NULL;
+  return &mResults[mResultHead % RXWORKER_DEPTH];
+}
+
 void Transceiver::addRadioVector(BitVector &burst,
 				 int RSSI,
 				 GSM::Time &wTime)
 {
-  // modulate and stick into queue 
-  signalVector* modBurst = modulateBurst(burst,*gsmPulse,
-					 8 + (wTime.TN() % 4 == 0),
-					 mSamplesPerSymbol);
-  scaleVector(*modBurst,txFullScale * pow(10,-RSSI/10));
+  // modulate, unless the same burst was sent recently, and stick into queue
+  int guardPeriodLength = 8 + (wTime.TN() % 4 == 0);
+  float scale = txFullScale * pow(10,-RSSI/10);
+  const signalVector *modBurst = mBurstCache.get(burst,guardPeriodLength,
+						 mSamplesPerSymbol,scale);
+  if (!modBurst) {
+    signalVector *newBurst = modulateBurst(burst,*gsmPulse,
+					   guardPeriodLength,
+					   mSamplesPerSymbol);
+    scaleVector(*newBurst,scale);
+    modBurst = mBurstCache.put(burst,guardPeriodLength,
+			       mSamplesPerSymbol,scale,newBurst);
+  }
   radioVector *newVec = new radioVector(*modBurst,wTime);
   mTransmitPriorityQueue.write(newVec);
-
-  delete modBurst;
 }
 
 #ifdef TRANSMIT_LOGGING
@@ -284,18 +352,13 @@ Transceiver::CorrType Transceiver::expectedCorrType(GSM::Time currTime)
 
 }
     
-SoftVector *Transceiver::pullRadioVector(GSM::Time &wTime,
-				      int &RSSI,
-				      int &timingOffset)
+SoftVector *Transceiver::demodRadioVector(radioVector *rxBurst,
+					GSM::Time &wTime,
+					int &RSSI,
+					int &timingOffset)
 {
   bool needDFE = (mMaxExpectedDelay > 1);
 
-  radioVector *rxBurst = (radioVector *) mReceiveFIFO->get();
-
-  if (!rxBurst) return NULL;
-
-  LOG(DEBUG) << "receiveFIFO: read radio vector at time: " << rxBurst->getTime() << ", new size: " << mReceiveFIFO->size();
-
   int timeslot = rxBurst->getTime().TN();
 
   CorrType corrType = expectedCorrType(rxBurst->getTime());
@@ -310,8 +373,12 @@ SoftVector *Transceiver::pullRadioVector(GSM::Time &wTime,
   complex amplitude = 0.0;
   float TOA = 0.0;
   float avgPwr = 0.0;
-  if (!energyDetect(*vectorBurst,20*mSamplesPerSymbol,mEnergyThreshold,&avgPwr)) {
+  mEnergyLock.lock();
+  float energyThreshold = mEnergyThreshold;
+  mEnergyLock.unlock();
+  if (!energyDetect(*vectorBurst,20*mSamplesPerSymbol,energyThreshold,&avgPwr)) {
      LOG(DEBUG) << "Estimated Energy: " << sqrt(avgPwr) << ", at time " << rxBurst->getTime();
+     ScopedLock lock(mEnergyLock);
      double framesElapsed = rxBurst->getTime()-prevFalseDetectionTime;
      if (framesElapsed > 50) {  // if we haven't had any false detections for a while, lower threshold
 	mEnergyThreshold -= 10.0/10.0;
@@ -352,12 +419,16 @@ SoftVector *Transceiver::pullRadioVector(GSM::Time &wTime,
 				  mMaxExpectedDelay, 
 				  estimateChannel,
 				  &channelResp,
-				  &chanOffset);
+				  &chanOffset,
+				  corrBuffer[timeslot]);
     if (success) {
       LOG(DEBUG) << "FOUND TSC!!!!!! " << amplitude << " " << TOA;
+      mEnergyLock.lock();
       mEnergyThreshold -= 1.0F/10.0F;
       if (mEnergyThreshold < 0.0) mEnergyThreshold = 0.0;
-      SNRestimate[timeslot] = amplitude.norm2()/(mEnergyThreshold*mEnergyThreshold+1.0); // this is not highly accurate
+      energyThreshold = mEnergyThreshold;
+      mEnergyLock.unlock();
+      SNRestimate[timeslot] = amplitude.norm2()/(energyThreshold*energyThreshold+1.0); // this is not highly accurate
       if (estimateChannel) {
          LOG(DEBUG) << "estimating channel...";
          channelResponse[timeslot] = channelResp;
@@ -370,6 +441,7 @@ SoftVector *Transceiver::pullRadioVector(GSM::Time &wTime,
       }
     }
     else {
+      ScopedLock lock(mEnergyLock);
       double framesElapsed = rxBurst->getTime()-prevFalseDetectionTime; 
       LOG(DEBUG) << "wTime: " << rxBurst->getTime() << ", pTime: " << prevFalseDetectionTime << ", fElapsed: " << framesElapsed;
       mEnergyThreshold += 10.0F/10.0F*exp(-framesElapsed);
@@ -383,20 +455,25 @@ SoftVector *Transceiver::pullRadioVector(GSM::Time &wTime,
 			      5.0,  // detection threshold
 			      mSamplesPerSymbol,
 			      &amplitude,
-			      &TOA);
+			      &TOA,
+			      mMaxRACHDelay,
+			      corrBuffer[timeslot]);
     if (success) {
       LOG(DEBUG) << "FOUND RACH!!!!!! " << amplitude << " " << TOA;
+      mEnergyLock.lock();
       mEnergyThreshold -= (1.0F/10.0F);
       if (mEnergyThreshold < 0.0) mEnergyThreshold = 0.0;
+      mEnergyLock.unlock();
       channelResponse[timeslot] = NULL; 
     }
     else {
+      ScopedLock lock(mEnergyLock);
       double framesElapsed = rxBurst->getTime()-prevFalseDetectionTime;
       mEnergyThreshold += (1.0F/10.0F)*exp(-framesElapsed);
       prevFalseDetectionTime = rxBurst->getTime();
     }
   }
-  LOG(DEBUG) << "energy Threshold = " << mEnergyThreshold; 
+  LOG(DEBUG) << "energy Threshold = " << energyThreshold; 
 
   // demodulate burst
   SoftVector *burst = NULL;
@@ -428,6 +505,125 @@ SoftVector *Transceiver::pullRadioVector(GSM::Time &wTime,
   return burst;
 }
 
+void Transceiver::demodRxBurst(radioVector *rxBurst, RxResult *result)
+{
+  int RSSI;
+  int TOA;  // in 1/256 of a symbol
+  GSM::Time burstTime;
+
+  SoftVector *burst = demodRadioVector(rxBurst,burstTime,RSSI,TOA);
+
+  result->valid = (burst != NULL);
+  if (!burst) return;
+
+  LOG(DEBUG) << "burst parameters: "
+	<< " time: " << burstTime
+	<< " RSSI: " << RSSI
+	<< " TOA: "  << TOA
+	<< " bits: " << *burst;
+
+  char *burstString = result->data;
+  burstString[0] = burstTime.TN();
+  for (int i = 0; i < 4; i++)
+    burstString[1+i] = (burstTime.FN() >> ((3-i)*8)) & 0x0ff;
+  burstString[5] = RSSI;
+  burstString[6] = (TOA >> 8) & 0x0ff;
+  burstString[7] = TOA & 0x0ff;
+  SoftVector::iterator burstItr = burst->begin();
+
+  for (unsigned int i = 0; i < gSlotLen; i++) {
+    burstString[8+i] =(char) round((*burstItr++)*255.0);
+  }
+  burstString[gSlotLen+9] = '\0';
+  delete burst;
+}
+
+void Transceiver::dispatchRxBursts()
+{
+  while (1) {
+    if (!mPendingRxBurst) {
+      mPendingRxBurst = mReceiveFIFO->get();
+      if (!mPendingRxBurst) return;
+      LOG(DEBUG) << "receiveFIFO: read radio vector at time: " << mPendingRxBurst->getTime() << ", new size: " << mReceiveFIFO->size();
+    }
+
+    // keep the burst until its worker catches up, later bursts wait behind it
+    unsigned index = mPendingRxBurst->getTime().TN() % mNumRxWorkers;
+    RxWorker *worker = mRxWorkers[index];
+    if (worker->inFlight() >= RXWORKER_DEPTH) return;
+
+    worker->dispatch(mPendingRxBurst);
+    mRxOrder[mRxOrderTail++ % (RXWORKER_MAX*RXWORKER_DEPTH)] = index;
+    mPendingRxBurst = NULL;
+  }
+}
+
+void Transceiver::writeRxResults()
+{
+  while (mRxOrderHead != mRxOrderTail) {
+    RxWorker *worker = mRxWorkers[mRxOrder[mRxOrderHead % (RXWORKER_MAX*RXWORKER_DEPTH)]];
+    const RxResult *result = worker->result();
+    if (!result) return;
+    if (result->valid)
+      writeRxBurst(result->data);
+    worker->popResult();
+    mRxOrderHead++;
+  }
+}
+
+void Transceiver::writeRxBurst(const char *data)
+{
+  if (__atomic_load_n(&mDataFormat,__ATOMIC_RELAXED) != 2) {
+    writeData(data,gSlotLen+10);
+    return;
+  }
+
+  // a batch carries the bursts of one frame
+  if (mRxBatchCount && memcmp(mRxBatch+2+1,data+1,4))
+    flushRxBatch();
+  memcpy(mRxBatch+2+mRxBatchCount*BATCH_RX_RECORD,data,BATCH_RX_RECORD);
+  if (++mRxBatchCount == BATCH_MAX_BURSTS)
+    flushRxBatch();
+}
+
+void Transceiver::flushRxBatch()
+{
+  if (!mRxBatchCount) return;
+  mRxBatch[0] = BATCH_MARKER;
+  mRxBatch[1] = mRxBatchCount;
+  writeData(mRxBatch,2+mRxBatchCount*BATCH_RX_RECORD);
+  mRxBatchCount = 0;
+}
+
+int Transceiver::readData()
+{
+  if (!mDataLink.active())
+    return mDataSocket.readBatch(mDataBuffers,mDataLengths,DATA_READ_BATCH);
+
+  // the core may switch interfaces at any time, so never block for long on one
+  while (1) {
+    int numRead;
+    if (__atomic_load_n(&mSharedData,__ATOMIC_ACQUIRE)) {
+      mDataLengths[0] = mDataLink.read(mDataBuffers[0],100);
+      numRead = (mDataLengths[0] < 0) ? -1 : 1;
+    }
+    else
+      numRead = mDataSocket.readBatch(mDataBuffers,mDataLengths,DATA_READ_BATCH,100);
+    if (numRead > 0) return numRead;
+    pthread_testcancel();
+  }
+}
+
+void Transceiver::writeData(const char *buffer, size_t length)
+{
+  if (__atomic_load_n(&mSharedData,__ATOMIC_ACQUIRE)) {
+    if (mDataLink.write(buffer,length) < 0)
+      LOG(WARNING) << "shared memory data ring full, dropping a message";
+  }
+  else
+    mDataSocket.write(buffer,length);
+}
+
 void Transceiver::start()
 {
   mControlServiceLoopThread->start((void * (*)(void*))ControlServiceLoopAdapter,(void*) this);
@@ -488,6 +684,8 @@ void Transceiver::driveControl()
         generateRACHSequence(*gsmPulse,mSamplesPerSymbol);
 
         // Start radio interface threads.
+        for (unsigned i = 0; i < mNumRxWorkers; i++)
+          mRxWorkers[i]->start();
         mFIFOServiceLoopThread->start((void * (*)(void*))FIFOServiceLoopAdapter,(void*) this);
         mTransmitPriorityQueueServiceLoopThread->start((void * (*)(void*))TransmitPriorityQueueServiceLoopAdapter,(void*) this);
         writeClockInterface();
@@ -501,6 +699,7 @@ void Transceiver::driveControl()
     int maxDelay;
     sscanf(buffer,"%3s %s %d",cmdcheck,command,&maxDelay);
     mMaxExpectedDelay = maxDelay; // 1 GSM symbol is approx. 1 km
+    mMaxRACHDelay = gConfig.getNum("GSM.MS.TA.Max",63);
     sprintf(response,"RSP SETMAXDLY 0 %d",maxDelay);
   }
   else if (strcmp(command,"SETRXGAIN")==0) {
@@ -508,7 +707,9 @@ void Transceiver::driveControl()
     int newGain;
     sscanf(buffer,"%3s %s %d",cmdcheck,command,&newGain);
     newGain = mRadioInterface->setRxGain(newGain);
+    mEnergyLock.lock();
     mEnergyThreshold = INIT_ENERGY_THRSHD;
+    mEnergyLock.unlock();
     sprintf(response,"RSP SETRXGAIN 0 %d",newGain);
   }
   else if (strcmp(command,"NOISELEV")==0) {
@@ -581,6 +782,30 @@ void Transceiver::driveControl()
       sprintf(response,"RSP SETTSC 0 %d",TSC);
     }
   }
+  else if (strcmp(command,"SETFORMAT")==0) {
+    // set data socket format, see README.TRXManager
+    int format;
+    sscanf(buffer,"%3s %s %d",cmdcheck,command,&format);
+    if ((format < 1) || (format > 2)) {
+      LOG(ALERT) << "bogus data format " << format;
+      sprintf(response,"RSP SETFORMAT 1 %d",format);
+    }
+    else {
+      __atomic_store_n(&mDataFormat,(unsigned) format,__ATOMIC_RELAXED);
+      sprintf(response,"RSP SETFORMAT 0 %d",format);
+    }
+  }
+  else if (strcmp(command,"SETSHM")==0) {
+    // move the data interface to or from shared memory, see README.TRXManager
+    int shared;
+    sscanf(buffer,"%3s %s %d",cmdcheck,command,&shared);
+    if (shared && !mDataLink.active())
+      sprintf(response,"RSP SETSHM 1 %d",shared);
+    else {
+      __atomic_store_n(&mSharedData,(unsigned) (shared != 0),__ATOMIC_RELEASE);
+      sprintf(response,"RSP SETSHM 0 %d",shared);
+    }
+  }
   else if (strcmp(command,"SETSLOT")==0) {
     // set TSC 
     int  corrCode;
@@ -598,6 +823,7 @@ void Transceiver::driveControl()
   }
   else {
     LOG(WARNING) << "bogus command " << command << " on control interface.";
+    snprintf(response,sizeof(response),"RSP %.80s 1",command);
   }
 
   mControlSocket.write(response,strlen(response)+1);
@@ -607,20 +833,44 @@ void Transceiver::driveControl()
 bool Transceiver::driveTransmitPriorityQueue() 
 {
 
-  char buffer[gSlotLen+50];
+  // check data socket, taking every message waiting
+  int numRead = readData();
+  bool good = true;
+  for (int i = 0; i < numRead; i++)
+    good &= addTxMessage(mDataBuffers[i],mDataLengths[i]);
+  return good && (numRead > 0);
+
+}
 
-  // check data socket
-  size_t msgLen = mDataSocket.read(buffer);
+bool Transceiver::addTxMessage(const char *buffer, size_t msgLen)
+{
+  const unsigned char *rp = (const unsigned char *) buffer;
 
-  if (msgLen!=gSlotLen+1+4+1) {
-    LOG(ERR) << "badly formatted packet on GSM->TRX interface";
-    return false;
+  // format 1, a single burst
+  if ((msgLen==gSlotLen+1+4+1) && (rp[0]!=BATCH_MARKER)) {
+    addTxRecord(rp,false);
+    return true;
   }
 
-  int timeSlot = (int) buffer[0];
+  // format 2, a marker, a burst count and the bursts with packed bits
+  if ((msgLen>=2) && (rp[0]==BATCH_MARKER) && (rp[1]<=BATCH_MAX_BURSTS)
+      && (msgLen==2+rp[1]*BATCH_TX_RECORD)) {
+    for (unsigned i = 0; i < rp[1]; i++)
+      addTxRecord(rp+2+i*BATCH_TX_RECORD,true);
+    return true;
+  }
+
+  LOG(ERR) << "badly formatted packet on GSM->TRX interface";
+  return false;
+
+}
+
+void Transceiver::addTxRecord(const unsigned char *record, bool packed)
+{
+  int timeSlot = (int) record[0];
   uint64_t frameNum = 0;
   for (int i = 0; i < 4; i++)
-    frameNum = (frameNum << 8) | (0x0ff & buffer[i+1]);
+    frameNum = (frameNum << 8) | (0x0ff & record[i+1]);
   
   /*
   if (GSM::Time(frameNum,timeSlot) >  mTransmitDeadlineClock + GSM::Time(51,0)) {
@@ -647,12 +897,16 @@ bool Transceiver::driveTransmitPriorityQueue()
 
   LOG(DEBUG) << "rcvd. burst at: " << GSM::Time(frameNum,timeSlot);
   
-  int RSSI = (int) buffer[5];
+  int RSSI = (int) (signed char) record[5];
   static BitVector newBurst(gSlotLen);
-  BitVector::iterator itr = newBurst.begin();
-  char *bufferItr = buffer+6;
-  while (itr < newBurst.end()) 
-    *itr++ = *bufferItr++;
+  if (packed)
+    newBurst.unpack(record+6);
+  else {
+    BitVector::iterator itr = newBurst.begin();
+    const unsigned char *bufferItr = record+6;
+    while (itr < newBurst.end()) 
+      *itr++ = *bufferItr++;
+  }
   
   GSM::Time currTime = GSM::Time(frameNum,timeSlot);
   
@@ -660,48 +914,33 @@ bool Transceiver::driveTransmitPriorityQueue()
   
   LOG(DEBUG) "added burst - time: " << currTime << ", RSSI: " << RSSI; // << ", data: " << newBurst; 
 
-  return true;
-
-
 }
  
 void Transceiver::driveReceiveFIFO() 
 {
 
-  SoftVector *rxBurst = NULL;
-  int RSSI;
-  int TOA;  // in 1/256 of a symbol
-  GSM::Time burstTime;
-
   mRadioInterface->driveReceiveRadio();
 
-  rxBurst = pullRadioVector(burstTime,RSSI,TOA);
+  if (mNumRxWorkers) {
+    dispatchRxBursts();
+    writeRxResults();
+    // send what is ready rather than hold it for bursts still with the workers
+    flushRxBatch();
+    return;
+  }
 
-  if (rxBurst) { 
+  radioVector *rxBurst = mReceiveFIFO->get();
+  if (!rxBurst) {
+    flushRxBatch();
+    return;
+  }
 
-    LOG(DEBUG) << "burst parameters: "
-	  << " time: " << burstTime
-	  << " RSSI: " << RSSI
-	  << " TOA: "  << TOA
-	  << " bits: " << *rxBurst;
-    
-    char burstString[gSlotLen+10];
-    burstString[0] = burstTime.TN();
-    for (int i = 0; i < 4; i++)
-      burstString[1+i] = (burstTime.FN() >> ((3-i)*8)) & 0x0ff;
-    burstString[5] = RSSI;
-    burstString[6] = (TOA >> 8) & 0x0ff;
-    burstString[7] = TOA & 0x0ff;
-    SoftVector::iterator burstItr = rxBurst->begin();
-
-    for (unsigned int i = 0; i < gSlotLen; i++) {
-      burstString[8+i] =(char) round((*burstItr++)*255.0);
-    }
-    burstString[gSlotLen+9] = '\0';
-    delete rxBurst;
+  LOG(DEBUG) << "receiveFIFO: read radio vector at time: " << rxBurst->getTime() << ", new size: " << mReceiveFIFO->size();
 
-    mDataSocket.write(burstString,gSlotLen+10);
-  }
+  RxResult result;
+  demodRxBurst(rxBurst,&result);
+  if (result.valid)
+    writeRxBurst(result.data);
 
 }
 
@@ -790,6 +1029,22 @@ void *FIFOServiceLoopAdapter(Transceiver *transceiver)
   return NULL;
 }
 
+void *RxWorkerLoopAdapter(RxWorker *worker)
+{
+  worker->mTransceiver->setPriority();
+
+  while (1) {
+    radioVector *rxBurst = worker->mBursts.read(100);
+    if (rxBurst) {
+      RxResult *result = &worker->mResults[worker->mResultTail % RXWORKER_DEPTH];
+      worker->mTransceiver->demodRxBurst(rxBurst,result);
+      __atomic_store_n(&worker->mResultTail,worker->mResultTail+1,__ATOMIC_RELEASE);
+    }
+    pthread_testcancel();
+  }
+  return NULL;
+}
+
 void *ControlServiceLoopAdapter(Transceiver *transceiver)
 {
   while (1) {
@@ -30,9 +30,11 @@
 */
 
 #include "radioInterface.h"
+#include "burstCache.h"
 #include "Interthread.h"
 #include "GSMCommon.h"
 #include "Sockets.h"
+#include "SharedMemory.h"
 
 #include <sys/types.h>
 #include <sys/socket.h>
@@ -40,6 +42,76 @@
 /** Define this to be the slot number to be logged. */
 //#define TRANSMIT_LOGGING 1
 
+/** Maximum number of receive workers, one per timeslot */
+#define RXWORKER_MAX		8
+
+/** Bursts a receive worker may hold, from dispatch until written to the data socket */
+#define RXWORKER_DEPTH		32
+
+/**@name Data socket format 2, selected with SETFORMAT, see README.TRXManager. */
+//@{
+#define BATCH_MARKER		0x82			///< first byte of a batch, never a timeslot index
+#define BATCH_MAX_BURSTS	8			///< most bursts in one batch
+#define BATCH_TX_RECORD		(6+(gSlotLen+7)/8)	///< a downlink burst, bits packed MSB first
+#define BATCH_RX_RECORD		(8+gSlotLen)		///< an uplink burst, 8-bit soft bits
+//@}
+
+/** Most messages from the GSM core taken per read of the data interface */
+#define DATA_READ_BATCH		16
+
+class Transceiver;
+
+/** A demodulated burst, formatted for the data socket */
+typedef struct {
+  bool valid;                          ///< false if nothing was detected
+  char data[gSlotLen+10];              ///< the data socket message
+} RxResult;
+
+/**
+  A thread demodulating the received bursts of a fixed set of timeslots.
+
+  Bursts of one timeslot always go to the same worker, so the per-timeslot
+  channel estimates and equalizers are only touched by that worker.
+  Bursts arrive on a VectorFIFO from the FIFO service thread and results
+  go back through a ring of the same depth, both single producer and
+  single consumer. The FIFO service thread bounds the bursts in flight per
+  worker to RXWORKER_DEPTH, so neither ring can overflow.
+*/
+class RxWorker {
+
+private:
+
+  Transceiver *mTransceiver;           ///< the transceiver demodulating for this worker
+  Thread mThread;                      ///< the worker thread
+  VectorFIFO mBursts;                  ///< bursts to demodulate
+  RxResult mResults[RXWORKER_DEPTH];   ///< demodulated bursts, oldest at mResultHead
+  unsigned mResultHead;                ///< next result to write, FIFO service thread owned
+  unsigned mResultTail;                ///< next result to fill, worker owned
+  unsigned mDispatched;                ///< bursts dispatched so far, FIFO service thread owned
+
+public:
+
+  RxWorker(Transceiver *wTransceiver);
+
+  /** start the worker thread */
+  void start();
+
+  /** bursts dispatched and not yet written out */
+  unsigned inFlight() const { return mDispatched - mResultHead; }
+
+  /** FIFO service thread side: hand over a burst */
+  void dispatch(radioVector *rxBurst);
+
+  /** FIFO service thread side: the oldest result, or NULL if not ready */
+  const RxResult *result();
+
+  /** FIFO service thread side: release the oldest result */
+  void popResult() { __atomic_store_n(&mResultHead, mResultHead+1, __ATOMIC_RELEASE); }
+
+  friend void *RxWorkerLoopAdapter(RxWorker *);
+
+};
+
 /** The Transceiver class, responsible for physical layer of basestation */
 class Transceiver {
   
@@ -49,6 +121,10 @@ private:
   GSM::Time mLatencyUpdateTime;   ///< last time latency was updated
 
   UDPSocket mDataSocket;	  ///< socket for writing to/reading from GSM core
+  SharedMemoryLink mDataLink;     ///< shared memory alternative to mDataSocket, if configured
+  unsigned mSharedData;           ///< set while the GSM core uses mDataLink, see SETSHM
+  char mDataBuffers[DATA_READ_BATCH][MAX_UDP_LENGTH]; ///< messages from the last readData()
+  int mDataLengths[DATA_READ_BATCH]; ///< lengths of the messages in mDataBuffers
   UDPSocket mControlSocket;	  ///< socket for writing/reading control commands from GSM core
   UDPSocket mClockSocket;	  ///< socket for writing clock updates to GSM core
 
@@ -104,10 +180,44 @@ private:
   /** Push modulated burst into transmit FIFO corresponding to a particular timestamp */
   void pushRadioVector(GSM::Time &nowTime);
 
-  /** Pull and demodulate a burst from the receive FIFO */ 
-  SoftVector *pullRadioVector(GSM::Time &wTime,
-			   int &RSSI,
-			   int &timingOffset);
+  /** Demodulate and delete a burst pulled from the receive FIFO */ 
+  SoftVector *demodRadioVector(radioVector *rxBurst,
+			       GSM::Time &wTime,
+			       int &RSSI,
+			       int &timingOffset);
+
+  /** Demodulate and delete a received burst, formatting it as a data socket message */
+  void demodRxBurst(radioVector *rxBurst, RxResult *result);
+
+  /** Hand received bursts to the workers of their timeslots */
+  void dispatchRxBursts();
+
+  /** Write finished bursts to the data socket in the order they were received */
+  void writeRxResults();
+
+  /** Write a data socket message of a received burst, or add it to the batch */
+  void writeRxBurst(const char *data);
+
+  /** Send the pending batch of received bursts, if any */
+  void flushRxBatch();
+
+  /**
+    Read the messages waiting from the GSM core on the data interface in use
+    @return the number of messages, in mDataBuffers and mDataLengths
+  */
+  int readData();
+
+  /**
+    Queue the bursts of one message from the GSM core
+    @return false if the message is badly formatted
+  */
+  bool addTxMessage(const char *buffer, size_t msgLen);
+
+  /** Write a message to the GSM core on the data interface in use */
+  void writeData(const char *buffer, size_t length);
+
+  /** Modulate and queue one downlink burst record of either data format */
+  void addTxRecord(const unsigned char *record, bool packed);
    
   /** Set modulus for specific timeslot */
   void setModulus(int timeslot);
@@ -119,6 +229,7 @@ private:
   void writeClockInterface(void);
 
   signalVector *gsmPulse;              ///< the GSM shaping pulse for modulation
+  BurstCache mBurstCache;              ///< recently modulated transmit bursts
 
   int mSamplesPerSymbol;               ///< number of samples per GSM symbol
 
@@ -130,9 +241,11 @@ private:
   unsigned mTSC;                       ///< the midamble sequence code
   double mEnergyThreshold;             ///< threshold to determine if received data is potentially a GSM burst
   GSM::Time prevFalseDetectionTime;    ///< last timestamp of a false energy detection
+  Mutex mEnergyLock;                   ///< protects the threshold and false detection time across receive workers
   int fillerModulus[8];                ///< modulus values of all timeslots, in frames
   signalVector *fillerTable[102][8];   ///< table of modulated filler waveforms for all timeslots
   unsigned mMaxExpectedDelay;            ///< maximum expected time-of-arrival offset in GSM symbols
+  unsigned mMaxRACHDelay;              ///< GSM.MS.TA.Max, the RACH time-of-arrival search window in GSM symbols
 
   GSM::Time    channelEstimateTime[8]; ///< last timestamp of each timeslot's channel estimate
   signalVector *channelResponse[8];    ///< most recent channel estimate of all timeslots
@@ -141,6 +254,18 @@ private:
   signalVector *DFEFeedback[8];        ///< most recent DFE feedback filter of all timeslots
   float        chanRespOffset[8];      ///< most recent timing offset, e.g. TOA, of all timeslots
   complex      chanRespAmplitude[8];   ///< most recent channel amplitude of all timeslots
+  signalVector *corrBuffer[8];         ///< preallocated correlator output of all timeslots
+
+  unsigned mNumRxWorkers;              ///< number of receive workers, 0 to demodulate on the FIFO service thread
+  RxWorker *mRxWorkers[RXWORKER_MAX];  ///< receive workers, timeslot TN goes to worker TN % mNumRxWorkers
+  unsigned char mRxOrder[RXWORKER_MAX*RXWORKER_DEPTH]; ///< worker of each burst in flight, in order of reception
+  unsigned mRxOrderHead;               ///< oldest burst in flight
+  unsigned mRxOrderTail;               ///< next free entry of mRxOrder
+  radioVector *mPendingRxBurst;        ///< burst waiting for its worker to have room
+
+  unsigned mDataFormat;                ///< 1 for one burst per datagram, 2 for batches
+  char mRxBatch[2+BATCH_MAX_BURSTS*BATCH_RX_RECORD]; ///< received bursts not yet sent, FIFO service thread owned
+  unsigned mRxBatchCount;              ///< bursts in mRxBatch
 
 public:
 
@@ -192,6 +317,8 @@ protected:
 
   friend void *TransmitPriorityQueueServiceLoopAdapter(Transceiver *);
 
+  friend void *RxWorkerLoopAdapter(RxWorker *);
+
   void reset();
 
   /** set priority on current thread */
@@ -208,3 +335,6 @@ void *ControlServiceLoopAdapter(Transceiver *);
 /** transmit queueing thread loop */
 void *TransmitPriorityQueueServiceLoopAdapter(Transceiver *);
 
+/** receive worker thread loop */
+void *RxWorkerLoopAdapter(RxWorker *);
+
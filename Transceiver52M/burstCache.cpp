@@ -0,0 +1,112 @@
+/*
+ * Cache of modulated transmit bursts
+ *
+ * Copyright 2011 Free Software Foundation, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * See the COPYING file in the main directory for details.
+ */
+
+#include <string.h>
+
+#include "burstCache.h"
+#include <Logger.h>
+
+/* Lookups between hit rate reports */
+#define REPORT_INTERVAL   100000
+
+BurstCache::BurstCache(unsigned wSize)
+	: mSize(wSize), mHits(0), mMisses(0)
+{
+	mEntries = new Entry[mSize];
+	for (unsigned i = 0; i < mSize; i++)
+		mEntries[i].burst = NULL;
+}
+
+BurstCache::~BurstCache()
+{
+	clear();
+	delete[] mEntries;
+}
+
+void BurstCache::clear()
+{
+	for (unsigned i = 0; i < mSize; i++) {
+		delete mEntries[i].burst;
+		mEntries[i].burst = NULL;
+	}
+}
+
+/* FNV-1a over the bits and the modulation parameters */
+unsigned BurstCache::hash(const BitVector &bits, int guardPeriodLength,
+			  int samplesPerSymbol, float scale) const
+{
+	unsigned h = 2166136261U;
+
+	for (size_t i = 0; i < bits.size(); i++)
+		h = (h ^ (unsigned char) (bits[i] & 0x01)) * 16777619U;
+
+	unsigned params[3];
+	params[0] = guardPeriodLength;
+	params[1] = samplesPerSymbol;
+	memcpy(&params[2], &scale, sizeof(float));
+	for (int i = 0; i < 3; i++)
+		h = (h ^ params[i]) * 16777619U;
+
+	return h;
+}
+
+const signalVector *BurstCache::get(const BitVector &bits,
+				    int guardPeriodLength,
+				    int samplesPerSymbol, float scale)
+{
+	unsigned h = hash(bits, guardPeriodLength, samplesPerSymbol, scale);
+	Entry &entry = mEntries[h % mSize];
+
+	if ((mHits + mMisses) % REPORT_INTERVAL == REPORT_INTERVAL - 1) {
+		LOG(INFO) << "burst cache hits " << mHits << ", misses " << mMisses;
+	}
+
+	if (entry.burst && (entry.hash == h) &&
+	    (entry.guardPeriodLength == guardPeriodLength) &&
+	    (entry.samplesPerSymbol == samplesPerSymbol) &&
+	    (entry.scale == scale) &&
+	    (entry.bits.size() == bits.size()) &&
+	    !memcmp(entry.bits.begin(), bits.begin(), bits.size())) {
+		mHits++;
+		return entry.burst;
+	}
+
+	mMisses++;
+	return NULL;
+}
+
+const signalVector *BurstCache::put(const BitVector &bits,
+				    int guardPeriodLength,
+				    int samplesPerSymbol, float scale,
+				    signalVector *burst)
+{
+	unsigned h = hash(bits, guardPeriodLength, samplesPerSymbol, scale);
+	Entry &entry = mEntries[h % mSize];
+
+	delete entry.burst;
+	entry.bits.clone(bits);
+	entry.guardPeriodLength = guardPeriodLength;
+	entry.samplesPerSymbol = samplesPerSymbol;
+	entry.scale = scale;
+	entry.hash = h;
+	entry.burst = burst;
+
+	return burst;
+}
@@ -0,0 +1,84 @@
+/*
+ * Cache of modulated transmit bursts
+ *
+ * Copyright 2011 Free Software Foundation, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * See the COPYING file in the main directory for details.
+ */
+
+#ifndef BURSTCACHE_H
+#define BURSTCACHE_H
+
+#include "sigProcLib.h"
+
+/**
+	Bounded, direct-mapped cache of modulated and scaled bursts.
+
+	Most downlink bursts repeat from multiframe to multiframe (FCCH, SCH,
+	system information and idle fill), so their waveforms can be reused
+	instead of modulated again. Entries are keyed by the burst bits, the
+	guard period, the samples per symbol and the output scaling. A new
+	burst that maps onto an occupied slot evicts the old one.
+
+	The cache is not locked; use it from a single thread.
+*/
+class BurstCache {
+public:
+	/** @param wSize The number of cache slots. */
+	BurstCache(unsigned wSize = 1024);
+	~BurstCache();
+
+	/**
+		Look up a modulated burst.
+		@return The cached waveform, owned by the cache, or NULL on a miss.
+	*/
+	const signalVector *get(const BitVector &bits, int guardPeriodLength,
+				int samplesPerSymbol, float scale);
+
+	/**
+		Store a modulated burst, replacing whatever used its slot.
+		@param burst The waveform, the cache takes ownership.
+		@return The stored waveform.
+	*/
+	const signalVector *put(const BitVector &bits, int guardPeriodLength,
+				int samplesPerSymbol, float scale,
+				signalVector *burst);
+
+	/** Drop all entries */
+	void clear();
+
+	unsigned long hits() const { return mHits; }
+	unsigned long misses() const { return mMisses; }
+
+private:
+	struct Entry {
+		BitVector bits;
+		int guardPeriodLength;
+		int samplesPerSymbol;
+		float scale;
+		unsigned hash;
+		signalVector *burst;
+	};
+
+	unsigned hash(const BitVector &bits, int guardPeriodLength,
+		      int samplesPerSymbol, float scale) const;
+
+	Entry *mEntries;              ///< cache slots, empty when burst is NULL
+	unsigned mSize;               ///< number of cache slots
+	unsigned long mHits;          ///< lookups that found the burst
+	unsigned long mMisses;        ///< lookups that did not
+};
+
+#endif /* BURSTCACHE_H */
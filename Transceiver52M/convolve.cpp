@@ -0,0 +1,754 @@
+/*
+ * Vectorized convolution engine
+ *
+ * Copyright 2011 Free Software Foundation, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * See the COPYING file in the main directory for details.
+ */
+
+#include "convolve.h"
+#include <Logger.h>
+
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+  #define HAVE_X86_KERNELS 1
+  #include <immintrin.h>
+  #define TARGET_SSE2 __attribute__((target("sse2")))
+  #define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+/*
+ * Steady state kernels
+ *
+ * Every kernel computes n outputs where all of the taps overlap the data,
+ * so the inner loops carry no bounds checks. The data pointer a refers to
+ * the sample aligned with tap 0 of the first output, i.e. output k is
+ *
+ *     c[k] = sum_{j=0}^{Lb-1} a[k-j] * b[j]
+ *
+ * Vectors are interleaved complex floats. Each output is accumulated tap by
+ * tap in the same order as the original scalar loop, and the SIMD kernels
+ * evaluate the same products, so results match the scalar path exactly
+ * unless the compiler contracts multiplies and adds.
+ */
+typedef void (*ConvKernel)(const float *a, const float *b, int Lb,
+			   float *c, int n);
+
+/*
+ * Inner product kernels
+ *
+ * Single output c = sum_{j=0}^{len-1} a[j] * b[j] with both vectors running
+ * forward, vectorized across taps instead of across outputs.
+ */
+typedef void (*DotKernel)(const float *a, const float *b, int len, float *c);
+
+struct ConvKernels {
+	ConvolveImpl impl;
+	ConvKernel realTaps;
+	ConvKernel realData;
+	ConvKernel cmplx;
+	ConvKernel symRealTaps;
+	ConvKernel symCmplx;
+	DotKernel dotRealTaps;
+};
+
+/* Complex data, real taps */
+static void convRealTapsScalar(const float *a, const float *b, int Lb,
+			       float *c, int n)
+{
+	for (int k = 0; k < n; k++) {
+		float sr = 0.0f, si = 0.0f;
+		const float *aP = a + 2 * k;
+		for (int j = 0; j < Lb; j++) {
+			sr += aP[-2 * j + 0] * b[2 * j];
+			si += aP[-2 * j + 1] * b[2 * j];
+		}
+		c[2 * k + 0] = sr;
+		c[2 * k + 1] = si;
+	}
+}
+
+/* Real data, complex taps */
+static void convRealDataScalar(const float *a, const float *b, int Lb,
+			       float *c, int n)
+{
+	for (int k = 0; k < n; k++) {
+		float sr = 0.0f, si = 0.0f;
+		const float *aP = a + 2 * k;
+		for (int j = 0; j < Lb; j++) {
+			sr += b[2 * j + 0] * aP[-2 * j];
+			si += b[2 * j + 1] * aP[-2 * j];
+		}
+		c[2 * k + 0] = sr;
+		c[2 * k + 1] = si;
+	}
+}
+
+/* Complex data, complex taps */
+static void convComplexScalar(const float *a, const float *b, int Lb,
+			      float *c, int n)
+{
+	for (int k = 0; k < n; k++) {
+		float sr = 0.0f, si = 0.0f;
+		const float *aP = a + 2 * k;
+		for (int j = 0; j < Lb; j++) {
+			float ar = aP[-2 * j + 0], ai = aP[-2 * j + 1];
+			float br = b[2 * j + 0], bi = b[2 * j + 1];
+			sr += ar * br - ai * bi;
+			si += ar * bi + ai * br;
+		}
+		c[2 * k + 0] = sr;
+		c[2 * k + 1] = si;
+	}
+}
+
+/* Complex data, real symmetric taps folded about the midpoint */
+static void convSymRealTapsScalar(const float *a, const float *b, int Lb,
+				  float *c, int n)
+{
+	int half = Lb / 2;
+
+	for (int k = 0; k < n; k++) {
+		float sr = 0.0f, si = 0.0f;
+		const float *aP = a + 2 * k;
+		const float *aPsym = aP - 2 * (Lb - 1);
+		for (int j = 0; j < half; j++) {
+			float h = b[2 * j];
+			sr += (aP[-2 * j + 0] + aPsym[2 * j + 0]) * h;
+			si += (aP[-2 * j + 1] + aPsym[2 * j + 1]) * h;
+		}
+		if (Lb % 2) {
+			sr += aP[-2 * half + 0] * b[2 * half];
+			si += aP[-2 * half + 1] * b[2 * half];
+		}
+		c[2 * k + 0] = sr;
+		c[2 * k + 1] = si;
+	}
+}
+
+/* Complex data, complex symmetric taps folded about the midpoint */
+static void convSymComplexScalar(const float *a, const float *b, int Lb,
+				 float *c, int n)
+{
+	int half = Lb / 2;
+
+	for (int k = 0; k < n; k++) {
+		float sr = 0.0f, si = 0.0f;
+		const float *aP = a + 2 * k;
+		const float *aPsym = aP - 2 * (Lb - 1);
+		for (int j = 0; j < half; j++) {
+			float xr = aP[-2 * j + 0] + aPsym[2 * j + 0];
+			float xi = aP[-2 * j + 1] + aPsym[2 * j + 1];
+			float br = b[2 * j + 0], bi = b[2 * j + 1];
+			sr += xr * br - xi * bi;
+			si += xr * bi + xi * br;
+		}
+		if (Lb % 2) {
+			float xr = aP[-2 * half + 0], xi = aP[-2 * half + 1];
+			float br = b[2 * half + 0], bi = b[2 * half + 1];
+			sr += xr * br - xi * bi;
+			si += xr * bi + xi * br;
+		}
+		c[2 * k + 0] = sr;
+		c[2 * k + 1] = si;
+	}
+}
+
+/* Complex data, real taps inner product */
+static void dotRealTapsScalar(const float *a, const float *b, int len,
+			      float *c)
+{
+	float sr = 0.0f, si = 0.0f;
+
+	for (int j = 0; j < len; j++) {
+		sr += a[2 * j + 0] * b[2 * j];
+		si += a[2 * j + 1] * b[2 * j];
+	}
+	c[0] = sr;
+	c[1] = si;
+}
+
+static const ConvKernels scalarKernels = {
+	CONVOLVE_SCALAR,
+	convRealTapsScalar,
+	convRealDataScalar,
+	convComplexScalar,
+	convSymRealTapsScalar,
+	convSymComplexScalar,
+	dotRealTapsScalar,
+};
+
+#ifdef HAVE_X86_KERNELS
+
+/*
+ * SSE2 kernels
+ *
+ * Outputs are computed four at a time in two registers of two complex
+ * samples each, so that every tap is loaded and broadcast once per block.
+ * Leftover outputs go through the scalar kernels.
+ */
+TARGET_SSE2
+static inline __m128 sseComplexMul(__m128 x, const float *b)
+{
+	__m128 br = _mm_set1_ps(b[0]);
+	__m128 bi = _mm_set_ps(b[1], -b[1], b[1], -b[1]);
+	__m128 xs = _mm_shuffle_ps(x, x, _MM_SHUFFLE(2, 3, 0, 1));
+
+	return _mm_add_ps(_mm_mul_ps(x, br), _mm_mul_ps(xs, bi));
+}
+
+TARGET_SSE2
+static void convRealTapsSSE2(const float *a, const float *b, int Lb,
+			     float *c, int n)
+{
+	int k = 0;
+
+	for (; k + 4 <= n; k += 4) {
+		__m128 acc0 = _mm_setzero_ps();
+		__m128 acc1 = _mm_setzero_ps();
+		const float *aP = a + 2 * k;
+		for (int j = 0; j < Lb; j++) {
+			__m128 h = _mm_set1_ps(b[2 * j]);
+			acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(aP - 2 * j), h));
+			acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(aP - 2 * j + 4), h));
+		}
+		_mm_storeu_ps(c + 2 * k, acc0);
+		_mm_storeu_ps(c + 2 * k + 4, acc1);
+	}
+
+	convRealTapsScalar(a + 2 * k, b, Lb, c + 2 * k, n - k);
+}
+
+TARGET_SSE2
+static void convRealDataSSE2(const float *a, const float *b, int Lb,
+			     float *c, int n)
+{
+	int k = 0;
+
+	for (; k + 4 <= n; k += 4) {
+		__m128 acc0 = _mm_setzero_ps();
+		__m128 acc1 = _mm_setzero_ps();
+		const float *aP = a + 2 * k;
+		for (int j = 0; j < Lb; j++) {
+			__m128 bv = _mm_castpd_ps(_mm_load1_pd((const double *) (b + 2 * j)));
+			__m128 x0 = _mm_loadu_ps(aP - 2 * j);
+			__m128 x1 = _mm_loadu_ps(aP - 2 * j + 4);
+			x0 = _mm_shuffle_ps(x0, x0, _MM_SHUFFLE(2, 2, 0, 0));
+			x1 = _mm_shuffle_ps(x1, x1, _MM_SHUFFLE(2, 2, 0, 0));
+			acc0 = _mm_add_ps(acc0, _mm_mul_ps(bv, x0));
+			acc1 = _mm_add_ps(acc1, _mm_mul_ps(bv, x1));
+		}
+		_mm_storeu_ps(c + 2 * k, acc0);
+		_mm_storeu_ps(c + 2 * k + 4, acc1);
+	}
+
+	convRealDataScalar(a + 2 * k, b, Lb, c + 2 * k, n - k);
+}
+
+TARGET_SSE2
+static void convComplexSSE2(const float *a, const float *b, int Lb,
+			    float *c, int n)
+{
+	int k = 0;
+
+	for (; k + 4 <= n; k += 4) {
+		__m128 acc0 = _mm_setzero_ps();
+		__m128 acc1 = _mm_setzero_ps();
+		const float *aP = a + 2 * k;
+		for (int j = 0; j < Lb; j++) {
+			acc0 = _mm_add_ps(acc0, sseComplexMul(_mm_loadu_ps(aP - 2 * j), b + 2 * j));
+			acc1 = _mm_add_ps(acc1, sseComplexMul(_mm_loadu_ps(aP - 2 * j + 4), b + 2 * j));
+		}
+		_mm_storeu_ps(c + 2 * k, acc0);
+		_mm_storeu_ps(c + 2 * k + 4, acc1);
+	}
+
+	convComplexScalar(a + 2 * k, b, Lb, c + 2 * k, n - k);
+}
+
+TARGET_SSE2
+static void convSymRealTapsSSE2(const float *a, const float *b, int Lb,
+				float *c, int n)
+{
+	int k = 0;
+	int half = Lb / 2;
+
+	for (; k + 4 <= n; k += 4) {
+		__m128 acc0 = _mm_setzero_ps();
+		__m128 acc1 = _mm_setzero_ps();
+		const float *aP = a + 2 * k;
+		const float *aPsym = aP - 2 * (Lb - 1);
+		for (int j = 0; j < half; j++) {
+			__m128 h = _mm_set1_ps(b[2 * j]);
+			__m128 x0 = _mm_add_ps(_mm_loadu_ps(aP - 2 * j),
+					       _mm_loadu_ps(aPsym + 2 * j));
+			__m128 x1 = _mm_add_ps(_mm_loadu_ps(aP - 2 * j + 4),
+					       _mm_loadu_ps(aPsym + 2 * j + 4));
+			acc0 = _mm_add_ps(acc0, _mm_mul_ps(x0, h));
+			acc1 = _mm_add_ps(acc1, _mm_mul_ps(x1, h));
+		}
+		if (Lb % 2) {
+			__m128 h = _mm_set1_ps(b[2 * half]);
+			acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(aP - 2 * half), h));
+			acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(aP - 2 * half + 4), h));
+		}
+		_mm_storeu_ps(c + 2 * k, acc0);
+		_mm_storeu_ps(c + 2 * k + 4, acc1);
+	}
+
+	convSymRealTapsScalar(a + 2 * k, b, Lb, c + 2 * k, n - k);
+}
+
+TARGET_SSE2
+static void convSymComplexSSE2(const float *a, const float *b, int Lb,
+			       float *c, int n)
+{
+	int k = 0;
+	int half = Lb / 2;
+
+	for (; k + 4 <= n; k += 4) {
+		__m128 acc0 = _mm_setzero_ps();
+		__m128 acc1 = _mm_setzero_ps();
+		const float *aP = a + 2 * k;
+		const float *aPsym = aP - 2 * (Lb - 1);
+		for (int j = 0; j < half; j++) {
+			__m128 x0 = _mm_add_ps(_mm_loadu_ps(aP - 2 * j),
+					       _mm_loadu_ps(aPsym + 2 * j));
+			__m128 x1 = _mm_add_ps(_mm_loadu_ps(aP - 2 * j + 4),
+					       _mm_loadu_ps(aPsym + 2 * j + 4));
+			acc0 = _mm_add_ps(acc0, sseComplexMul(x0, b + 2 * j));
+			acc1 = _mm_add_ps(acc1, sseComplexMul(x1, b + 2 * j));
+		}
+		if (Lb % 2) {
+			acc0 = _mm_add_ps(acc0, sseComplexMul(_mm_loadu_ps(aP - 2 * half), b + 2 * half));
+			acc1 = _mm_add_ps(acc1, sseComplexMul(_mm_loadu_ps(aP - 2 * half + 4), b + 2 * half));
+		}
+		_mm_storeu_ps(c + 2 * k, acc0);
+		_mm_storeu_ps(c + 2 * k + 4, acc1);
+	}
+
+	convSymComplexScalar(a + 2 * k, b, Lb, c + 2 * k, n - k);
+}
+
+TARGET_SSE2
+static void dotRealTapsSSE2(const float *a, const float *b, int len,
+			    float *c)
+{
+	__m128 acc0 = _mm_setzero_ps();
+	__m128 acc1 = _mm_setzero_ps();
+	int j = 0;
+
+	for (; j + 4 <= len; j += 4) {
+		__m128 h0 = _mm_loadu_ps(b + 2 * j);
+		__m128 h1 = _mm_loadu_ps(b + 2 * j + 4);
+		h0 = _mm_shuffle_ps(h0, h0, _MM_SHUFFLE(2, 2, 0, 0));
+		h1 = _mm_shuffle_ps(h1, h1, _MM_SHUFFLE(2, 2, 0, 0));
+		acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(a + 2 * j), h0));
+		acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(a + 2 * j + 4), h1));
+	}
+
+	float sum[4];
+	_mm_storeu_ps(sum, _mm_add_ps(acc0, acc1));
+	dotRealTapsScalar(a + 2 * j, b + 2 * j, len - j, c);
+	c[0] += sum[0] + sum[2];
+	c[1] += sum[1] + sum[3];
+}
+
+static const ConvKernels sse2Kernels = {
+	CONVOLVE_SSE2,
+	convRealTapsSSE2,
+	convRealDataSSE2,
+	convComplexSSE2,
+	convSymRealTapsSSE2,
+	convSymComplexSSE2,
+	dotRealTapsSSE2,
+};
+
+/*
+ * AVX2 kernels
+ *
+ * Same structure as the SSE2 kernels with eight outputs per block.
+ */
+TARGET_AVX2
+static inline __m256 avxComplexMul(__m256 x, const float *b)
+{
+	__m256 br = _mm256_set1_ps(b[0]);
+	__m256 bi = _mm256_set_ps(b[1], -b[1], b[1], -b[1],
+				  b[1], -b[1], b[1], -b[1]);
+	__m256 xs = _mm256_permute_ps(x, _MM_SHUFFLE(2, 3, 0, 1));
+
+	return _mm256_add_ps(_mm256_mul_ps(x, br), _mm256_mul_ps(xs, bi));
+}
+
+TARGET_AVX2
+static void convRealTapsAVX2(const float *a, const float *b, int Lb,
+			     float *c, int n)
+{
+	int k = 0;
+
+	for (; k + 8 <= n; k += 8) {
+		__m256 acc0 = _mm256_setzero_ps();
+		__m256 acc1 = _mm256_setzero_ps();
+		const float *aP = a + 2 * k;
+		for (int j = 0; j < Lb; j++) {
+			__m256 h = _mm256_set1_ps(b[2 * j]);
+			acc0 = _mm256_add_ps(acc0, _mm256_mul_ps(_mm256_loadu_ps(aP - 2 * j), h));
+			acc1 = _mm256_add_ps(acc1, _mm256_mul_ps(_mm256_loadu_ps(aP - 2 * j + 8), h));
+		}
+		_mm256_storeu_ps(c + 2 * k, acc0);
+		_mm256_storeu_ps(c + 2 * k + 8, acc1);
+	}
+
+	convRealTapsScalar(a + 2 * k, b, Lb, c + 2 * k, n - k);
+}
+
+TARGET_AVX2
+static void convRealDataAVX2(const float *a, const float *b, int Lb,
+			     float *c, int n)
+{
+	int k = 0;
+
+	for (; k + 8 <= n; k += 8) {
+		__m256 acc0 = _mm256_setzero_ps();
+		__m256 acc1 = _mm256_setzero_ps();
+		const float *aP = a + 2 * k;
+		for (int j = 0; j < Lb; j++) {
+			__m256 bv = _mm256_castpd_ps(_mm256_broadcast_sd((const double *) (b + 2 * j)));
+			__m256 x0 = _mm256_moveldup_ps(_mm256_loadu_ps(aP - 2 * j));
+			__m256 x1 = _mm256_moveldup_ps(_mm256_loadu_ps(aP - 2 * j + 8));
+			acc0 = _mm256_add_ps(acc0, _mm256_mul_ps(bv, x0));
+			acc1 = _mm256_add_ps(acc1, _mm256_mul_ps(bv, x1));
+		}
+		_mm256_storeu_ps(c + 2 * k, acc0);
+		_mm256_storeu_ps(c + 2 * k + 8, acc1);
+	}
+
+	convRealDataScalar(a + 2 * k, b, Lb, c + 2 * k, n - k);
+}
+
+TARGET_AVX2
+static void convComplexAVX2(const float *a, const float *b, int Lb,
+			    float *c, int n)
+{
+	int k = 0;
+
+	for (; k + 8 <= n; k += 8) {
+		__m256 acc0 = _mm256_setzero_ps();
+		__m256 acc1 = _mm256_setzero_ps();
+		const float *aP = a + 2 * k;
+		for (int j = 0; j < Lb; j++) {
+			acc0 = _mm256_add_ps(acc0, avxComplexMul(_mm256_loadu_ps(aP - 2 * j), b + 2 * j));
+			acc1 = _mm256_add_ps(acc1, avxComplexMul(_mm256_loadu_ps(aP - 2 * j + 8), b + 2 * j));
+		}
+		_mm256_storeu_ps(c + 2 * k, acc0);
+		_mm256_storeu_ps(c + 2 * k + 8, acc1);
+	}
+
+	convComplexScalar(a + 2 * k, b, Lb, c + 2 * k, n - k);
+}
+
+TARGET_AVX2
+static void convSymRealTapsAVX2(const float *a, const float *b, int Lb,
+				float *c, int n)
+{
+	int k = 0;
+	int half = Lb / 2;
+
+	for (; k + 8 <= n; k += 8) {
+		__m256 acc0 = _mm256_setzero_ps();
+		__m256 acc1 = _mm256_setzero_ps();
+		const float *aP = a + 2 * k;
+		const float *aPsym = aP - 2 * (Lb - 1);
+		for (int j = 0; j < half; j++) {
+			__m256 h = _mm256_set1_ps(b[2 * j]);
+			__m256 x0 = _mm256_add_ps(_mm256_loadu_ps(aP - 2 * j),
+						  _mm256_loadu_ps(aPsym + 2 * j));
+			__m256 x1 = _mm256_add_ps(_mm256_loadu_ps(aP - 2 * j + 8),
+						  _mm256_loadu_ps(aPsym + 2 * j + 8));
+			acc0 = _mm256_add_ps(acc0, _mm256_mul_ps(x0, h));
+			acc1 = _mm256_add_ps(acc1, _mm256_mul_ps(x1, h));
+		}
+		if (Lb % 2) {
+			__m256 h = _mm256_set1_ps(b[2 * half]);
+			acc0 = _mm256_add_ps(acc0, _mm256_mul_ps(_mm256_loadu_ps(aP - 2 * half), h));
+			acc1 = _mm256_add_ps(acc1, _mm256_mul_ps(_mm256_loadu_ps(aP - 2 * half + 8), h));
+		}
+		_mm256_storeu_ps(c + 2 * k, acc0);
+		_mm256_storeu_ps(c + 2 * k + 8, acc1);
+	}
+
+	convSymRealTapsScalar(a + 2 * k, b, Lb, c + 2 * k, n - k);
+}
+
+TARGET_AVX2
+static void convSymComplexAVX2(const float *a, const float *b, int Lb,
+			       float *c, int n)
+{
+	int k = 0;
+	int half = Lb / 2;
+
+	for (; k + 8 <= n; k += 8) {
+		__m256 acc0 = _mm256_setzero_ps();
+		__m256 acc1 = _mm256_setzero_ps();
+		const float *aP = a + 2 * k;
+		const float *aPsym = aP - 2 * (Lb - 1);
+		for (int j = 0; j < half; j++) {
+			__m256 x0 = _mm256_add_ps(_mm256_loadu_ps(aP - 2 * j),
+						  _mm256_loadu_ps(aPsym + 2 * j));
+			__m256 x1 = _mm256_add_ps(_mm256_loadu_ps(aP - 2 * j + 8),
+						  _mm256_loadu_ps(aPsym + 2 * j + 8));
+			acc0 = _mm256_add_ps(acc0, avxComplexMul(x0, b + 2 * j));
+			acc1 = _mm256_add_ps(acc1, avxComplexMul(x1, b + 2 * j));
+		}
+		if (Lb % 2) {
+			acc0 = _mm256_add_ps(acc0, avxComplexMul(_mm256_loadu_ps(aP - 2 * half), b + 2 * half));
+			acc1 = _mm256_add_ps(acc1, avxComplexMul(_mm256_loadu_ps(aP - 2 * half + 8), b + 2 * half));
+		}
+		_mm256_storeu_ps(c + 2 * k, acc0);
+		_mm256_storeu_ps(c + 2 * k + 8, acc1);
+	}
+
+	convSymComplexScalar(a + 2 * k, b, Lb, c + 2 * k, n - k);
+}
+
+TARGET_AVX2
+static void dotRealTapsAVX2(const float *a, const float *b, int len,
+			    float *c)
+{
+	__m256 acc0 = _mm256_setzero_ps();
+	__m256 acc1 = _mm256_setzero_ps();
+	int j = 0;
+
+	for (; j + 8 <= len; j += 8) {
+		__m256 h0 = _mm256_moveldup_ps(_mm256_loadu_ps(b + 2 * j));
+		__m256 h1 = _mm256_moveldup_ps(_mm256_loadu_ps(b + 2 * j + 8));
+		acc0 = _mm256_add_ps(acc0, _mm256_mul_ps(_mm256_loadu_ps(a + 2 * j), h0));
+		acc1 = _mm256_add_ps(acc1, _mm256_mul_ps(_mm256_loadu_ps(a + 2 * j + 8), h1));
+	}
+
+	acc0 = _mm256_add_ps(acc0, acc1);
+	__m128 acc = _mm_add_ps(_mm256_castps256_ps128(acc0),
+				_mm256_extractf128_ps(acc0, 1));
+
+	float sum[4];
+	_mm_storeu_ps(sum, acc);
+	dotRealTapsSSE2(a + 2 * j, b + 2 * j, len - j, c);
+	c[0] += sum[0] + sum[2];
+	c[1] += sum[1] + sum[3];
+}
+
+static const ConvKernels avx2Kernels = {
+	CONVOLVE_AVX2,
+	convRealTapsAVX2,
+	convRealDataAVX2,
+	convComplexAVX2,
+	convSymRealTapsAVX2,
+	convSymComplexAVX2,
+	dotRealTapsAVX2,
+};
+
+#endif /* HAVE_X86_KERNELS */
+
+/* Kernel set in use, selected on first use or by convolveInit() */
+static const ConvKernels *kernels = NULL;
+
+static bool cpuSupports(ConvolveImpl impl)
+{
+	switch (impl) {
+	case CONVOLVE_SCALAR:
+		return true;
+#ifdef HAVE_X86_KERNELS
+	case CONVOLVE_SSE2:
+		__builtin_cpu_init();
+		return __builtin_cpu_supports("sse2");
+	case CONVOLVE_AVX2:
+		__builtin_cpu_init();
+		return __builtin_cpu_supports("avx2");
+#endif
+	default:
+		return false;
+	}
+}
+
+bool convolveSetImpl(ConvolveImpl impl)
+{
+	if (!cpuSupports(impl))
+		return false;
+
+	switch (impl) {
+#ifdef HAVE_X86_KERNELS
+	case CONVOLVE_AVX2:
+		kernels = &avx2Kernels;
+		break;
+	case CONVOLVE_SSE2:
+		kernels = &sse2Kernels;
+		break;
+#endif
+	default:
+		kernels = &scalarKernels;
+		break;
+	}
+
+	return true;
+}
+
+void convolveInit()
+{
+	if (!convolveSetImpl(CONVOLVE_AVX2) && !convolveSetImpl(CONVOLVE_SSE2))
+		convolveSetImpl(CONVOLVE_SCALAR);
+
+	LOG(INFO) << "using " << convolveImplName(kernels->impl)
+		  << " convolution kernels";
+}
+
+ConvolveImpl convolveGetImpl()
+{
+	if (!kernels)
+		convolveInit();
+
+	return kernels->impl;
+}
+
+const char *convolveImplName(ConvolveImpl impl)
+{
+	switch (impl) {
+	case CONVOLVE_SSE2:
+		return "SSE2";
+	case CONVOLVE_AVX2:
+		return "AVX2";
+	default:
+		return "scalar";
+	}
+}
+
+/*
+ * Edge outputs
+ *
+ * Outputs where the taps run off either end of the data take the clipped
+ * tap range. Symmetric taps are folded the same way as in the steady state,
+ * pairing samples only while both halves lie inside the data.
+ */
+static complex convolveEdge(ConvolveType type,
+			    const complex *a, int La,
+			    const complex *b, int Lb, int t)
+{
+	complex sum = 0.0;
+
+	if ((type == CONVOLVE_SYM_REAL_TAPS) || (type == CONVOLVE_SYM_COMPLEX)) {
+		int half = (Lb + 1) / 2;
+		for (int j = 0; j < half; j++) {
+			int p = t - j;
+			int q = t - Lb + 1 + j;
+			if (p < 0)
+				break;
+
+			bool pValid = (p < La);
+			bool qValid = (q >= 0) && (q < La);
+
+			complex x;
+			if ((p == q) && pValid)
+				x = a[p];
+			else if (pValid && qValid)
+				x = a[p] + a[q];
+			else if (pValid)
+				x = a[p];
+			else if (qValid)
+				x = a[q];
+			else
+				continue;
+
+			if (type == CONVOLVE_SYM_REAL_TAPS)
+				sum += x * b[j].real();
+			else
+				sum += x * b[j];
+		}
+		return sum;
+	}
+
+	int jMin = (t - La + 1 > 0) ? t - La + 1 : 0;
+	int jMax = (t < Lb - 1) ? t : Lb - 1;
+
+	for (int j = jMin; j <= jMax; j++) {
+		switch (type) {
+		case CONVOLVE_REAL_TAPS:
+			sum += a[t - j] * b[j].real();
+			break;
+		case CONVOLVE_REAL_DATA:
+			sum += b[j] * a[t - j].real();
+			break;
+		default:
+			sum += a[t - j] * b[j];
+			break;
+		}
+	}
+
+	return sum;
+}
+
+void convolveSpan(ConvolveType type,
+		  const complex *a, int La,
+		  const complex *b, int Lb,
+		  complex *c, int start, int len)
+{
+	if (!kernels)
+		convolveInit();
+
+	ConvKernel kernel;
+	switch (type) {
+	case CONVOLVE_REAL_TAPS:
+		kernel = kernels->realTaps;
+		break;
+	case CONVOLVE_REAL_DATA:
+		kernel = kernels->realData;
+		break;
+	case CONVOLVE_SYM_REAL_TAPS:
+		kernel = kernels->symRealTaps;
+		break;
+	case CONVOLVE_SYM_COMPLEX:
+		kernel = kernels->symCmplx;
+		break;
+	default:
+		kernel = kernels->cmplx;
+		break;
+	}
+
+	/* Outputs with full overlap, t in [Lb-1, La-1] */
+	int kLo = Lb - 1 - start;
+	int kHi = La - start;
+	if (kLo < 0) kLo = 0;
+	if (kHi > len) kHi = len;
+	if (kHi < kLo) kHi = kLo = len;
+
+	for (int k = 0; k < kLo; k++)
+		c[k] = convolveEdge(type, a, La, b, Lb, start + k);
+
+	if (kHi > kLo) {
+		kernel((const float *) (a + start + kLo), (const float *) b, Lb,
+		       (float *) (c + kLo), kHi - kLo);
+	}
+
+	for (int k = kHi; k < len; k++)
+		c[k] = convolveEdge(type, a, La, b, Lb, start + k);
+}
+
+complex convolveDotRealTaps(const complex *a, const complex *b, int len)
+{
+	if (!kernels)
+		convolveInit();
+
+	float c[2];
+	kernels->dotRealTaps((const float *) a, (const float *) b, len, c);
+
+	return complex(c[0], c[1]);
+}
@@ -0,0 +1,89 @@
+/*
+ * Vectorized convolution engine
+ *
+ * Copyright 2011 Free Software Foundation, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * See the COPYING file in the main directory for details.
+ */
+
+#ifndef CONVOLVE_H
+#define CONVOLVE_H
+
+#include "Complex.h"
+
+/** Convolution kernel implementations, in increasing order of preference */
+enum ConvolveImpl {
+	CONVOLVE_SCALAR = 0,
+	CONVOLVE_SSE2 = 1,
+	CONVOLVE_AVX2 = 2
+};
+
+/** Data and tap layouts handled by the convolution engine */
+enum ConvolveType {
+	CONVOLVE_REAL_TAPS,		///< complex data, real-valued taps
+	CONVOLVE_REAL_DATA,		///< real-valued data, complex taps
+	CONVOLVE_COMPLEX,		///< complex data, complex taps
+	CONVOLVE_SYM_REAL_TAPS,		///< complex data, real-valued ABSSYM taps
+	CONVOLVE_SYM_COMPLEX		///< complex data, complex ABSSYM taps
+};
+
+/** Select the fastest kernel set supported by the running CPU */
+void convolveInit();
+
+/** Return the kernel set currently in use */
+ConvolveImpl convolveGetImpl();
+
+/**
+	Force a particular kernel set, mainly for testing.
+	@param impl The requested implementation.
+	@return False if the CPU or the build does not support it.
+*/
+bool convolveSetImpl(ConvolveImpl impl);
+
+/** Return a printable name for a kernel set */
+const char *convolveImplName(ConvolveImpl impl);
+
+/**
+	Compute a span of the convolution of a and b.
+
+	Output c[k] is sum over j of a[start+k-j]*b[j], with samples of a
+	outside of [0,La) taken as zero. Real-valued vectors are stored as
+	complex with only the real part used. Symmetric types assume
+	b[j] == b[Lb-1-j].
+
+	@param type The data and tap layout.
+	@param a The data vector.
+	@param La The length of a.
+	@param b The filter taps.
+	@param Lb The length of b.
+	@param c The output, len samples long.
+	@param start The output index of c[0].
+	@param len The number of output samples.
+*/
+void convolveSpan(ConvolveType type,
+		  const complex *a, int La,
+		  const complex *b, int Lb,
+		  complex *c, int start, int len);
+
+/**
+	Inner product of complex data with real-valued taps.
+	@param a The data vector.
+	@param b The taps, only the real part is used.
+	@param len The length of both vectors.
+	@return The sum over j of a[j]*b[j].
+*/
+complex convolveDotRealTaps(const complex *a, const complex *b, int len);
+
+#endif /* CONVOLVE_H */
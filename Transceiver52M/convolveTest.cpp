@@ -0,0 +1,295 @@
+/*
+ * Copyright 2011 Free Software Foundation, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * See the COPYING file in the main directory for details.
+ */
+
+/*
+ * Compares the convolution engine against the original iterator-based
+ * convolve() for every span type, symmetry and real/complex combination,
+ * and the inner product against a plain loop, once for each kernel set
+ * the CPU supports.
+ */
+
+#include "sigProcLib.h"
+#include "convolve.h"
+#include <Logger.h>
+#include <Configuration.h>
+
+using namespace std;
+
+ConfigurationTable gConfig;
+
+/* The scalar convolution from sigProcLib before the convolution engine */
+static signalVector *referenceConvolve(const signalVector *a,
+				       const signalVector *b,
+				       signalVector *c,
+				       ConvType spanType,
+				       unsigned startIx = 0,
+				       unsigned len = 0)
+{
+  int La = a->size();
+  int Lb = b->size();
+
+  int startIndex;
+  unsigned int outSize;
+  switch (spanType) {
+    case FULL_SPAN:
+      startIndex = 0;
+      outSize = La+Lb-1;
+      break;
+    case OVERLAP_ONLY:
+      startIndex = La;
+      outSize = abs(La-Lb)+1;
+      break;
+    case START_ONLY:
+      startIndex = 0;
+      outSize = La;
+      break;
+    case WITH_TAIL:
+      startIndex = Lb;
+      outSize = La;
+      break;
+    case NO_DELAY:
+      if (Lb % 2)
+	startIndex = Lb/2;
+      else
+	startIndex = Lb/2-1;
+      outSize = La;
+      break;
+    case CUSTOM:
+      startIndex = startIx;
+      outSize = len;
+      break;
+    default:
+      return NULL;
+  }
+
+  if (c==NULL)
+    c = new signalVector(outSize);
+
+  signalVector::const_iterator aStart = a->begin();
+  signalVector::const_iterator bStart = b->begin();
+  signalVector::const_iterator aEnd = a->end();
+  signalVector::const_iterator bEnd = b->end();
+  signalVector::iterator cPtr = c->begin();
+  int t = startIndex;
+  int stopIndex = startIndex + outSize;
+  if (b->getSymmetry() == NONE) {
+    while (t < stopIndex) {
+      signalVector::const_iterator aP = aStart+t;
+      signalVector::const_iterator bP = bStart;
+      if (a->isRealOnly() && b->isRealOnly()) {
+	float sum = 0.0;
+	while (bP < bEnd) {
+	  if (aP < aStart) break;
+	  if (aP < aEnd) sum += (aP->real())*(bP->real());
+	  aP--;
+	  bP++;
+	}
+	*cPtr++ = sum;
+      }
+      else if (a->isRealOnly()) {
+	complex sum = 0.0;
+	while (bP < bEnd) {
+	  if (aP < aStart) break;
+	  if (aP < aEnd) sum += (*bP)*(aP->real());
+	  aP--;
+	  bP++;
+	}
+	*cPtr++ = sum;
+      }
+      else if (b->isRealOnly()) {
+	complex sum = 0.0;
+	while (bP < bEnd) {
+	  if (aP < aStart) break;
+	  if (aP < aEnd) sum += (*aP)*(bP->real());
+	  aP--;
+	  bP++;
+	}
+	*cPtr++ = sum;
+      }
+      else {
+	complex sum = 0.0;
+	while (bP < bEnd) {
+	  if (aP < aStart) break;
+	  if (aP < aEnd) sum += (*aP)*(*bP);
+	  aP--;
+	  bP++;
+	}
+	*cPtr++ = sum;
+      }
+      t++;
+    }
+  }
+  else {
+    complex sum = 0.0;
+    bEnd = bStart + (Lb+1)/2;
+    while (t < stopIndex) {
+      signalVector::const_iterator aP = aStart+t;
+      signalVector::const_iterator aPsym = aP-Lb+1;
+      signalVector::const_iterator bP = bStart;
+      sum = 0.0;
+      while (bP < bEnd) {
+	if (aP < aStart) break;
+	complex tap = b->isRealOnly() ? complex(bP->real()) : *bP;
+	if (aP == aPsym)
+	  sum+= (*aP)*tap;
+	else if ((aP < aEnd) && (aPsym >= aStart))
+	  sum+= ((*aP)+(*aPsym))*tap;
+	else if (aP < aEnd)
+	  sum += (*aP)*tap;
+	else if (aPsym >= aStart)
+	  sum += (*aPsym)*tap;
+	aP--;
+	aPsym++;
+	bP++;
+      }
+      *cPtr++ = sum;
+      t++;
+    }
+  }
+
+  return c;
+}
+
+static float randomFloat()
+{
+  return 2.0F*((float) random()/(float) RAND_MAX) - 1.0F;
+}
+
+static void randomFill(signalVector &x, bool realOnly)
+{
+  for (unsigned i = 0; i < x.size(); i++)
+    x[i] = complex(randomFloat(), realOnly ? 0.0F : randomFloat());
+  x.isRealOnly(realOnly);
+}
+
+/* Compare one configuration, returning true on a match within tolerance */
+static bool compare(int La, int Lb, ConvType spanType, Symmetry sym,
+		    bool aReal, bool bReal, unsigned startIx, unsigned len)
+{
+  // the original symmetric path reads past the end of the data at the
+  // tail of the output, so keep zeros behind the data vector
+  signalVector aStorage(3*(La+Lb));
+  aStorage.fill(0.0);
+  signalVector a(aStorage.begin(), 0, La);
+  randomFill(a, aReal);
+
+  signalVector b(Lb);
+  randomFill(b, bReal);
+  if (sym == ABSSYM) {
+    for (int j = 0; j < Lb/2; j++)
+      b[Lb-1-j] = b[j];
+  }
+  b.setSymmetry(sym);
+
+  signalVector *expected = referenceConvolve(&a, &b, NULL, spanType, startIx, len);
+  signalVector *result = convolve(&a, &b, NULL, spanType, startIx, len);
+
+  bool match = (result != NULL) && (result->size() == expected->size());
+  for (unsigned i = 0; match && (i < result->size()); i++) {
+    float err = ((*result)[i] - (*expected)[i]).abs();
+    float mag = (*expected)[i].abs();
+    if (err > 1.0e-5F*(Lb + 1)*(mag + 1.0F))
+      match = false;
+  }
+
+  if (!match) {
+    cout << "FAIL " << convolveImplName(convolveGetImpl())
+	 << " La=" << La << " Lb=" << Lb << " span=" << spanType
+	 << " sym=" << sym << " aReal=" << aReal << " bReal=" << bReal << endl;
+  }
+
+  delete expected;
+  delete result;
+
+  return match;
+}
+
+/* Compare the inner product against a plain loop */
+static bool compareDot(int len)
+{
+  signalVector a(len), b(len);
+  randomFill(a, false);
+  randomFill(b, true);
+
+  complex expected = 0.0;
+  for (int j = 0; j < len; j++)
+    expected += a[j]*b[j].real();
+
+  complex result = convolveDotRealTaps(a.begin(), b.begin(), len);
+
+  if ((result - expected).abs() > 1.0e-5F*(len + 1)*(expected.abs() + 1.0F)) {
+    cout << "FAIL " << convolveImplName(convolveGetImpl())
+	 << " dot len=" << len << endl;
+    return false;
+  }
+  return true;
+}
+
+int main(int argc, char **argv)
+{
+  gLogInit("convolveTest","INFO");
+
+  static const int dataLengths[] = { 1, 2, 5, 9, 37, 156, 157, 311 };
+  static const int tapLengths[] = { 1, 2, 3, 4, 5, 7, 16, 21, 65 };
+  static const ConvType spans[] = { FULL_SPAN, OVERLAP_ONLY, START_ONLY,
+				    WITH_TAIL, NO_DELAY, CUSTOM };
+  static const ConvolveImpl impls[] = { CONVOLVE_SCALAR, CONVOLVE_SSE2,
+					CONVOLVE_AVX2 };
+
+  int numTests = 0;
+  int numFailed = 0;
+
+  for (unsigned n = 0; n < sizeof(impls)/sizeof(impls[0]); n++) {
+    if (!convolveSetImpl(impls[n])) {
+      cout << convolveImplName(impls[n]) << ": not supported, skipped" << endl;
+      continue;
+    }
+
+    int implTests = 0;
+    for (unsigned i = 0; i < sizeof(dataLengths)/sizeof(dataLengths[0]); i++) {
+      for (unsigned j = 0; j < sizeof(tapLengths)/sizeof(tapLengths[0]); j++) {
+	int La = dataLengths[i];
+	int Lb = tapLengths[j];
+	for (unsigned s = 0; s < sizeof(spans)/sizeof(spans[0]); s++) {
+	  for (int mode = 0; mode < 6; mode++) {
+	    Symmetry sym = (mode < 4) ? NONE : ABSSYM;
+	    bool aReal = (mode < 4) && (mode & 1);
+	    bool bReal = (mode < 4) ? (mode & 2) : (mode & 1);
+	    unsigned startIx = (La > Lb) ? (La-Lb)/2 : 0;
+	    unsigned len = (La+Lb-1) - startIx;
+	    if (!compare(La, Lb, spans[s], sym, aReal, bReal, startIx, len))
+	      numFailed++;
+	    numTests++;
+	    implTests++;
+	  }
+	}
+      }
+    }
+    for (int len = 0; len <= 40; len++) {
+      if (!compareDot(len))
+	numFailed++;
+      numTests++;
+      implTests++;
+    }
+    cout << convolveImplName(impls[n]) << ": " << implTests << " cases" << endl;
+  }
+
+  cout << numTests - numFailed << "/" << numTests << " passed" << endl;
+
+  return (numFailed == 0) ? 0 : 1;
+}
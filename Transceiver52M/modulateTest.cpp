@@ -0,0 +1,116 @@
+/*
+ * Copyright 2011 Free Software Foundation, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * See the COPYING file in the main directory for details.
+ */
+
+/*
+ * Compares the table-driven modulateBurst() against the original
+ * impulse train, rotation and pulse shaping convolution.
+ */
+
+#include "sigProcLib.h"
+#include <Logger.h>
+#include <Configuration.h>
+
+using namespace std;
+
+ConfigurationTable gConfig;
+
+/* Not exported by sigProcLib.h */
+void GMSKRotate(signalVector &x);
+
+/* The modulator from sigProcLib before the lookup tables */
+static signalVector *referenceModulate(const BitVector &wBurst,
+				       const signalVector &gsmPulse,
+				       int guardPeriodLength,
+				       int samplesPerSymbol)
+{
+  int burstSize = samplesPerSymbol*(wBurst.size()+guardPeriodLength);
+  signalVector modBurst(burstSize);
+  modBurst.isRealOnly(true);
+  modBurst.fill(0.0);
+  signalVector::iterator modBurstItr = modBurst.begin();
+
+  for (unsigned int i = 0; i < wBurst.size(); i++) {
+    *modBurstItr = 2.0*(wBurst[i] & 0x01)-1.0;
+    modBurstItr += samplesPerSymbol;
+  }
+
+  GMSKRotate(modBurst);
+  modBurst.isRealOnly(false);
+
+  return convolve(&modBurst,&gsmPulse,NULL,NO_DELAY);
+}
+
+static bool compare(int samplesPerSymbol, int numBits, int guardPeriodLength)
+{
+  signalVector *gsmPulse = generateGSMPulse(2,samplesPerSymbol);
+
+  BitVector burst(numBits);
+  for (int i = 0; i < numBits; i++)
+    burst[i] = random() & 0x01;
+
+  signalVector *expected = referenceModulate(burst,*gsmPulse,guardPeriodLength,samplesPerSymbol);
+  signalVector *result = modulateBurst(burst,*gsmPulse,guardPeriodLength,samplesPerSymbol);
+
+  bool match = (result->size() == expected->size());
+  for (unsigned i = 0; match && (i < result->size()); i++) {
+    // the rotation table accumulates phase error along the burst
+    if (((*result)[i] - (*expected)[i]).abs() > 1.0e-3F)
+      match = false;
+  }
+
+  if (!match) {
+    cout << "FAIL sps=" << samplesPerSymbol << " bits=" << numBits
+	 << " guard=" << guardPeriodLength << endl;
+  }
+
+  delete expected;
+  delete result;
+  delete gsmPulse;
+
+  return match;
+}
+
+int main(int argc, char **argv)
+{
+  gLogInit("modulateTest","INFO");
+
+  static const int spsList[] = { 1, 2, 4 };
+  static const int bitsList[] = { 1, 2, 3, 41, 88, 148 };
+  static const int guardList[] = { 0, 8, 9 };
+
+  int numTests = 0;
+  int numFailed = 0;
+
+  for (unsigned n = 0; n < sizeof(spsList)/sizeof(spsList[0]); n++) {
+    sigProcLibSetup(spsList[n]);
+    for (unsigned i = 0; i < sizeof(bitsList)/sizeof(bitsList[0]); i++) {
+      for (unsigned j = 0; j < sizeof(guardList)/sizeof(guardList[0]); j++) {
+	for (int trial = 0; trial < 10; trial++) {
+	  if (!compare(spsList[n],bitsList[i],guardList[j]))
+	    numFailed++;
+	  numTests++;
+	}
+      }
+    }
+    sigProcLibDestroy();
+  }
+
+  cout << numTests - numFailed << "/" << numTests << " passed" << endl;
+
+  return (numFailed == 0) ? 0 : 1;
+}
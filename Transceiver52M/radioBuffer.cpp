@@ -0,0 +1,128 @@
+/*
+ * Double-mapped sample ring buffer
+ *
+ * Copyright 2011 Free Software Foundation, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * See the COPYING file in the main directory for details.
+ */
+
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+#include "radioBuffer.h"
+#include <Logger.h>
+
+#define SAMPLE_BYTES	(2 * sizeof(float))
+
+/* Map one shared memory object twice, back to back. NULL on failure. */
+static float *mapTwice(size_t bytes)
+{
+#if defined(__linux__) && defined(SYS_memfd_create)
+	int fd = syscall(SYS_memfd_create, "radioBuffer", 0);
+	if (fd < 0)
+		return NULL;
+
+	if (ftruncate(fd, bytes) < 0) {
+		close(fd);
+		return NULL;
+	}
+
+	/* Reserve the whole range, then place both views inside it */
+	char *base = (char *) mmap(NULL, 2 * bytes, PROT_NONE,
+				   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (base == MAP_FAILED) {
+		close(fd);
+		return NULL;
+	}
+
+	if ((mmap(base, bytes, PROT_READ | PROT_WRITE,
+		  MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED) ||
+	    (mmap(base + bytes, bytes, PROT_READ | PROT_WRITE,
+		  MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED)) {
+		munmap(base, 2 * bytes);
+		close(fd);
+		return NULL;
+	}
+
+	close(fd);
+	return (float *) base;
+#else
+	return NULL;
+#endif
+}
+
+RadioBuffer::RadioBuffer(size_t wSamples)
+	: mRead(0), mWrite(0)
+{
+	/* Both views must start on a page, and a page holds whole samples */
+	size_t page = sysconf(_SC_PAGESIZE);
+	size_t bytes = (wSamples * SAMPLE_BYTES + page - 1) / page * page;
+
+	mData = mapTwice(bytes);
+	mMapped = (mData != NULL);
+
+	if (mMapped) {
+		mSize = bytes / SAMPLE_BYTES;
+	} else {
+		LOG(WARNING) << "double-mapped sample buffer unavailable, using a flat buffer";
+		mSize = wSamples;
+		mData = new float[2 * mSize];
+	}
+}
+
+RadioBuffer::~RadioBuffer()
+{
+	if (mMapped)
+		munmap(mData, 2 * mSize * SAMPLE_BYTES);
+	else
+		delete[] mData;
+}
+
+float *RadioBuffer::readPtr() const
+{
+	if (mMapped)
+		return mData + 2 * (mRead % mSize);
+
+	return mData + 2 * mRead;
+}
+
+float *RadioBuffer::writePtr() const
+{
+	if (mMapped)
+		return mData + 2 * (mWrite % mSize);
+
+	return mData + 2 * mWrite;
+}
+
+void RadioBuffer::commit(size_t num)
+{
+	mWrite += num;
+}
+
+void RadioBuffer::consume(size_t num)
+{
+	mRead += num;
+
+	/* Flat storage keeps the readable samples at the front */
+	if (!mMapped && mRead) {
+		memmove(mData, mData + 2 * mRead, avail() * SAMPLE_BYTES);
+		mWrite -= mRead;
+		mRead = 0;
+	}
+}
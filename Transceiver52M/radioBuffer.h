@@ -0,0 +1,72 @@
+/*
+ * Double-mapped sample ring buffer
+ *
+ * Copyright 2011 Free Software Foundation, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * See the COPYING file in the main directory for details.
+ */
+
+#ifndef RADIOBUFFER_H
+#define RADIOBUFFER_H
+
+#include <stddef.h>
+
+/**
+	FIFO of interleaved complex float samples.
+
+	The storage is mapped twice, back to back, in virtual memory, so the
+	samples following any position are contiguous up to the ring size.
+	Readers and writers always get a flat span without the buffer ever
+	being compacted. If the double mapping is not available the buffer
+	falls back to a flat array that is compacted on consume().
+
+	Not locked; the producer and the consumer must share a thread.
+*/
+class RadioBuffer {
+public:
+	/** @param wSamples The minimum capacity in complex samples. */
+	RadioBuffer(size_t wSamples);
+	~RadioBuffer();
+
+	/** Number of samples available to read */
+	size_t avail() const { return mWrite - mRead; }
+
+	/** Number of samples that can be written */
+	size_t space() const { return mSize - avail(); }
+
+	/** Start of the readable samples, contiguous for avail() samples */
+	float *readPtr() const;
+
+	/** Start of the free space, contiguous for space() samples */
+	float *writePtr() const;
+
+	/** Mark samples written at writePtr() as readable */
+	void commit(size_t num);
+
+	/** Release samples from the read side */
+	void consume(size_t num);
+
+	/** True if the storage is double-mapped */
+	bool mapped() const { return mMapped; }
+
+private:
+	float *mData;         ///< start of the first mapping, or of the flat array
+	size_t mSize;         ///< capacity in complex samples
+	size_t mRead;         ///< samples consumed so far
+	size_t mWrite;        ///< samples committed so far
+	bool mMapped;         ///< double-mapped, otherwise flat
+};
+
+#endif /* RADIOBUFFER_H */
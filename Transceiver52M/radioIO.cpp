@@ -67,25 +67,28 @@ void RadioInterface::pullBuffer()
 	underrun |= local_underrun;
 	readTimestamp += (TIMESTAMP) num_rd;
 
-	short_to_float(rcvBuffer + 2 * rcvCursor, rx_buf, num_rd);
-	rcvCursor += num_rd;
+	assert((num_rd >= 0) && ((int) rcvBuffer->space() >= num_rd));
+	short_to_float(rcvBuffer->writePtr(), rx_buf, num_rd);
+	rcvBuffer->commit(num_rd);
 }
 
 /* Send timestamped chunk to the device with arbitrary size */ 
 void RadioInterface::pushBuffer()
 {
-	if (sendCursor < INCHUNK)
+	int num_send = sendBuffer->avail();
+
+	if (num_send < INCHUNK)
 		return;
 
-	float_to_short(tx_buf, sendBuffer, sendCursor);
+	float_to_short(tx_buf, sendBuffer->readPtr(), num_send);
 
 	/* Write samples. Fail if we don't get what we want. */
 	int num_smpls = mRadio->writeSamples(tx_buf,
-					     sendCursor,
+					     num_send,
 					     &underrun,
 					     writeTimestamp);
-	assert(num_smpls == sendCursor);
+	assert(num_smpls == num_send);
 
 	writeTimestamp += (TIMESTAMP) num_smpls;
-	sendCursor = 0;
+	sendBuffer->consume(num_send);
 }
@@ -20,7 +20,9 @@
  */
 
 #include <radioInterface.h>
+#include "resampler.h"
 #include <Logger.h>
+#include <Timeval.h>
 
 /* New chunk sizes for resampled rate */
 #ifdef INCHUNK
@@ -32,132 +34,59 @@
 
 /* Resampling parameters */
 #define INRATE       65 * SAMPSPERSYM
-#define INHISTORY    INRATE * 2
 #define INCHUNK      INRATE * 9
 
 #define OUTRATE      96 * SAMPSPERSYM
-#define OUTHISTORY   OUTRATE * 2
 #define OUTCHUNK     OUTRATE * 9
 
-/* Resampler low pass filters */
-signalVector *tx_lpf = 0;
-signalVector *rx_lpf = 0;
+/* Interval between reports of streaming path allocations */
+#define ALLOC_REPORT_MS  10000
 
-/* Resampler history */
-signalVector *tx_hist = 0;
-signalVector *rx_hist = 0;
-
-/* Resampler input buffer */
-signalVector *tx_vec = 0;
-signalVector *rx_vec = 0;
+/* Resamplers with their own history */
+Resampler *tx_resampler = 0;
+Resampler *rx_resampler = 0;
 
 /*
  * High rate (device facing) buffers
  *
  * Transmit side samples are pushed after each burst so accomodate
- * a resampled burst plus up to a chunk left over from the previous
- * resampling operation.
+ * a resampled chunk plus up to a burst beyond it.
  *
  * Receive side samples always pulled with a fixed size.
  */
 short tx_buf[INCHUNK * 2 * 4];
 short rx_buf[OUTCHUNK * 2 * 2];
 
-/* 
- * Utilities and Conversions 
+/*
+ * Conversion buffers
  *
- * Manipulate signal vectors dynamically for two reasons. For one,
- * it's simpler. And two, it doesn't make any reasonable difference
- * relative to the high overhead generated by the resampling.
+ * Fixed size, so that steady state streaming never touches the heap.
+ * Transmit side holds the resampler output ahead of the conversion into
+ * tx_buf, receive side holds the device samples ahead of resampling.
  */
+complex tx_cvt[INCHUNK * 4];
+complex rx_cvt[OUTCHUNK * 2];
 
-/* Concatenate signal vectors. Deallocate input vectors. */
-signalVector *concat(signalVector *a, signalVector *b)
-{
-	signalVector *vec = new signalVector(*a, *b);
-	delete a;
-	delete b;
-
-	return vec;
-}
-
-/* Segment a signal vector. Deallocate the input vector. */
-signalVector *segment(signalVector *a, int indx, int sz)
-{
-	signalVector *vec = new signalVector(sz);
-	a->segmentCopyTo(*vec, indx, sz);
-	delete a;
-
-	return vec;
-}
-
-/* Create a new signal vector from a short array. */
-signalVector *short_to_sigvec(short *smpls, size_t sz)
+/* Convert interleaved integer samples into a complex array */
+void short_to_cplx(complex *out, const short *smpls, int sz)
 {
-	int i;
-	signalVector *vec = new signalVector(sz);
-	signalVector::iterator itr = vec->begin();
-
-	for (i = 0; i < sz; i++) {
-		*itr++ = Complex<float>(smpls[2 * i + 0], smpls[2 * i + 1]);
-	}
-
-	return vec;
+	for (int i = 0; i < sz; i++)
+		out[i] = complex(smpls[2 * i + 0], smpls[2 * i + 1]);
 }
 
-/* Convert and deallocate a signal vector into a short array. */
-int sigvec_to_short(signalVector *vec, short *smpls)
+/* Convert a complex array into interleaved integer samples */
+void cplx_to_short(short *smpls, const complex *in, int sz)
 {
-	int i;
-	signalVector::iterator itr = vec->begin();
-
-	for (i = 0; i < vec->size(); i++) {
-		smpls[2 * i + 0] = itr->real();
-		smpls[2 * i + 1] = itr->imag();
-		itr++;
+	for (int i = 0; i < sz; i++) {
+		smpls[2 * i + 0] = in[i].real();
+		smpls[2 * i + 1] = in[i].imag();
 	}
-	delete vec;
-
-	return i;
 }
 
-/* Create a new signal vector from a float array. */
-signalVector *float_to_sigvec(float *smpls, int sz)
+/* Initialize a resampler and its low pass filter */
+Resampler *init_resampler(int tx)
 {
-	int i;
-	signalVector *vec = new signalVector(sz);
-	signalVector::iterator itr = vec->begin();
-
-	for (i = 0; i < sz; i++) {
-		*itr++ = Complex<float>(smpls[2 * i + 0], smpls[2 * i + 1]);
-	}
-
-	return vec;
-}
-
-/* Convert and deallocate a signal vector into a float array. */
-int sigvec_to_float(signalVector *vec, float *smpls)
-{
-	int i;
-	signalVector::iterator itr = vec->begin();
-
-	for (i = 0; i < vec->size(); i++) {
-		smpls[2 * i + 0] = itr->real();
-		smpls[2 * i + 1] = itr->imag();
-		itr++;
-	}
-	delete vec;
-
-	return i;
-}
-
-/* Initialize resampling signal vectors */
-void init_resampler(signalVector **lpf,
-	   	    signalVector **buf,
-		    signalVector **hist,
-		    int tx)
-{
-	int P, Q, taps, hist_len;
+	int P, Q, taps, max_len;
 	float cutoff_freq;
 
 	if (tx) {
@@ -165,108 +94,84 @@ void init_resampler(signalVector **lpf,
 		P = OUTRATE;
 		Q = INRATE;
 		taps = 651;
-		hist_len = INHISTORY;
+		max_len = INCHUNK * 2;
 	} else {
 		LOG(INFO) << "Initializing Rx resampler";
 		P = INRATE;
 		Q = OUTRATE;
 		taps = 961;
-		hist_len = OUTHISTORY;
+		max_len = OUTCHUNK;
 	}
 
-	if (!*lpf) {
-		cutoff_freq = (P < Q) ? (1.0/(float) Q) : (1.0/(float) P);
-		*lpf = createLPF(cutoff_freq, taps, P);
-	}
+	cutoff_freq = (P < Q) ? (1.0/(float) Q) : (1.0/(float) P);
+	signalVector *lpf = createLPF(cutoff_freq, taps, P);
 
-	if (!*buf) {
-		*buf = new signalVector();
-	}
+	Resampler *resampler = new Resampler(P, Q, *lpf, max_len);
+	delete lpf;
 
-	if (!*hist);
-		*hist = new signalVector(hist_len);
+	return resampler;
 }
 
-/* Resample a signal vector
- *
- * The input vector is deallocated and the pointer returned with a vector
- * of any unconverted samples.
+/*
+ * Log the rate of heap allocations made by the resamplers since the last
+ * report. Only buffer setup and growth allocate, so anything but zero
+ * after startup means a block larger than the buffers were sized for.
  */
-signalVector *resmpl_sigvec(signalVector *hist, signalVector **vec,
-			    signalVector *lpf, double in_rate,
-			    double out_rate, int chunk_sz)
+void report_allocs()
 {
-	signalVector *resamp_vec;
-	int num_chunks = (*vec)->size() / chunk_sz;
+	static Timeval last_report;
+	static unsigned last_count = 0;
 
-	/* Truncate to a chunk multiple */
-	signalVector trunc_vec(num_chunks * chunk_sz);
-	(*vec)->segmentCopyTo(trunc_vec, 0, num_chunks * chunk_sz);
+	long elapsed = last_report.elapsed();
+	if (elapsed < ALLOC_REPORT_MS)
+		return;
 
-	/* Update sample buffer with remainder */
-	*vec = segment(*vec, trunc_vec.size(), (*vec)->size() - trunc_vec.size());
+	unsigned count = 0;
+	if (tx_resampler)
+		count += tx_resampler->allocations();
+	if (rx_resampler)
+		count += rx_resampler->allocations();
 
-	/* Add history and resample */
-	signalVector input_vec(*hist, trunc_vec);
-	resamp_vec = polyphaseResampleVector(input_vec, in_rate,
-					     out_rate, lpf);
+	float rate = (count - last_count) * 1000.0f / elapsed;
+	if (count != last_count) {
+		LOG(NOTICE) << "Resampling path allocations: " << rate << "/sec";
+	} else {
+		LOG(DEBUG) << "Resampling path allocations: " << rate << "/sec";
+	}
 
-	/* Update history */
-	trunc_vec.segmentCopyTo(*hist, trunc_vec.size() - hist->size(),
-				hist->size());
-	return resamp_vec;
+	last_count = count;
+	last_report.now();
 }
 
 /* Wrapper for receive-side integer-to-float array resampling */
- int rx_resmpl_int_flt(float *smpls_out, short *smpls_in, int num_smpls)
+int rx_resmpl_int_flt(float *smpls_out, short *smpls_in, int num_smpls)
 {
-	int num_resmpld, num_chunks;
-	signalVector *convert_vec, *resamp_vec, *trunc_vec;
-
-	if (!rx_lpf || !rx_vec || !rx_hist)
-		init_resampler(&rx_lpf, &rx_vec, &rx_hist, false);
-
-	/* Convert and add samples to the receive buffer */
-	convert_vec = short_to_sigvec(smpls_in, num_smpls);
-	rx_vec = concat(rx_vec, convert_vec);
-
-	num_chunks = rx_vec->size() / OUTCHUNK;
-	if (num_chunks < 1)
-		return 0;
-
-	/* Resample */ 
-	resamp_vec = resmpl_sigvec(rx_hist, &rx_vec, rx_lpf,
-				   INRATE, OUTRATE, OUTCHUNK);
-	/* Truncate */
-	trunc_vec = segment(resamp_vec, INHISTORY,
-                            resamp_vec->size() - INHISTORY);
-	/* Convert */
-	num_resmpld = sigvec_to_float(trunc_vec, smpls_out);
-
-	return num_resmpld; 
+	if (!rx_resampler)
+		rx_resampler = init_resampler(false);
+
+	/*
+	 * Convert, then resample straight into the output array. A chunk of
+	 * OUTCHUNK device samples never yields more than INCHUNK outputs.
+	 */
+	short_to_cplx(rx_cvt, smpls_in, num_smpls);
+
+	return rx_resampler->rotate(rx_cvt, num_smpls,
+				    (complex *) smpls_out, INCHUNK);
 }
 
 /* Wrapper for transmit-side float-to-int array resampling */
 int tx_resmpl_flt_int(short *smpls_out, float *smpls_in, int num_smpls)
 {
-	int num_resmpl, num_chunks;
-	signalVector *convert_vec, *resamp_vec;
-
-	if (!tx_lpf || !tx_vec || !tx_hist)
-		init_resampler(&tx_lpf, &tx_vec, &tx_hist, true);
+	int num_resmpl;
 
-	/* Convert and add samples to the transmit buffer */
-	convert_vec = float_to_sigvec(smpls_in, num_smpls);
-	tx_vec = concat(tx_vec, convert_vec);
+	if (!tx_resampler)
+		tx_resampler = init_resampler(true);
 
-	num_chunks = tx_vec->size() / INCHUNK;
-	if (num_chunks < 1)
-		return 0;
-
-	/* Resample and convert to an integer array */
-	resamp_vec = resmpl_sigvec(tx_hist, &tx_vec, tx_lpf,
-				   OUTRATE, INRATE, INCHUNK);
-	num_resmpl = sigvec_to_short(resamp_vec, smpls_out);
+	/* Resample, then convert straight into the integer array */
+	num_resmpl = tx_resampler->rotate((complex *) smpls_in, num_smpls,
+					  tx_cvt, INCHUNK * 4);
+	if (num_resmpl > 0)
+		cplx_to_short(smpls_out, tx_cvt, num_resmpl);
 
 	return num_resmpl; 
 }
@@ -288,31 +193,35 @@ void RadioInterface::pullBuffer()
 	readTimestamp += (TIMESTAMP) num_rd;
 
 	/* Convert and resample */
-	num_cv = rx_resmpl_int_flt(rcvBuffer + 2 * rcvCursor,
-				   rx_buf, num_rd);
+	assert(rcvBuffer->space() >= INCHUNK);
+	num_cv = rx_resmpl_int_flt(rcvBuffer->writePtr(), rx_buf, num_rd);
 
 	LOG(DEBUG) << "Rx read " << num_cv << " samples from resampler";
+	assert(num_cv >= 0);
+
+	rcvBuffer->commit(num_cv);
 
-	rcvCursor += num_cv;
+	report_allocs();
 }
 
 /* Send a timestamped chunk to the device */ 
 void RadioInterface::pushBuffer()
 {
 	int num_cv, num_wr;
+	int num_send = sendBuffer->avail();
 
-	if (sendCursor < INCHUNK)
+	if (num_send < INCHUNK)
 		return;
 
-	LOG(DEBUG) << "Tx wrote " << sendCursor << " samples to resampler";
+	LOG(DEBUG) << "Tx wrote " << num_send << " samples to resampler";
 
 	/* Resample and convert */
-	num_cv = tx_resmpl_flt_int(tx_buf, sendBuffer, sendCursor);
-	assert(num_cv > sendCursor);
+	num_cv = tx_resmpl_flt_int(tx_buf, sendBuffer->readPtr(), num_send);
+	assert(num_cv > 0);
+	sendBuffer->consume(num_send);
 
 	/* Write samples. Fail if we don't get what we want. */
-	num_wr = mRadio->writeSamples(tx_buf + OUTHISTORY * 2,
-				      num_cv - OUTHISTORY,
+	num_wr = mRadio->writeSamples(tx_buf, num_cv,
 				      &underrun,
 				      writeTimestamp);
 
@@ -320,5 +229,4 @@ void RadioInterface::pushBuffer()
 	assert(num_wr == num_wr);
 
 	writeTimestamp += (TIMESTAMP) num_wr;
-	sendCursor = 0;
 }
@@ -32,7 +32,7 @@ RadioInterface::RadioInterface(RadioDevice *wRadio,
 			       int wRadioOversampling,
 			       int wTransceiverOversampling,
 			       GSM::Time wStartTime)
-  : underrun(false), sendCursor(0), rcvCursor(0), mOn(false),
+  : sendBuffer(NULL), rcvBuffer(NULL), underrun(false), mOn(false),
     mRadio(wRadio), receiveOffset(wReceiveOffset),
     samplesPerSymbol(wRadioOversampling), powerScaling(1.0),
     loadTest(false)
@@ -42,7 +42,8 @@ RadioInterface::RadioInterface(RadioDevice *wRadio,
 
 
 RadioInterface::~RadioInterface(void) {
-  if (rcvBuffer!=NULL) delete rcvBuffer;
+  delete sendBuffer;
+  delete rcvBuffer;
   //mReceiveFIFO.clear();
 }
 
@@ -127,8 +128,8 @@ void RadioInterface::start()
   mRadio->updateAlignment(writeTimestamp-10000); 
   mRadio->updateAlignment(writeTimestamp-10000);
 
-  sendBuffer = new float[2*2*INCHUNK*samplesPerSymbol];
-  rcvBuffer = new float[2*2*OUTCHUNK*samplesPerSymbol];
+  sendBuffer = new RadioBuffer(2*INCHUNK*samplesPerSymbol);
+  rcvBuffer = new RadioBuffer(2*OUTCHUNK*samplesPerSymbol);
  
   mOn = true;
 
@@ -152,9 +153,14 @@ void RadioInterface::driveTransmitRadio(signalVector &radioBurst, bool zeroBurst
 
   if (!mOn) return;
 
-  radioifyVector(radioBurst, sendBuffer + 2 * sendCursor, powerScaling, zeroBurst);
+  if (sendBuffer->space() < radioBurst.size()) {
+    LOG(ERR) << "transmit buffer full, dropping burst";
+    return;
+  }
+
+  radioifyVector(radioBurst, sendBuffer->writePtr(), powerScaling, zeroBurst);
 
-  sendCursor += radioBurst.size();
+  sendBuffer->commit(radioBurst.size());
 
   pushBuffer();
 }
@@ -170,44 +176,43 @@ void RadioInterface::driveReceiveRadio() {
   GSM::Time rcvClock = mClock.get();
   rcvClock.decTN(receiveOffset);
   unsigned tN = rcvClock.TN();
-  int rcvSz = rcvCursor;
-  int readSz = 0;
+  int rcvSz = rcvBuffer->avail();
   const int symbolsPerSlot = gSlotLen + 8;
 
   // while there's enough data in receive buffer, form received 
   //    GSM bursts and pass up to Transceiver
   // Using the 157-156-156-156 symbols per timeslot format.
   while (rcvSz > (symbolsPerSlot + (tN % 4 == 0))*samplesPerSymbol) {
-    signalVector rxVector((symbolsPerSlot + (tN % 4 == 0))*samplesPerSymbol);
-    unRadioifyVector(rcvBuffer+readSz*2,rxVector);
+    int burstSz = (symbolsPerSlot + (tN % 4 == 0))*samplesPerSymbol;
     GSM::Time tmpTime = rcvClock;
     if (rcvClock.FN() >= 0) {
       //LOG(DEBUG) << "FN: " << rcvClock.FN();
       radioVector *rxBurst = NULL;
-      if (!loadTest)
-        rxBurst = new radioVector(rxVector,tmpTime);
+      if (!loadTest) {
+        // the ring is contiguous past its end, so convert in place
+        rxBurst = new radioVector((size_t) burstSz,tmpTime);
+        unRadioifyVector(rcvBuffer->readPtr(),*rxBurst);
+      }
       else {
 	if (tN % 4 == 0)
 	  rxBurst = new radioVector(*finalVec9,tmpTime);
         else
           rxBurst = new radioVector(*finalVec,tmpTime); 
       }
-      mReceiveFIFO.put(rxBurst); 
+      if (!mReceiveFIFO.put(rxBurst)) {
+        LOG(WARNING) << "receive FIFO full, dropping burst at " << tmpTime;
+        delete rxBurst;
+      }
     }
     mClock.incTN(); 
     rcvClock.incTN();
     //if (mReceiveFIFO.size() >= 16) mReceiveFIFO.wait(8);
     //LOG(DEBUG) << "receiveFIFO: wrote radio vector at time: " << mClock.get() << ", new size: " << mReceiveFIFO.size() ;
-    readSz += (symbolsPerSlot+(tN % 4 == 0))*samplesPerSymbol;
-    rcvSz -= (symbolsPerSlot+(tN % 4 == 0))*samplesPerSymbol;
+    rcvBuffer->consume(burstSz);
+    rcvSz -= burstSz;
 
     tN = rcvClock.TN();
   }
-
-  if (readSz > 0) {
-    rcvCursor -= readSz;
-    memmove(rcvBuffer,rcvBuffer+2*readSz,sizeof(float) * 2 * rcvCursor);
-  }
 }
 
 bool RadioInterface::isUnderrun()
@@ -20,6 +20,7 @@
 #include "radioDevice.h"
 #include "radioVector.h"
 #include "radioClock.h"
+#include "radioBuffer.h"
 
 /** samples per GSM symbol */
 #define SAMPSPERSYM 1 
@@ -37,11 +38,8 @@ private:
 
   RadioDevice *mRadio;			      ///< the USRP object
  
-  float *sendBuffer;
-  unsigned sendCursor;
-
-  float *rcvBuffer;
-  unsigned rcvCursor;
+  RadioBuffer *sendBuffer;		      ///< transmit samples waiting for the device
+  RadioBuffer *rcvBuffer;		      ///< receive samples waiting to form bursts
  
   bool underrun;			      ///< indicates writes to USRP are too slow
   bool overrun;				      ///< indicates reads from USRP are too slow
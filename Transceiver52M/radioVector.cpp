@@ -21,11 +21,23 @@
 
 #include "radioVector.h"
 
-radioVector::radioVector(const signalVector& wVector, GSM::Time& wTime)
+#include <time.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+radioVector::radioVector(const signalVector& wVector, const GSM::Time& wTime)
 	: signalVector(wVector), mTime(wTime)
 {
 }
 
+radioVector::radioVector(size_t size, const GSM::Time& wTime)
+	: signalVector(size), mTime(wTime)
+{
+}
+
 GSM::Time radioVector::getTime() const
 {
 	return mTime;
@@ -41,19 +53,97 @@ bool radioVector::operator>(const radioVector& other) const
 	return mTime > other.mTime;
 }
 
+/* Busy polls before a waiting consumer goes to sleep */
+#define VECTORFIFO_SPINS	1000
+
+#ifdef __linux__
+static void futexWait(unsigned *addr, unsigned val, unsigned timeout)
+{
+	struct timespec ts;
+	ts.tv_sec = timeout / 1000;
+	ts.tv_nsec = (timeout % 1000) * 1000000;
+
+	syscall(SYS_futex, addr, FUTEX_WAIT_PRIVATE, val, &ts, NULL, 0);
+}
+
+static void futexWake(unsigned *addr)
+{
+	syscall(SYS_futex, addr, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+}
+#else
+/* Without futexes, poll again after a short sleep */
+static void futexWait(unsigned *addr, unsigned val, unsigned timeout)
+{
+	usleep(timeout < 1 ? 0 : 1000);
+}
+
+static void futexWake(unsigned *addr)
+{
+}
+#endif
+
+VectorFIFO::VectorFIFO()
+	: mHead(0), mTail(0), mWaiting(0)
+{
+}
+
 unsigned VectorFIFO::size()
 {
-	return mQ.size();
+	unsigned tail = __atomic_load_n(&mTail, __ATOMIC_ACQUIRE);
+	unsigned head = __atomic_load_n(&mHead, __ATOMIC_ACQUIRE);
+
+	return tail - head;
 }
 
-void VectorFIFO::put(radioVector *ptr)
+bool VectorFIFO::put(radioVector *ptr)
 {
-	mQ.put((void*) ptr);
+	unsigned tail = __atomic_load_n(&mTail, __ATOMIC_RELAXED);
+	unsigned head = __atomic_load_n(&mHead, __ATOMIC_ACQUIRE);
+
+	if (tail - head >= VECTORFIFO_SIZE)
+		return false;
+
+	mBuffer[tail % VECTORFIFO_SIZE] = ptr;
+
+	/* Publish, then check for a sleeper; pairs with the order in read() */
+	__atomic_store_n(&mTail, tail + 1, __ATOMIC_SEQ_CST);
+	if (__atomic_load_n(&mWaiting, __ATOMIC_SEQ_CST))
+		futexWake(&mTail);
+
+	return true;
 }
 
 radioVector *VectorFIFO::get()
 {
-	return (radioVector*) mQ.get();
+	unsigned head = __atomic_load_n(&mHead, __ATOMIC_RELAXED);
+	unsigned tail = __atomic_load_n(&mTail, __ATOMIC_ACQUIRE);
+
+	if (head == tail)
+		return NULL;
+
+	radioVector *ptr = mBuffer[head % VECTORFIFO_SIZE];
+	__atomic_store_n(&mHead, head + 1, __ATOMIC_RELEASE);
+
+	return ptr;
+}
+
+radioVector *VectorFIFO::read(unsigned timeout)
+{
+	radioVector *ptr;
+
+	for (int i = 0; i < VECTORFIFO_SPINS; i++) {
+		if ((ptr = get()))
+			return ptr;
+	}
+
+	/* Announce the sleep, then recheck before blocking on the counter */
+	__atomic_store_n(&mWaiting, 1, __ATOMIC_SEQ_CST);
+	unsigned tail = __atomic_load_n(&mTail, __ATOMIC_SEQ_CST);
+	if (tail == __atomic_load_n(&mHead, __ATOMIC_RELAXED))
+		futexWait(&mTail, tail, timeout);
+	__atomic_store_n(&mWaiting, 0, __ATOMIC_RELAXED);
+
+	return get();
 }
 
 GSM::Time VectorQueue::nextTime() const
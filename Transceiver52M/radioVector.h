@@ -27,7 +27,8 @@
 
 class radioVector : public signalVector {
 public:
-	radioVector(const signalVector& wVector, GSM::Time& wTime);
+	radioVector(const signalVector& wVector, const GSM::Time& wTime);
+	radioVector(size_t size, const GSM::Time& wTime);
 	GSM::Time getTime() const;
 	void setTime(const GSM::Time& wTime);
 	bool operator>(const radioVector& other) const;
@@ -36,14 +37,52 @@ private:
 	GSM::Time mTime;
 };
 
+/** Capacity of a VectorFIFO, a power of two */
+#define VECTORFIFO_SIZE		64
+#define VECTORFIFO_CACHE_LINE	64
+
+/**
+	Bounded lock-free FIFO of bursts between one producer and one consumer.
+
+	Read and write counters run freely and sit on separate cache lines, so
+	neither side writes a line the other side writes. A consumer that has
+	nothing to do can block in read(), which spins briefly and then sleeps
+	on a futex until the producer puts a burst.
+*/
 class VectorFIFO {
 public:
+	VectorFIFO();
+
+	/** Number of bursts in the FIFO */
 	unsigned size();
-	void put(radioVector *ptr);
+
+	/**
+		Add a burst, producer side only.
+		@return False if the FIFO is full, the burst is not taken.
+	*/
+	bool put(radioVector *ptr);
+
+	/** Take a burst without waiting, consumer side only, NULL if empty */
 	radioVector *get();
 
+	/**
+		Take a burst, waiting up to timeout milliseconds for one,
+		consumer side only.
+		@return The burst, or NULL on timeout.
+	*/
+	radioVector *read(unsigned timeout);
+
 private:
-	PointerFIFO mQ;
+	radioVector *mBuffer[VECTORFIFO_SIZE];
+
+	/* consumer owned */
+	unsigned mHead __attribute__((aligned(VECTORFIFO_CACHE_LINE)));
+
+	/* producer owned, doubles as the futex word */
+	unsigned mTail __attribute__((aligned(VECTORFIFO_CACHE_LINE)));
+
+	/* set while the consumer sleeps */
+	int mWaiting __attribute__((aligned(VECTORFIFO_CACHE_LINE)));
 };
 
 class VectorQueue : public InterthreadPriorityQueue<radioVector> {
@@ -0,0 +1,113 @@
+/*
+ * Polyphase filter bank resampler
+ *
+ * Copyright 2011 Free Software Foundation, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * See the COPYING file in the main directory for details.
+ */
+
+#include <string.h>
+#include <algorithm>
+
+#include "resampler.h"
+#include "convolve.h"
+#include <Logger.h>
+
+/*
+ * Branch b holds taps b, b+P, b+2P, ... of the prototype filter. Each branch
+ * is stored time-reversed and zero padded to a common length, so an output
+ * is a forward inner product with the mBranchLen most recent input samples.
+ */
+Resampler::Resampler(int wP, int wQ, const signalVector &wLPF, int wMaxInputLen)
+	: mP(wP), mQ(wQ)
+{
+	int len = wLPF.size();
+
+	mBranchLen = (len + mP - 1) / mP;
+	mDelay = ((len + 1) / 2) / mQ;
+
+	mBranches.resize(mP * mBranchLen);
+	mBranches.fill(0.0);
+	mBranches.isRealOnly(true);
+
+	for (int b = 0; b < mP; b++) {
+		complex *branch = mBranches.begin() + b * mBranchLen;
+		for (int k = 0; k < mBranchLen; k++) {
+			if (b + k * mP < len)
+				branch[mBranchLen - 1 - k] = wLPF[b + k * mP].real();
+		}
+	}
+
+	mBuffer.resize(mBranchLen - 1 + wMaxInputLen);
+	mAllocations = 1;
+
+	reset();
+}
+
+void Resampler::reset()
+{
+	mBuffer.fill(0.0, 0, mBranchLen - 1);
+
+	mInputIndex = (mDelay * mQ) / mP;
+	mBranch = (mDelay * mQ) % mP;
+}
+
+int Resampler::outputLen(int inLen) const
+{
+	/* Outputs n >= 0 with mInputIndex + (mBranch + n*Q)/P < inLen */
+	int span = (inLen - mInputIndex) * mP - mBranch;
+	if (span <= 0)
+		return 0;
+
+	return (span + mQ - 1) / mQ;
+}
+
+int Resampler::rotate(const complex *in, int inLen, complex *out, int outLen)
+{
+	int hist = mBranchLen - 1;
+	int num = outputLen(inLen);
+
+	if (num > outLen) {
+		LOG(ERR) << "resampler output of " << num
+			 << " samples exceeds buffer of " << outLen;
+		return -1;
+	}
+
+	/* Append the block to the history, keeping the storage between calls */
+	if (mBuffer.size() < (size_t) (hist + inLen)) {
+		signalVector history(hist);
+		mBuffer.segmentCopyTo(history, 0, hist);
+		mBuffer.resize(hist + inLen);
+		history.copyTo(mBuffer);
+		mAllocations++;
+	}
+	std::copy(in, in + inLen, mBuffer.begin() + hist);
+
+	/* Input sample m of the block sits at mBuffer[hist + m] */
+	for (int n = 0; n < num; n++) {
+		out[n] = convolveDotRealTaps(mBuffer.begin() + mInputIndex,
+					     mBranches.begin() + mBranch * mBranchLen,
+					     mBranchLen);
+		mBranch += mQ;
+		mInputIndex += mBranch / mP;
+		mBranch %= mP;
+	}
+
+	/* Keep the newest samples as history for the next block */
+	std::copy(mBuffer.begin() + inLen, mBuffer.begin() + inLen + hist, mBuffer.begin());
+	mInputIndex -= inLen;
+
+	return num;
+}
@@ -0,0 +1,80 @@
+/*
+ * Polyphase filter bank resampler
+ *
+ * Copyright 2011 Free Software Foundation, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * See the COPYING file in the main directory for details.
+ */
+
+#ifndef RESAMPLER_H
+#define RESAMPLER_H
+
+#include "sigProcLib.h"
+
+/**
+	Streaming rational P/Q resampler.
+
+	The prototype low pass filter, designed at P times the input rate, is
+	split once into P contiguous branch filters. Input history and the
+	output phase are carried between calls, so a continuous stream can be
+	resampled in blocks of any size without overlap copies.
+
+	Output n is computed from input sample floor((n+D)*Q/P), with D the
+	same group delay compensation polyphaseResampleVector() applies. Outputs
+	that need input not yet seen are produced by a later call.
+*/
+class Resampler {
+public:
+	/**
+		Build the branch filters.
+		@param wP The interpolation factor.
+		@param wQ The decimation factor.
+		@param wLPF The prototype filter, real-valued taps at P times the input rate.
+		@param wMaxInputLen The largest block expected, to size the input buffer up front.
+	*/
+	Resampler(int wP, int wQ, const signalVector &wLPF, int wMaxInputLen = 0);
+
+	/** Clear the history and restart the output phase */
+	void reset();
+
+	/** Number of outputs the next rotate() call produces for inLen inputs */
+	int outputLen(int inLen) const;
+
+	/**
+		Resample the next block of the stream.
+		@param in The input samples.
+		@param inLen The number of input samples.
+		@param out The output buffer.
+		@param outLen The size of the output buffer.
+		@return The number of output samples, or -1 if outLen is too short.
+	*/
+	int rotate(const complex *in, int inLen, complex *out, int outLen);
+
+	/** Number of times the input buffer has been allocated */
+	unsigned allocations() const { return mAllocations; }
+
+private:
+	int mP;                      ///< interpolation factor
+	int mQ;                      ///< decimation factor
+	int mBranchLen;              ///< taps per branch filter
+	int mDelay;                  ///< group delay compensation in output samples
+	signalVector mBranches;      ///< P time-reversed branch filters, back to back
+	signalVector mBuffer;        ///< input history followed by the current block
+	int mInputIndex;             ///< newest input sample of the next output, relative to the current block
+	int mBranch;                 ///< branch filter of the next output
+	unsigned mAllocations;       ///< input buffer allocations so far
+};
+
+#endif /* RESAMPLER_H */
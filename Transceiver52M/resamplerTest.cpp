@@ -0,0 +1,117 @@
+/*
+ * Copyright 2011 Free Software Foundation, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * See the COPYING file in the main directory for details.
+ */
+
+/*
+ * Compares the streaming resampler against polyphaseResampleVector() at
+ * the receive and transmit rates used by radioIOResamp.cpp, once over a
+ * whole vector and once fed in blocks of varying size.
+ */
+
+#include "sigProcLib.h"
+#include "resampler.h"
+#include <Logger.h>
+#include <Configuration.h>
+
+using namespace std;
+
+ConfigurationTable gConfig;
+
+static float randomFloat()
+{
+  return 2.0F*((float) random()/(float) RAND_MAX) - 1.0F;
+}
+
+static bool compare(const complex *x, const complex *y, int len, float scale)
+{
+  for (int i = 0; i < len; i++) {
+    if ((x[i] - y[i]).abs() > 1.0e-4F*scale) {
+      cout << "mismatch at " << i << ": " << x[i] << " " << y[i] << endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool testRates(int P, int Q, int taps)
+{
+  const int inLen = 20*Q;
+
+  float cutoff = (P < Q) ? (1.0/(float) Q) : (1.0/(float) P);
+  signalVector *lpf = createLPF(cutoff, taps, P);
+
+  signalVector x(inLen);
+  for (int i = 0; i < inLen; i++)
+    x[i] = complex(randomFloat(), randomFloat());
+
+  signalVector *expected = polyphaseResampleVector(x, P, Q, lpf);
+
+  Resampler resampler(P, Q, *lpf, inLen);
+  bool pass = true;
+
+  // the whole vector at once
+  signalVector y(expected->size());
+  int num = resampler.rotate(x.begin(), inLen, y.begin(), y.size());
+  if ((num <= 0) || !compare(y.begin(), expected->begin(), num, P)) {
+    cout << P << "/" << Q << ": single block failed" << endl;
+    pass = false;
+  }
+
+  // the same vector in irregular blocks
+  resampler.reset();
+  int inIx = 0, outIx = 0;
+  while (inIx < inLen) {
+    int len = random() % (2*Q);
+    if (inIx + len > inLen) len = inLen - inIx;
+    int n = resampler.rotate(x.begin() + inIx, len,
+			     y.begin() + outIx, y.size() - outIx);
+    if (n < 0) break;
+    inIx += len;
+    outIx += n;
+  }
+  if ((outIx != num) || !compare(y.begin(), expected->begin(), outIx, P)) {
+    cout << P << "/" << Q << ": streaming failed" << endl;
+    pass = false;
+  }
+
+  // the input buffer was sized up front, so streaming must not allocate
+  if (resampler.allocations() != 1) {
+    cout << P << "/" << Q << ": " << resampler.allocations() << " allocations" << endl;
+    pass = false;
+  }
+
+  cout << P << "/" << Q << " with " << taps << " taps: "
+       << num << " samples, " << (pass ? "passed" : "FAILED") << endl;
+
+  delete expected;
+  delete lpf;
+
+  return pass;
+}
+
+int main(int argc, char **argv)
+{
+  gLogInit("resamplerTest","INFO");
+
+  bool pass = true;
+  pass &= testRates(65, 96, 961);
+  pass &= testRates(96, 65, 651);
+  pass &= testRates(130, 192, 961);
+  pass &= testRates(192, 130, 651);
+
+  return pass ? 0 : 1;
+}
@@ -28,10 +28,12 @@
 
 #include "sigProcLib.h"
 #include "GSMCommon.h"
+#include "convolve.h"
 #include "sendLPF_961.h"
 #include "rcvLPF_651.h"
 
 #include <Logger.h>
+#include <Threads.h>
 
 #define TABLESIZE 1024
 
@@ -59,6 +61,29 @@ typedef struct {
 CorrelationSequence *gMidambles[] = {NULL,NULL,NULL,NULL,NULL,NULL,NULL,NULL};
 CorrelationSequence *gRACHSequence = NULL;
 
+/** Precomputed GMSK modulator output, see modulateBurst() */
+typedef struct {
+  signalVector *pulse;        ///< pulse shape the table was built for
+  int          samplesPerSymbol;
+  int          windowStart;   ///< first neighbouring symbol overlapping a symbol period
+  int          windowLen;     ///< number of symbols overlapping a symbol period
+  int          numPatterns;   ///< 3^windowLen symbol patterns
+  signalVector *table;        ///< output by rotation phase, pattern and sample
+} GMSKModulatorTable;
+
+GMSKModulatorTable *gGMSKModulator = NULL;
+Mutex gGMSKModulatorLock;
+
+static void deleteGMSKModulator()
+{
+  if (gGMSKModulator) {
+    delete gGMSKModulator->pulse;
+    delete gGMSKModulator->table;
+    delete gGMSKModulator;
+    gGMSKModulator = NULL;
+  }
+}
+
 void sigProcLibDestroy(void) {
   if (GMSKRotation) {
     delete GMSKRotation;
@@ -82,6 +107,7 @@ void sigProcLibDestroy(void) {
     delete gRACHSequence;
     gRACHSequence = NULL;
   }
+  deleteGMSKModulator();
 }
 
 
@@ -228,6 +254,7 @@ void initGMSKRotationTables(int samplesPerSymbol) {
 }
 
 void sigProcLibSetup(int samplesPerSymbol) {
+  convolveInit();
   initTrigTables();
   initGMSKRotationTables(samplesPerSymbol);
 }
@@ -318,119 +345,35 @@ signalVector* convolve(const signalVector *a,
   else if (c->size()!=outSize)
     return NULL;
 
-  signalVector::const_iterator aStart = a->begin();
-  signalVector::const_iterator bStart = b->begin();
-  signalVector::const_iterator aEnd = a->end();
-  signalVector::const_iterator bEnd = b->end();
-  signalVector::iterator cPtr = c->begin();
-  int t = startIndex;
-  int stopIndex = startIndex + outSize;
+  ConvolveType type;
   switch (b->getSymmetry()) {
   case NONE:
-    {
-      while (t < stopIndex) {
-	signalVector::const_iterator aP = aStart+t;
-	signalVector::const_iterator bP = bStart;
-	if (a->isRealOnly() && b->isRealOnly()) {
-	  float sum = 0.0;
-	  while (bP < bEnd) {
-	    if (aP < aStart) break;
-	    if (aP < aEnd) sum += (aP->real())*(bP->real());
-	    aP--;
-	    bP++;
-	  }
-	  *cPtr++ = sum;
-	}
-	else if (a->isRealOnly()) {
-	  complex sum = 0.0;
-	  while (bP < bEnd) {
-	    if (aP < aStart) break;
-	    if (aP < aEnd) sum += (*bP)*(aP->real());
-	    aP--;
-	    bP++;
-	  }
-	  *cPtr++ = sum;
-	}
-	else if (b->isRealOnly()) {
-	  complex sum = 0.0;
-	  while (bP < bEnd) {
-	    if (aP < aStart) break;
-	    if (aP < aEnd) sum += (*aP)*(bP->real());
-	    aP--;
-	    bP++;
-	  }
-	  *cPtr++ = sum;
-	}
-	else {
-	  complex sum = 0.0;
-	  while (bP < bEnd) {
-	    if (aP < aStart) break;
-	    if (aP < aEnd) sum += (*aP)*(*bP);
-	    aP--;
-	    bP++;
-	  }
-	  *cPtr++ = sum;
-	}
-	t++;
-      }
-    }
+    if (b->isRealOnly())
+      type = CONVOLVE_REAL_TAPS;
+    else if (a->isRealOnly())
+      type = CONVOLVE_REAL_DATA;
+    else
+      type = CONVOLVE_COMPLEX;
     break;
   case ABSSYM:
-    {
-      complex sum = 0.0;
-      bool isOdd = (bool) (Lb % 2);
-      if (isOdd) 
-	bEnd = bStart + (Lb+1)/2;
-      else 
-	bEnd = bStart + Lb/2;
-      while (t < stopIndex) {
-	signalVector::const_iterator aP = aStart+t;
-	signalVector::const_iterator aPsym = aP-Lb+1;
-	signalVector::const_iterator bP = bStart;
-	sum = 0.0;
-        if (!b->isRealOnly()) {
-	  while (bP < bEnd) {
-	    if (aP < aStart) break;
-	    if (aP == aPsym)
-	      sum+= (*aP)*(*bP);
-	    else if ((aP < aEnd) && (aPsym >= aStart)) 
-	      sum+= ((*aP)+(*aPsym))*(*bP);
-	    else if (aP < aEnd)
-	      sum += (*aP)*(*bP);
-	    else if (aPsym >= aStart)
-	      sum += (*aPsym)*(*bP);
-	    aP--;
-	    aPsym++;
-	    bP++;
-	  }
-        }
-        else {
-          while (bP < bEnd) {
-            if (aP < aStart) break;
-            if (aP == aPsym)
-              sum+= (*aP)*(bP->real());
-            else if ((aP < aEnd) && (aPsym >= aStart))
-              sum+= ((*aP)+(*aPsym))*(bP->real());
-            else if (aP < aEnd)
-              sum += (*aP)*(bP->real());
-            else if (aPsym >= aStart)
-              sum += (*aPsym)*(bP->real());
-            aP--;
-            aPsym++;
-            bP++;
-          }
-        }
-	*cPtr++ = sum;
-	t++;
-      }
-    }
+    type = b->isRealOnly() ? CONVOLVE_SYM_REAL_TAPS : CONVOLVE_SYM_COMPLEX;
     break;
   default:
     return NULL;
-    break;
   }
-    
-    
+
+  convolveSpan(type, a->begin(), La, b->begin(), Lb,
+               c->begin(), startIndex, outSize);
+
+  // real-valued inputs only ever produced the real part
+  if ((b->getSymmetry() == NONE) && a->isRealOnly() && b->isRealOnly()) {
+    signalVector::iterator cPtr = c->begin();
+    while (cPtr < c->end()) {
+      *cPtr = cPtr->real();
+      cPtr++;
+    }
+  }
+
   return c;
 }
 
@@ -561,54 +504,138 @@ bool vectorSlicer(signalVector *x)
   return true;
 }
   
+/*
+ * Table-driven GMSK modulation
+ *
+ * The modulated burst is the pulse shape convolved with +/-1 impulses at the
+ * symbol instants, each rotated by j^i for symbol i. Every output sample of
+ * symbol period i then depends only on the few neighbouring symbols whose
+ * pulses overlap that period and on the rotation phase i mod 4. The table
+ * holds the output of one symbol period for every rotation phase and every
+ * pattern of neighbouring symbols, each symbol being -1, +1 or absent past
+ * the edges of the burst.
+ */
+#define GMSKMAXWINDOW 5
+
+static bool samePulse(const signalVector &a, const signalVector &b)
+{
+  if (a.size() != b.size()) return false;
+  for (unsigned i = 0; i < a.size(); i++)
+    if (a[i] != b[i]) return false;
+  return true;
+}
+
+static GMSKModulatorTable *buildGMSKModulator(const signalVector &gsmPulse,
+					      int samplesPerSymbol)
+{
+  static const complex rotation[4] = {complex(1.0,0.0), complex(0.0,1.0),
+				      complex(-1.0,0.0), complex(0.0,-1.0)};
+
+  // pulse tap aligned with the symbol instant, as for a NO_DELAY convolution
+  int Lp = gsmPulse.size();
+  int center = (Lp % 2) ? Lp/2 : Lp/2-1;
+
+  // symbols i0+k overlapping output i0*sps+r for some r in [0,sps)
+  int kLo = (int) ceil((float) (center-Lp+1)/(float) samplesPerSymbol);
+  int kHi = (samplesPerSymbol-1+center)/samplesPerSymbol;
+  int windowLen = kHi-kLo+1;
+  if (windowLen > GMSKMAXWINDOW) return NULL;
+
+  GMSKModulatorTable *mod = new GMSKModulatorTable;
+  mod->pulse = new signalVector(gsmPulse);
+  mod->samplesPerSymbol = samplesPerSymbol;
+  mod->windowStart = kLo;
+  mod->windowLen = windowLen;
+  mod->numPatterns = 1;
+  for (int k = 0; k < windowLen; k++) mod->numPatterns *= 3;
+  mod->table = new signalVector(4*mod->numPatterns*samplesPerSymbol);
+
+  signalVector::iterator tablePtr = mod->table->begin();
+  for (int phase = 0; phase < 4; phase++) {
+    for (int pattern = 0; pattern < mod->numPatterns; pattern++) {
+      for (int r = 0; r < samplesPerSymbol; r++) {
+	complex sum = 0.0;
+	int digits = pattern;
+	// the last symbol of the window is the least significant digit
+	for (int k = kHi; k >= kLo; k--) {
+	  int digit = digits % 3;
+	  digits /= 3;
+	  int tap = r + center - k*samplesPerSymbol;
+	  if ((digit == 0) || (tap < 0) || (tap >= Lp)) continue;
+	  float symbol = (digit == 2) ? 1.0 : -1.0;
+	  sum += rotation[(phase+k+4*GMSKMAXWINDOW) % 4]*(symbol*gsmPulse[tap].real());
+	}
+	*tablePtr++ = sum;
+      }
+    }
+  }
+
+  return mod;
+}
+
 signalVector *modulateBurst(const BitVector &wBurst,
 			    const signalVector &gsmPulse,
 			    int guardPeriodLength,
 			    int samplesPerSymbol)
 {
-
-  //static complex staticBurst[157];
-
-  int burstSize = samplesPerSymbol*(wBurst.size()+guardPeriodLength);
-  //signalVector modBurst((complex *) staticBurst,0,burstSize);
-  signalVector modBurst(burstSize);// = new signalVector(burstSize);
-  modBurst.isRealOnly(true);
-  //memset(staticBurst,0,sizeof(complex)*burstSize);
-  modBurst.fill(0.0);
-  signalVector::iterator modBurstItr = modBurst.begin();
-
-#if 0 
-  // if wBurst is already differentially decoded
-  *modBurstItr = 2.0*(wBurst[0] & 0x01)-1.0;
-  signalVector::iterator prevVal = modBurstItr;
-  for (unsigned int i = 1; i < wBurst.size(); i++) {
-    modBurstItr += samplesPerSymbol;
-    if (wBurst[i] & 0x01) 
-      *modBurstItr = *prevVal * complex(0.0,1.0);
-    else
-      *modBurstItr = *prevVal * complex(0.0,-1.0);
-    prevVal = modBurstItr;
+  // one table for all callers, rebuilt if the pulse shape changes
+  ScopedLock lock(gGMSKModulatorLock);
+  if (!gGMSKModulator || (gGMSKModulator->samplesPerSymbol != samplesPerSymbol)
+      || !samePulse(*gGMSKModulator->pulse,gsmPulse)) {
+    deleteGMSKModulator();
+    gGMSKModulator = buildGMSKModulator(gsmPulse,samplesPerSymbol);
   }
-#else
-  // if wBurst are the raw bits
-  for (unsigned int i = 0; i < wBurst.size(); i++) {
-    *modBurstItr = 2.0*(wBurst[i] & 0x01)-1.0;
-    modBurstItr += samplesPerSymbol;
+  GMSKModulatorTable *mod = gGMSKModulator;
+
+  int numSymbols = wBurst.size();
+  int burstSize = samplesPerSymbol*(numSymbols+guardPeriodLength);
+
+  // pulses too long for a table, use the direct convolution
+  if (!mod) {
+    signalVector modBurst(burstSize);
+    modBurst.isRealOnly(true);
+    modBurst.fill(0.0);
+    signalVector::iterator modBurstItr = modBurst.begin();
+    for (int i = 0; i < numSymbols; i++) {
+      *modBurstItr = 2.0*(wBurst[i] & 0x01)-1.0;
+      modBurstItr += samplesPerSymbol;
+    }
+
+    // shift up pi/2
+    // ignore starting phase, since spec allows for discontinuous phase
+    GMSKRotate(modBurst);
+    modBurst.isRealOnly(false);
+
+    // filter w/ pulse shape
+    return convolve(&modBurst,&gsmPulse,NULL,NO_DELAY);
   }
 
-  // shift up pi/2
-  // ignore starting phase, since spec allows for discontinuous phase
-  GMSKRotate(modBurst);
-#endif
-  modBurst.isRealOnly(false);
+  signalVector *shapedBurst = new signalVector(burstSize);
+  signalVector::iterator shapedItr = shapedBurst->begin();
 
-  // filter w/ pulse shape
-  signalVector *shapedBurst = convolve(&modBurst,&gsmPulse,NULL,NO_DELAY);
+  // symbol pattern of the window around symbol 0, in base 3
+  int kLo = mod->windowStart;
+  int kHi = kLo + mod->windowLen - 1;
+  int pattern = 0;
+  for (int k = kLo; k <= kHi; k++) {
+    int digit = ((k >= 0) && (k < numSymbols)) ? 1 + (wBurst[k] & 0x01) : 0;
+    pattern = 3*pattern + digit;
+  }
 
-  //delete modBurst;
-  
-  return shapedBurst;
+  const complex *table = mod->table->begin();
+  int numOutputSymbols = numSymbols+guardPeriodLength;
+  for (int i = 0; i < numOutputSymbols; i++) {
+    const complex *entry = table + ((i%4)*mod->numPatterns + pattern)*samplesPerSymbol;
+    for (int r = 0; r < samplesPerSymbol; r++)
+      *shapedItr++ = entry[r];
+
+    // slide the window by one symbol
+    int next = i+1+kHi;
+    int digit = ((next >= 0) && (next < numSymbols)) ? 1 + (wBurst[next] & 0x01) : 0;
+    pattern = 3*(pattern % (mod->numPatterns/3)) + digit;
+  }
 
+  return shapedBurst;
 }
 
 float sinc(float x) 
@@ -924,46 +951,83 @@ bool generateRACHSequence(signalVector &gsmPulse,
 }
 
 				
+/*
+ * Correlator lags on either side of the expected peak window, enough to
+ * keep the sinc interpolation in peakDetect() clear of the window edges.
+ */
+#define CORRWINDOWMARGIN 12
+
 bool detectRACHBurst(signalVector &rxBurst,
 		     float detectThreshold,
 		     int samplesPerSymbol,
 		     complex *amplitude,
-		     float* TOA)
+		     float* TOA,
+		     unsigned maxTOA,
+		     signalVector *corrBuffer)
 {
+  signalVector *RACHSeq = gRACHSequence->sequenceReversedConjugated;
+  int Lb = RACHSeq->size();
+  int noDelayStart = (Lb % 2) ? Lb/2 : Lb/2-1;
+
+  // Only search the lags a RACH burst between zero and maxTOA symbols
+  // of access delay can produce. A maxTOA of zero searches the whole burst.
+  int windowStart = 0;
+  int windowEnd = rxBurst.size();
+  if (maxTOA > 0) {
+    float zeroDelayPeak = gRACHSequence->TOA + 8*samplesPerSymbol;
+    windowStart = (int) floor(zeroDelayPeak) - CORRWINDOWMARGIN - samplesPerSymbol;
+    windowEnd = (int) ceil(zeroDelayPeak + maxTOA*samplesPerSymbol) + CORRWINDOWMARGIN + samplesPerSymbol;
+    if (windowStart < 0) windowStart = 0;
+    if (windowEnd > (int) rxBurst.size()) windowEnd = rxBurst.size();
+  }
+  if (windowEnd - windowStart < 2) {
+    *amplitude = 0.0;
+    return false;
+  }
 
-  //static complex staticData[500];
- 
-  //signalVector correlatedRACH(staticData,0,rxBurst.size());
-  signalVector correlatedRACH(rxBurst.size());
-  correlate(&rxBurst,gRACHSequence->sequenceReversedConjugated,&correlatedRACH,NO_DELAY,true);
+  // use the caller's scratch buffer for the correlator output if it fits
+  unsigned valleyLen = 50*samplesPerSymbol+1;
+  unsigned bufferLen = windowEnd-windowStart;
+  if (bufferLen < valleyLen) bufferLen = valleyLen;
+  signalVector localBuffer;
+  if (!corrBuffer || (corrBuffer->size() < bufferLen)) {
+    localBuffer.resize(bufferLen);
+    corrBuffer = &localBuffer;
+  }
+
+  signalVector correlatedRACH(corrBuffer->begin(),0,windowEnd-windowStart);
+  correlate(&rxBurst,RACHSeq,&correlatedRACH,CUSTOM,true,
+            noDelayStart+windowStart,correlatedRACH.size());
 
   float meanPower;
   complex peakAmpl = peakDetect(correlatedRACH,TOA,&meanPower);
 
-  float valleyPower = 0.0; 
-
   // check for bogus results
   if ((*TOA < 0.0) || (*TOA > correlatedRACH.size())) {
-        *amplitude = 0.0;
-	return false;
+    *amplitude = 0.0;
+    return false;
   }
-  complex *peakPtr = correlatedRACH.begin() + (int) rint(*TOA);
 
   LOG(DEBUG) << "RACH corr: " << correlatedRACH;
 
-  float numSamples = 0.0;
-  for (int i = 57*samplesPerSymbol; i <= 107*samplesPerSymbol;i++) {
-    if (peakPtr+i >= correlatedRACH.end())
-      break;
-    valleyPower += (peakPtr+i)->norm2();
-    numSamples++;
-  }
+  *TOA += windowStart;
 
-  if (numSamples < 2) {
-        *amplitude = 0.0;
-        return false;
+  // noise floor from the lags 57 to 107 symbols past the peak
+  int valleyStart = (int) rint(*TOA) + 57*samplesPerSymbol;
+  int valleyEnd = (int) rint(*TOA) + 107*samplesPerSymbol + 1;
+  if (valleyEnd > (int) rxBurst.size()) valleyEnd = rxBurst.size();
+
+  if (valleyEnd - valleyStart < 2) {
+    *amplitude = 0.0;
+    return false;
   }
 
+  signalVector valley(corrBuffer->begin(),0,valleyEnd-valleyStart);
+  correlate(&rxBurst,RACHSeq,&valley,CUSTOM,true,
+            noDelayStart+valleyStart,valley.size());
+  float valleyPower = vectorNorm2(valley);
+  float numSamples = valley.size();
+
   float RMS = sqrtf(valleyPower/(float) numSamples)+0.00001;
   float peakToMean = peakAmpl.abs()/RMS;
 
@@ -1006,7 +1070,8 @@ bool analyzeTrafficBurst(signalVector &rxBurst,
 			 unsigned maxTOA,
                          bool requestChannel,
                          signalVector **channelResponse,
-			 float *channelResponseOffset) 
+			 float *channelResponseOffset,
+			 signalVector *corrBuffer)
 {
 
   assert(TSC<8);
@@ -1027,9 +1092,13 @@ bool analyzeTrafficBurst(signalVector &rxBurst,
 
   signalVector burstSegment(rxBurst.begin(),startIx,windowLen);
 
-  //static complex staticData[200];
-  //signalVector correlatedBurst(staticData,0,corrLen);
-  signalVector correlatedBurst(corrLen);
+  // use the caller's scratch buffer for the correlator output if it fits
+  signalVector localBuffer;
+  if (!corrBuffer || (corrBuffer->size() < corrLen)) {
+    localBuffer.resize(corrLen);
+    corrBuffer = &localBuffer;
+  }
+  signalVector correlatedBurst(corrBuffer->begin(),0,corrLen);
   correlate(&burstSegment, gMidambles[TSC]->sequenceReversedConjugated,
 					    &correlatedBurst, CUSTOM,true,
 					    expectedTOAPeak-maxTOA,corrLen);
@@ -265,13 +265,17 @@ bool energyDetect(signalVector &rxBurst,
         @param samplesPerSymbol The number of samples per GSM symbol.
         @param amplitude The estimated amplitude of received RACH burst.
         @param TOA The estimate time-of-arrival of received RACH burst.
+        @param maxTOA The maximum expected access delay in symbols, zero to search the whole burst.
+        @param corrBuffer Optional preallocated scratch space for the correlator output.
         @return True if burst SNR is larger that the detectThreshold value.
 */
 bool detectRACHBurst(signalVector &rxBurst,
 		     float detectThreshold,
 		     int samplesPerSymbol,
 		     complex *amplitude,
-		     float* TOA);
+		     float* TOA,
+		     unsigned maxTOA = 0,
+		     signalVector *corrBuffer = NULL);
 
 /**
         Normal burst correlator, detector, channel estimator.
@@ -285,6 +289,7 @@ bool detectRACHBurst(signalVector &rxBurst,
         @param requestChannel Set to true if channel estimation is desired.
         @param channelResponse The estimated channel.
         @param channelResponseOffset The time offset b/w the first sample of the channel response and the reported TOA.
+        @param corrBuffer Optional preallocated scratch space for the correlator output.
         @return True if burst SNR is larger that the detectThreshold value.
 */
 bool analyzeTrafficBurst(signalVector &rxBurst,
@@ -296,7 +301,8 @@ bool analyzeTrafficBurst(signalVector &rxBurst,
                          unsigned maxTOA,
                          bool requestChannel = false,
 			 signalVector** channelResponse = NULL,
-			 float *channelResponseOffset = NULL);
+			 float *channelResponseOffset = NULL,
+			 signalVector *corrBuffer = NULL);
 
 /**
 	Decimate a vector.
@@ -362,6 +362,8 @@ int main(int argc, char *argv[])
 		LOG(INFO) << "tuning TRX " << i << " to ARFCN " << ARFCN;
 		ARFCNManager* radio = gTRX.ARFCN(i);
 		radio->tune(ARFCN);
+		// Batch the data socket traffic, if the transceiver supports it.
+		radio->setDataFormat(gConfig.getNum("TRX.DataFormat",2));
 	}
 
 	// Send either TSC or full BSIC depending on radio need
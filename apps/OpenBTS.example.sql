@@ -5,6 +5,8 @@ INSERT INTO "CONFIG" VALUES('CLI.SocketPath','/var/run/command',0,0,'Path for Un
 INSERT INTO "CONFIG" VALUES('Control.Reporting.PhysStatusTable','/var/run/OpenBTSChannelTable.db',1,0,'File path for channel status reporting database.  Static.');
 INSERT INTO "CONFIG" VALUES('Control.Reporting.TransactionTable','/var/run/TransactionTable.db',1,0,'File path for transaction table database.  Static.');
 INSERT INTO "CONFIG" VALUES('Control.Reporting.TMSITable','/var/run/OpenBTSTMSITable.db',1,0,'File path for TMSITable database.  Static.');
+INSERT INTO "CONFIG" VALUES('Control.Reporting.WAL','0',1,0,'If 1, the channel, transaction, TMSI and statistics databases use write-ahead logging with synchronous=NORMAL, trading durability of the last few writes for much cheaper commits.  Static.');
+INSERT INTO "CONFIG" VALUES('Control.Reporting.FlushPeriod','10',0,0,'Seconds between writes of the performance counters to the reporting database.  The counters are kept in memory in between.');
 INSERT INTO "CONFIG" VALUES('Control.Call.QueryRRLP.Early',NULL,0,1,'If not NULL, query every MS for its location via RRLP during the setup of a call.');
 INSERT INTO "CONFIG" VALUES('Control.Call.QueryRRLP.Late',NULL,0,1,'If not NULL, query every MS for its location via RRLP during the teardown of a call.');
 INSERT INTO "CONFIG" VALUES('Control.GSMTAP.TargetIP',NULL,0,1,'Target IP address for GSMTAP packets; the IP address of Wireshark, if you use it for GSM.');
@@ -47,6 +49,8 @@ INSERT INTO "CONFIG" VALUES('GSM.Identity.MCC','001',0,0,'Mobile country code, 2
 INSERT INTO "CONFIG" VALUES('GSM.Identity.MNC','01',0,0,'Mobile network code; Must be 3 dgits.  Assigned by your national regulator.');
 INSERT INTO "CONFIG" VALUES('GSM.Identity.ShortName','Range',0,1,'Network short name, displayed on some phones.  Optional but must be defined if you also want the network to send time-of-day.');
 INSERT INTO "CONFIG" VALUES('GSM.Identity.ShowCountry',1,0,0,'If not NULL, tell the phone to show the country name based on the MCC.');
+INSERT INTO "CONFIG" VALUES('GSM.L1.DecodeWorkers','0',1,1,'Number of threads per ARFCN decoding uplink bursts, at most 8.  Timeslots are shared out by TN modulo this number.  0 decodes on the receive thread.  Static.');
+INSERT INTO "CONFIG" VALUES('GSM.L1.Workers','2',1,1,'Number of threads that run the clock-driven L1 encoders (SCH, FCCH, BCCH, TCH/FACCH) at their TDMA deadlines.  Static.');
 INSERT INTO "CONFIG" VALUES('GSM.MS.Power.Damping','50',0,0,'Damping value for MS power control loop.');
 INSERT INTO "CONFIG" VALUES('GSM.MS.Power.Max','33',0,0,'Maximum commanded MS power level in dBm.');
 INSERT INTO "CONFIG" VALUES('GSM.MS.Power.Min','5',0,0,'Minimum commanded MS power level in dBm.');
@@ -87,11 +91,13 @@ INSERT INTO "CONFIG" VALUES('GSM.Timer.T3122Max','255000',0,0,'Maximum allowed v
 INSERT INTO "CONFIG" VALUES('GSM.Timer.T3122Min','2000',0,0,'Minimum allowed value for T3122, the RACH holdoff timer, in milliseconds.');
 INSERT INTO "CONFIG" VALUES('GSM.Timer.T3212','30',0,0,'Registration timer T3212 period in minutes.  Should be a factor of 6.  Set to 0 to disable periodic registration.  Should be smaller than SIP registration period.');
 INSERT INTO "CONFIG" VALUES('Log.Alarms.Max','20',0,0,'Maximum number of alarms to remember inside the application.');
+INSERT INTO "CONFIG" VALUES('Log.Async','1',1,1,'If 1, log records are queued and written by a background thread, so logging never blocks the radio threads.  Records are dropped and counted if the queue overflows.  Static.');
 INSERT INTO "CONFIG" VALUES('Log.Level','WARNING',0,0,'Default logging level when no other level is defined for a file.');
 INSERT INTO "CONFIG" VALUES('Log.Level.CallControl.cpp','INFO',0,1,'Default configuration logs a trace at L3.');
 INSERT INTO "CONFIG" VALUES('Log.Level.MobilityManagement.cpp','INFO',0,1,'Default configuration logs a trace at L3.');
 INSERT INTO "CONFIG" VALUES('Log.Level.RadioResource.cpp','INFO',0,1,'Default configuration logs a trace at L3.');
 INSERT INTO "CONFIG" VALUES('Log.Level.SMSControl.cpp','INFO',0,1,'Default configuration logs a trace at L3.');
+INSERT INTO "CONFIG" VALUES('Log.Sink','syslog',1,1,'Where the background log writer puts records, with Log.Async: syslog, file:<path> or socket:<path> for a local datagram socket.  Static.');
 INSERT INTO "CONFIG" VALUES('NTP.Server','pool.ntp.org',0,1,'NTP server(s) for time-of-day clock syncing.  For multiple servers, use a space-delimited list.  If left undefined, NTP will not be used, but it is strongly recommended.');
 INSERT INTO "CONFIG" VALUES('RTP.Range','98',1,0,'Range of RTP port pool.  Pool is RTP.Start to RTP.Range-1.  Static.');
 INSERT INTO "CONFIG" VALUES('RTP.Start','16484',1,0,'Base of RTP port pool.  Pool is RTP.Start to RTP.Range-1.  Static.');
@@ -122,9 +128,12 @@ INSERT INTO "CONFIG" VALUES('SubscriberRegistry.Manager.Url','http://127.0.0.1/c
 INSERT INTO "CONFIG" VALUES('SubscriberRegistry.Manager.VisibleColumns','name username type context host',0,0,'Field names in subscriber registry visible in the database manager.');
 INSERT INTO "CONFIG" VALUES('SubscriberRegistry.db','/var/lib/asterisk/sqlite3dir/sqlite3.db',0,0,'The location of the sqlite3 database holding the subscriber registry.');
 INSERT INTO "CONFIG" VALUES('SubscriberRegistry.Port','5064',0,0,'Port used by the SIP Authentication Server. NOTE: In some older releases (pre-2.8.1) this is called SIP.myPort.');
+INSERT INTO "CONFIG" VALUES('TRX.DataFormat','2',1,1,'Data socket format to ask the transceiver for.  1 sends one burst per datagram.  2 batches the bursts of a frame, with packed bits on the downlink; transceivers that do not support it stay on 1.  Static.');
 INSERT INTO "CONFIG" VALUES('TRX.IP','127.0.0.1',1,0,'IP address of the transceiver application.  Static.');
 INSERT INTO "CONFIG" VALUES('TRX.Port','5700',1,0,'IP port of the transceiver application.  Static.');
 INSERT INTO "CONFIG" VALUES('TRX.RadioFrequencyOffset','128',1,0,'Fine-tuning adjustment for the transceiver master clock.  Roughly 170 Hz/step.  Set at the factory.  Do not adjust without proper calibration.  Static.');
+INSERT INTO "CONFIG" VALUES('TRX.RxWorkers','2',1,1,'Number of threads demodulating uplink bursts in the transceiver, at most 8.  Timeslots are shared out evenly with 1, 2, 4 or 8.  0 demodulates on the radio thread.  If not set, one per processor beyond the first.  Static.');
+INSERT INTO "CONFIG" VALUES('TRX.SharedMemory','0',1,1,'If 1, and the transceiver runs on this host, pass bursts between OpenBTS and the transceiver through shared memory instead of UDP.  The control and clock interfaces stay on UDP.  Falls back to UDP if the shared memory is not available.  Static.');
 INSERT INTO "CONFIG" VALUES('TRX.Timeout.Clock','10',0,1,'How long to wait during a read operation from the transceiver before giving up.');
 INSERT INTO "CONFIG" VALUES('TRX.Timeout.Start','2',0,1,'How long to wait during system startup before checking to see if the transceiver can be reached.');
 INSERT INTO "CONFIG" VALUES('TRX.TxAttenOffset','2',1,0,'Hardware-specific gain adjustment for transmitter, matched to the power amplifier, expessed as an attenuationi in dB.  Set at the factory.  Do not adjust without proper calibration.  Static.');